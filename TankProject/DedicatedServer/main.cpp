@@ -0,0 +1,97 @@
+#include "GameServer.hpp"
+
+#include <SFML/System/Sleep.hpp>
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+
+// Dedicated server: the GameServer of a hosted game, without the game around it. Links only
+// sfml-system and sfml-network, so it runs on machines without a display or GPU.
+//
+// DedicatedServer [--port N] [--max-players N] [--tick-rate N] [--seed N]
+
+namespace
+{
+	volatile std::sig_atomic_t stopRequested = 0;
+
+	void requestStop(int)
+	{
+		stopRequested = 1;
+	}
+
+	bool parseNumber(const char* text, unsigned long min, unsigned long max, unsigned long& value)
+	{
+		char* end = nullptr;
+		value = std::strtoul(text, &end, 10);
+		return end != text && *end == '\0' && value >= min && value <= max;
+	}
+
+	void printUsage()
+	{
+		std::cout << "Usage: DedicatedServer [--port N] [--max-players N] [--tick-rate N] [--seed N]" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	GameServer::Settings settings;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string option = argv[i];
+		unsigned long value = 0;
+
+		if (option == "--help")
+		{
+			printUsage();
+			return 0;
+		}
+
+		bool valid = i + 1 < argc;
+		if (valid && option == "--port" && (valid = parseNumber(argv[i + 1], 1, 65535, value)))
+			settings.port = static_cast<unsigned short>(value);
+		else if (valid && option == "--max-players" && (valid = parseNumber(argv[i + 1], 1, 64, value)))
+			settings.maxPlayers = value;
+		else if (valid && option == "--tick-rate" && (valid = parseNumber(argv[i + 1], 1, ClientTickRate, value)))
+			settings.tickRate = value;
+		else if (valid && option == "--seed" && (valid = parseNumber(argv[i + 1], 0, 0xFFFFFFFFul, value)))
+			settings.seed = static_cast<unsigned int>(value);
+		else
+			valid = false;
+
+		if (!valid)
+		{
+			std::cout << "Server: invalid option " << option << std::endl;
+			printUsage();
+			return 1;
+		}
+
+		++i;
+	}
+
+	// Clients interpolate and sync their clocks assuming ServerTickRate
+	if (settings.tickRate != ServerTickRate)
+		std::cout << "Server: tick rate " << settings.tickRate << " differs from the " << ServerTickRate << " clients expect" << std::endl;
+
+	std::signal(SIGINT, requestStop);
+	std::signal(SIGTERM, requestStop);
+
+	std::cout << "Server: listening on port " << settings.port << ", up to " << settings.maxPlayers << " players, "
+		<< settings.tickRate << " ticks per second, seed " << settings.seed << std::endl;
+
+	{
+		GameServer server(settings);
+
+		while (!stopRequested)
+			sf::sleep(sf::milliseconds(100));
+
+		std::cout << "Server: shutting down" << std::endl;
+	}
+
+	// The server thread has finished and every socket is closed
+	std::cout << "Server: stopped" << std::endl;
+	return 0;
+}
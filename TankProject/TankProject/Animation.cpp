@@ -86,6 +86,11 @@ bool Animation::isFinished() const
 	return mCurrentFrame >= mNumFrames;
 }
 
+const sf::Sprite& Animation::getSprite() const
+{
+	return mSprite;
+}
+
 sf::FloatRect Animation::getLocalBounds() const
 {
 	return sf::FloatRect(getOrigin(), static_cast<sf::Vector2f>(getFrameSize()));
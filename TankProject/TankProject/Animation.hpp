@@ -27,6 +27,9 @@ public:
 	void 					restart();
 	bool 					isFinished() const;
 
+	// The current frame, before the animation's own transform
+	const sf::Sprite&		getSprite() const;
+
 	sf::FloatRect 			getLocalBounds() const;
 	sf::FloatRect 			getGlobalBounds() const;
 
@@ -16,7 +16,7 @@
 
 const sf::Time Application::TimePerFrame = sf::seconds(1.f / 60.f);
 
-Application::Application()
+Application::Application(const GraphicsSettings& graphics)
 	: mWindow(sf::VideoMode(1024, 768), "Freedom By Force", sf::Style::Close)
 	, mTextures()
 	, mFonts()
@@ -24,13 +24,18 @@ Application::Application()
 	, mSounds()
 	, mKeyBinding1(1)
 	, mKeyBinding2(2)
-	, mStateStack(State::Context(mWindow, mTextures, mFonts, mMusic, mSounds, mKeyBinding1, mKeyBinding2))
+	, mStatistics()
+	, mGraphics(graphics)
+	, mStateStack(State::Context(mWindow, mTextures, mFonts, mMusic, mSounds, mKeyBinding1, mKeyBinding2, mStatistics, mGraphics))
 	, mStatisticsText()
 	, mStatisticsUpdateTime()
 	, mStatisticsNumFrames(0)
 {
 	mWindow.setKeyRepeatEnabled(false);
-	mWindow.setVerticalSyncEnabled(true);
+	// The simulation runs on this thread and must not wait in display() for the monitor's refresh; the
+	// frame limit sleeps only for what is left of the frame instead
+	mWindow.setVerticalSyncEnabled(false);
+	mWindow.setFramerateLimit(static_cast<unsigned int>(1.f / TimePerFrame.asSeconds() + 0.5f));
 
 	mFonts.load(Fonts::Main, "Media/WorldConflict.ttf");
 	mFonts.load(Fonts::Clear, "Media/Quantico.ttf");
@@ -95,6 +100,7 @@ void Application::render()
 {
 	mWindow.clear();
 
+	mStatistics.drawCalls = 0;
 	mStateStack.draw();
 
 	mWindow.setView(mWindow.getDefaultView());
@@ -109,7 +115,18 @@ void Application::updateStatistics(sf::Time dt)
 	mStatisticsNumFrames += 1;
 	if (mStatisticsUpdateTime >= sf::seconds(1.0f))
 	{
-		mStatisticsText.setString("FPS: " + toString(mStatisticsNumFrames));
+		std::string statistics = "FPS: " + toString(mStatisticsNumFrames);
+
+		if (mStatistics.networked)
+		{
+			statistics += "\nRTT: " + toString(mStatistics.roundTripTime.asMilliseconds()) + " ms";
+			statistics += "\nJitter: " + toString(mStatistics.jitter.asMilliseconds()) + " ms";
+		}
+
+		if (mStatistics.drawCalls > 0)
+			statistics += "\nDraw calls: " + toString(mStatistics.drawCalls);
+
+		mStatisticsText.setString(statistics);
 
 		mStatisticsUpdateTime -= sf::seconds(1.0f);
 		mStatisticsNumFrames = 0;
@@ -125,6 +142,10 @@ void Application::registerStates()
 	mStateStack.registerState<GameState>(States::Game);
 	mStateStack.registerState<MultiplayerGameState>(States::HostGame, true);
 	mStateStack.registerState<MultiplayerGameState>(States::JoinGame, false);
+	mStateStack.registerState<MultiplayerGameState>(States::HostRollbackGame, true, MultiplayerGameState::Rollback);
+	mStateStack.registerState<MultiplayerGameState>(States::JoinRollbackGame, false, MultiplayerGameState::Rollback);
+	mStateStack.registerState<MultiplayerGameState>(States::HostLockstepGame, true, MultiplayerGameState::Lockstep);
+	mStateStack.registerState<MultiplayerGameState>(States::JoinLockstepGame, false, MultiplayerGameState::Lockstep);
 	mStateStack.registerState<PauseState>(States::Pause);
 	mStateStack.registerState<PauseState>(States::NetworkPause, true);
 	mStateStack.registerState<SettingsState>(States::Settings);
@@ -6,6 +6,8 @@
 #include "StateStack.hpp"
 #include "SoundPlayer.hpp"
 #include "MusicPlayer.hpp"
+#include "Statistics.hpp"
+#include "GraphicsSettings.hpp"
 
 #include <SFML/System/Time.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
@@ -15,7 +17,7 @@
 class Application
 {
 public:
-	Application();
+	explicit				Application(const GraphicsSettings& graphics = GraphicsSettings());
 	void					run();
 
 
@@ -39,6 +41,8 @@ private:
 
 	KeyBinding				mKeyBinding1;
 	KeyBinding				mKeyBinding2;
+	Statistics				mStatistics;
+	GraphicsSettings		mGraphics;
 	StateStack				mStateStack;
 
 	sf::Text				mStatisticsText;
@@ -6,6 +6,8 @@
 #include "SoundNode.hpp"
 #include "NetworkNode.hpp"
 #include "ResourceHolder.hpp"
+#include "SpriteBatch.hpp"
+#include "TextureAtlas.hpp"
 
 
 #include <SFML/Graphics/RenderTarget.hpp>
@@ -22,7 +24,7 @@ namespace
 
 Base::Base(baseTeam type, const TextureHolder& textures, const FontHolder& fonts) : Entity(Table[type].hitpoints)
 , mType(type)
-, mSprite(textures.get(Table[type].texture), Table[type].textureRect)
+, mSprite(textures.get(Table[type].texture), TextureAtlas::getRect(Table[type].texture, Table[type].textureRect))
 , mBaseExplosion(textures.get(Textures::Explosion))
 , mShowExplosion(true)
 , mExplosionBegan(false)
@@ -34,7 +36,7 @@ Base::Base(baseTeam type, const TextureHolder& textures, const FontHolder& fonts
 	centerOrigin(mBaseExplosion);
 	centerOrigin(mSprite);
 
-	std::unique_ptr<TextNode> healthDisplay(new TextNode(fonts, ""));
+	std::unique_ptr<LabelNode> healthDisplay(new LabelNode(fonts));
 	mHealthDisplay = healthDisplay.get();
 	mHealthDisplay->setOrigin(0, -180);
 	attachChild(std::move(healthDisplay));
@@ -60,6 +62,28 @@ void Base::drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const
 	}
 }
 
+void Base::batchCurrent(SpriteBatch& batch, sf::RenderStates states) const
+{
+	if (isDestroyed() && mShowExplosion)
+		batch.draw(mBaseExplosion.getSprite(), states.transform * mBaseExplosion.getTransform());
+	else
+		batch.draw(mSprite, states.transform);
+}
+
+sf::FloatRect Base::getDrawBounds() const
+{
+	if (isDestroyed() && mShowExplosion)
+		return mBaseExplosion.getGlobalBounds();
+	else
+		return mSprite.getGlobalBounds();
+}
+
+bool Base::isStatic() const
+{
+	// Until the explosion takes its place
+	return !isDestroyed();
+}
+
 float Base::GetBaseRadius()
 {
 	return (getBoundingRect().width/2);
@@ -142,6 +166,7 @@ void Base::remove()
 {
 	Entity::remove();
 	mShowExplosion = false;
+	markBoundsDirty();
 }
 
 void Base::updateTexts()
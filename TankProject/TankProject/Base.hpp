@@ -6,7 +6,7 @@
 #include "DataTables.hpp"
 #include <SFML/Graphics/RenderTarget.hpp>
 #include <SFML/Graphics/RenderStates.hpp>
-#include "TextNode.hpp"
+#include "LabelNode.hpp"
 #include "Animation.hpp"
 
 #include <SFML/Graphics/Sprite.hpp>
@@ -32,19 +32,22 @@ public:
 	void					playLocalSound(CommandQueue& commands, SoundEffect::ID effect);
 	virtual void			remove();
 	virtual bool 			isMarkedForRemoval() const;
+	virtual bool			isStatic() const;
 	float					GetBaseRadius();
 	baseTeam				mType;
 	sf::Sprite				mSprite;
 
 private:
 	virtual void			drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const;
+	virtual void			batchCurrent(SpriteBatch& batch, sf::RenderStates states) const;
+	virtual sf::FloatRect	getDrawBounds() const;
 	void					updateCurrent(sf::Time dt, CommandQueue& commands);
 	void					updateTexts();
 
 private:
 	
 	
-	TextNode*				mHealthDisplay;
+	LabelNode*				mHealthDisplay;
 	//sf::Vector2f			position;
 
 	Animation				mBaseExplosion;
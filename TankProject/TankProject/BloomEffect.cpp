@@ -1,11 +1,51 @@
 #include "BloomEffect.hpp"
 
+#include <SFML/Graphics/Sprite.hpp>
+
+#include <algorithm>
+
+
+namespace
+{
+	// Resolution of each stage as a divisor of the input size; the brightness pass renders straight
+	// into the blur textures when both are the same
+	struct QualitySettings
+	{
+		unsigned int	brightnessDivisor;
+		unsigned int	blurDivisor;
+		std::size_t		blurIterations;
+	};
+
+	const QualitySettings Settings[BloomEffect::QualityCount] =
+	{
+		{ 0, 0, 0 },	// Off
+		{ 4, 4, 1 },	// Low
+		{ 1, 2, 2 },	// High
+	};
+
+	// A frame is slow when it misses the 60 Hz budget by a quarter; a second with mostly slow frames
+	// lowers the quality. Raising it is tried again after a delay that doubles each time it fails.
+	const sf::Time SlowFrameTime = sf::seconds(1.25f / 60.f);
+	const sf::Time MeasurePeriod = sf::seconds(1.f);
+	const sf::Time UpgradeTrialPeriod = sf::seconds(5.f);
+	const sf::Time MinUpgradeDelay = sf::seconds(5.f);
+	const sf::Time MaxUpgradeDelay = sf::seconds(80.f);
+}
 
 BloomEffect::BloomEffect()
 	: mShaders()
+	, mQuality(High)
+	, mPreparedSize()
+	, mPreparedQuality(Off)
 	, mBrightnessTexture()
-	, mFirstPassTextures()
-	, mSecondPassTextures()
+	, mBlurTextures()
+	, mAdaptive(true)
+	, mMeasuredTime(sf::Time::Zero)
+	, mMeasuredFrames(0)
+	, mSlowFrames(0)
+	, mTimeSinceChange(sf::Time::Zero)
+	, mUpgradeDelay(MinUpgradeDelay)
+	, mUpgraded(false)
 {
 	mShaders.load(Shaders::BrightnessPass, "Media/Shaders/Fullpass.vert", "Media/Shaders/Brightness.frag");
 	mShaders.load(Shaders::DownSamplePass, "Media/Shaders/Fullpass.vert", "Media/Shaders/DownSample.frag");
@@ -15,38 +55,120 @@ BloomEffect::BloomEffect()
 
 void BloomEffect::apply(const sf::RenderTexture& input, sf::RenderTarget& output)
 {
+	// Nothing to add, the scene is only copied
+	if (mQuality == Off)
+	{
+		output.draw(sf::Sprite(input.getTexture()), sf::BlendNone);
+		return;
+	}
+
+	const QualitySettings& settings = Settings[mQuality];
 	prepareTextures(input.getSize());
 
-	filterBright(input, mBrightnessTexture);
+	if (settings.brightnessDivisor == settings.blurDivisor)
+	{
+		filterBright(input, mBlurTextures[0]);
+	}
+	else
+	{
+		filterBright(input, mBrightnessTexture);
+		downsample(mBrightnessTexture, mBlurTextures[0]);
+	}
 
-	downsample(mBrightnessTexture, mFirstPassTextures[0]);
-	blurMultipass(mFirstPassTextures);
+	blurMultipass(mBlurTextures, settings.blurIterations);
+	add(input, mBlurTextures[0], output);
+}
 
-	//downsample(mFirstPassTextures[0], mSecondPassTextures[0]);
-	//blurMultipass(mSecondPassTextures);
+void BloomEffect::setQuality(Quality quality)
+{
+	mQuality = quality;
 
-	add(mFirstPassTextures[0], mSecondPassTextures[0], mFirstPassTextures[1]);
-	mFirstPassTextures[1].display();
-	add(input, mFirstPassTextures[1], output);
+	mMeasuredTime = sf::Time::Zero;
+	mMeasuredFrames = 0;
+	mSlowFrames = 0;
+	mTimeSinceChange = sf::Time::Zero;
+}
+
+BloomEffect::Quality BloomEffect::getQuality() const
+{
+	return mQuality;
+}
+
+void BloomEffect::setAdaptive(bool adaptive)
+{
+	mAdaptive = adaptive;
+}
+
+void BloomEffect::reportFrameTime(sf::Time frameTime)
+{
+	if (!mAdaptive)
+		return;
+
+	mMeasuredTime += frameTime;
+	mMeasuredFrames += 1;
+	mTimeSinceChange += frameTime;
+	if (frameTime > SlowFrameTime)
+		mSlowFrames += 1;
+
+	if (mMeasuredTime < MeasurePeriod)
+		return;
+
+	bool slow = mSlowFrames * 2 > mMeasuredFrames;
+	mMeasuredTime = sf::Time::Zero;
+	mMeasuredFrames = 0;
+	mSlowFrames = 0;
+
+	if (slow && mQuality > Off)
+	{
+		// The last upgrade did not hold, wait longer before the next one
+		if (mUpgraded)
+			mUpgradeDelay = std::min(mUpgradeDelay * 2.f, MaxUpgradeDelay);
+
+		setQuality(static_cast<Quality>(mQuality - 1));
+		mUpgraded = false;
+	}
+	else if (!slow && mQuality < High && mTimeSinceChange >= mUpgradeDelay)
+	{
+		setQuality(static_cast<Quality>(mQuality + 1));
+		mUpgraded = true;
+	}
+	else if (mUpgraded && mTimeSinceChange >= UpgradeTrialPeriod)
+	{
+		mUpgraded = false;
+		mUpgradeDelay = MinUpgradeDelay;
+	}
 }
 
 void BloomEffect::prepareTextures(sf::Vector2u size)
 {
-	if (mBrightnessTexture.getSize() != size)
+	if (mPreparedSize == size && mPreparedQuality == mQuality)
+		return;
+
+	const QualitySettings& settings = Settings[mQuality];
+
+	// Textures are kept when their size still fits, creating one is expensive
+	if (settings.brightnessDivisor != settings.blurDivisor)
 	{
-		mBrightnessTexture.create(size.x, size.y);
-		mBrightnessTexture.setSmooth(true);
-
-		mFirstPassTextures[0].create(size.x / 2, size.y / 2);
-		mFirstPassTextures[0].setSmooth(true);
-		mFirstPassTextures[1].create(size.x / 2, size.y / 2);
-		mFirstPassTextures[1].setSmooth(true);
-
-		mSecondPassTextures[0].create(size.x / 4, size.y / 4);
-		mSecondPassTextures[0].setSmooth(true);
-		mSecondPassTextures[1].create(size.x / 4, size.y / 4);
-		mSecondPassTextures[1].setSmooth(true);
+		sf::Vector2u brightnessSize = size / settings.brightnessDivisor;
+		if (mBrightnessTexture.getSize() != brightnessSize)
+		{
+			mBrightnessTexture.create(brightnessSize.x, brightnessSize.y);
+			mBrightnessTexture.setSmooth(true);
+		}
 	}
+
+	sf::Vector2u blurSize = size / settings.blurDivisor;
+	for (std::size_t i = 0; i < mBlurTextures.size(); ++i)
+	{
+		if (mBlurTextures[i].getSize() != blurSize)
+		{
+			mBlurTextures[i].create(blurSize.x, blurSize.y);
+			mBlurTextures[i].setSmooth(true);
+		}
+	}
+
+	mPreparedSize = size;
+	mPreparedQuality = mQuality;
 }
 
 void BloomEffect::filterBright(const sf::RenderTexture& input, sf::RenderTexture& output)
@@ -58,11 +180,11 @@ void BloomEffect::filterBright(const sf::RenderTexture& input, sf::RenderTexture
 	output.display();
 }
 
-void BloomEffect::blurMultipass(RenderTextureArray& renderTextures)
+void BloomEffect::blurMultipass(RenderTextureArray& renderTextures, std::size_t iterations)
 {
 	sf::Vector2u textureSize = renderTextures[0].getSize();
 
-	for (std::size_t count = 0; count < 2; ++count)
+	for (std::size_t count = 0; count < iterations; ++count)
 	{
 		blur(renderTextures[0], renderTextures[1], sf::Vector2f(0.f, 1.f / textureSize.y));
 		blur(renderTextures[1], renderTextures[0], sf::Vector2f(1.f / textureSize.x, 0.f));
@@ -3,6 +3,7 @@
 #include "ResourceIdentifiers.hpp"
 #include "ResourceHolder.hpp"
 
+#include <SFML/System/Time.hpp>
 #include <SFML/Graphics/RenderTexture.hpp>
 #include <SFML/Graphics/Shader.hpp>
 
@@ -11,11 +12,28 @@
 
 class BloomEffect : public PostEffect
 {
+public:
+	enum Quality
+	{
+		Off,
+		Low,		// brightness extracted straight at quarter resolution, one blur
+		High,		// brightness at full resolution, downsampled to half, two blurs
+		QualityCount
+	};
+
+
 public:
 	BloomEffect();
 
 	virtual void		apply(const sf::RenderTexture& input, sf::RenderTarget& output);
 
+	void				setQuality(Quality quality);
+	Quality				getQuality() const;
+
+	// When adaptive, the quality follows the frame times passed to reportFrameTime()
+	void				setAdaptive(bool adaptive);
+	void				reportFrameTime(sf::Time frameTime);
+
 
 private:
 	typedef std::array<sf::RenderTexture, 2> RenderTextureArray;
@@ -25,7 +43,7 @@ private:
 	void				prepareTextures(sf::Vector2u size);
 
 	void				filterBright(const sf::RenderTexture& input, sf::RenderTexture& output);
-	void				blurMultipass(RenderTextureArray& renderTextures);
+	void				blurMultipass(RenderTextureArray& renderTextures, std::size_t iterations);
 	void				blur(const sf::RenderTexture& input, sf::RenderTexture& output, sf::Vector2f offsetFactor);
 	void				downsample(const sf::RenderTexture& input, sf::RenderTexture& output);
 	void				add(const sf::RenderTexture& source, const sf::RenderTexture& bloom, sf::RenderTarget& target);
@@ -34,7 +52,17 @@ private:
 private:
 	ShaderHolder		mShaders;
 
+	Quality				mQuality;
+	sf::Vector2u		mPreparedSize;
+	Quality				mPreparedQuality;
 	sf::RenderTexture	mBrightnessTexture;
-	RenderTextureArray	mFirstPassTextures;
-	RenderTextureArray	mSecondPassTextures;
+	RenderTextureArray	mBlurTextures;
+
+	bool				mAdaptive;
+	sf::Time			mMeasuredTime;
+	std::size_t			mMeasuredFrames;
+	std::size_t			mSlowFrames;
+	sf::Time			mTimeSinceChange;
+	sf::Time			mUpgradeDelay;
+	bool				mUpgraded;
 };
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include "ClientNetworkThread.hpp"
+
+#include <SFML/Network/SocketSelector.hpp>
+#include <SFML/System/Sleep.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+
+NetworkMessage::NetworkMessage()
+	: type(-1)
+	, packet()
+	, receivedAt(sf::Time::Zero)
+{
+}
+
+ClientNetworkThread::ClientNetworkThread()
+	: mThread(&ClientNetworkThread::executionThread, this)
+	, mSocket()
+	, mClock()
+	, mAddress()
+	, mPort(0)
+	, mConnectTimeout(sf::Time::Zero)
+	, mGreeting()
+	, mConnecting(false)
+	, mConnected(false)
+	, mWaitingThreadEnd(false)
+	, mVerbose(false)
+	, mIncoming()
+	, mOutgoing()
+	, mDroppedPackets(0)
+	, mSimulator(NetworkSimulator::ClientSide)
+	, mPendingPacket()
+	, mHasPendingPacket(false)
+{
+	// Optional impairment script for testing on loopback
+	if (mSimulator.loadScript("netsim.txt") && mSimulator.isEnabled())
+		std::cout << "Network: simulating link conditions from netsim.txt" << std::endl;
+}
+
+ClientNetworkThread::~ClientNetworkThread()
+{
+	mWaitingThreadEnd = true;
+	mThread.wait();
+
+	reportDroppedPackets();
+}
+
+void ClientNetworkThread::connect(const sf::IpAddress& address, unsigned short port, sf::Time timeout, const sf::Packet& greeting)
+{
+	mAddress = address;
+	mPort = port;
+	mConnectTimeout = timeout;
+	mGreeting = greeting;
+
+	mConnecting = true;
+	mThread.launch();
+}
+
+bool ClientNetworkThread::isConnecting() const
+{
+	return mConnecting;
+}
+
+bool ClientNetworkThread::isConnected() const
+{
+	return mConnected;
+}
+
+void ClientNetworkThread::disconnect()
+{
+	mWaitingThreadEnd = true;
+	mThread.wait();
+	mWaitingThreadEnd = false;
+
+	mConnecting = false;
+	mConnected = false;
+	mHasPendingPacket = false;
+	reportDroppedPackets();
+
+	// The network thread is stopped, so the game thread may empty its side of the queue;
+	// received messages stay for the game to read
+	sf::Packet packet;
+	while (mOutgoing.pop(packet))
+		;
+
+	mSimulator.removePeer(0);
+}
+
+void ClientNetworkThread::setVerbose(bool verbose)
+{
+	mVerbose = verbose;
+}
+
+void ClientNetworkThread::send(const sf::Packet& packet)
+{
+	if (!mConnected)
+		return;
+
+	// Only happens if the network thread stalls for several seconds; better to lose a packet than the frame
+	if (!mOutgoing.push(packet))
+	{
+		++mDroppedPackets;
+		if (mVerbose)
+			std::cout << "Network: outgoing queue full, " << mDroppedPackets << " packets dropped" << std::endl;
+	}
+}
+
+bool ClientNetworkThread::poll(NetworkMessage& message)
+{
+	return mIncoming.pop(message);
+}
+
+sf::Time ClientNetworkThread::now() const
+{
+	return mClock.getElapsedTime();
+}
+
+void ClientNetworkThread::executionThread()
+{
+	if (!establishConnection())
+	{
+		std::cout << "Network: could not connect to " << mAddress << ":" << mPort << std::endl;
+		mConnecting = false;
+		return;
+	}
+
+	sf::SocketSelector selector;
+	selector.add(mSocket);
+
+	while (!mWaitingThreadEnd && mConnected)
+	{
+		// Wake up at least every few milliseconds to flush outgoing packets
+		if (selector.wait(sf::milliseconds(2)))
+			receivePackets();
+
+		sendPackets();
+	}
+
+	// Flush whatever the game queued last (e.g. the Quit message) before closing
+	sendPackets();
+	mSocket.disconnect();
+}
+
+bool ClientNetworkThread::establishConnection()
+{
+	sf::Clock clock;
+
+	// Short attempts, so that cancelling (destruction) never waits on a long connect
+	while (!mWaitingThreadEnd)
+	{
+		sf::Time remaining = mConnectTimeout - clock.getElapsedTime();
+		if (remaining <= sf::Time::Zero)
+			return false;
+
+		sf::Time slice = std::min(remaining, sf::milliseconds(ConnectSliceMilliseconds));
+		if (mSocket.connect(mAddress, mPort, slice) == sf::Socket::Done)
+		{
+			// Like every other socket of the game; the selector wakes the thread when there is something to read
+			mSocket.setBlocking(false);
+			mHasPendingPacket = false;
+
+			// The greeting may go out partly and be finished by the first sendPackets()
+			sf::Packet greeting = mGreeting;
+			if (transmit(greeting) || mHasPendingPacket)
+			{
+				// Set before clearing mConnecting, so the game thread never sees neither
+				mConnected = true;
+				mConnecting = false;
+				return true;
+			}
+		}
+
+		// Refused at once: most likely the server is still starting
+		if (mVerbose)
+			std::cout << "Network: connection attempt to " << mAddress << ":" << mPort << " failed, retrying" << std::endl;
+		sf::sleep(sf::milliseconds(ConnectRetryMilliseconds));
+	}
+
+	return false;
+}
+
+void ClientNetworkThread::receivePackets()
+{
+	// Everything that has fully arrived; the socket keeps a partly received packet until the rest comes
+	sf::Packet packet;
+	sf::Socket::Status status;
+	while ((status = mSocket.receive(packet)) == sf::Socket::Done)
+	{
+		if (!mSimulator.submit(0, NetworkSimulator::Incoming, packet, now()))
+			deliver(packet);
+	}
+
+	if (status == sf::Socket::Disconnected || status == sf::Socket::Error)
+	{
+		if (mVerbose)
+			std::cout << "Network: " << (status == sf::Socket::Error ? "socket error while receiving" : "server closed the connection") << std::endl;
+		mConnected = false;
+	}
+}
+
+void ClientNetworkThread::sendPackets()
+{
+	sf::Packet packet;
+
+	// Finish the packet the socket took only part of before anything else, or the stream breaks
+	if (mHasPendingPacket)
+	{
+		mHasPendingPacket = false;
+		packet = mPendingPacket;
+		if (!transmit(packet))
+			return;
+	}
+
+	while (mOutgoing.pop(packet))
+	{
+		if (!mSimulator.submit(0, NetworkSimulator::Outgoing, packet, now()) && !transmit(packet))
+			return;
+	}
+
+	// Packets the simulator has finished delaying, in both directions
+	while (mSimulator.poll(0, NetworkSimulator::Outgoing, packet, now()))
+	{
+		if (!transmit(packet))
+			return;
+	}
+
+	while (mSimulator.poll(0, NetworkSimulator::Incoming, packet, now()))
+		deliver(packet);
+}
+
+void ClientNetworkThread::deliver(sf::Packet& packet)
+{
+	NetworkMessage message;
+	message.packet = packet;
+	message.receivedAt = now();
+	message.packet >> message.type;
+
+	// The game thread drains the queue every frame; if it falls behind, wait for it rather than lose state
+	while (!mIncoming.push(message) && !mWaitingThreadEnd)
+		sf::sleep(sf::milliseconds(1));
+}
+
+bool ClientNetworkThread::transmit(sf::Packet& packet)
+{
+	sf::Socket::Status status = mSocket.send(packet);
+	if (status == sf::Socket::Done)
+		return true;
+
+	// The socket buffer is full; the packet remembers how much of it went out
+	if (status == sf::Socket::Partial || status == sf::Socket::NotReady)
+	{
+		mPendingPacket = packet;
+		mHasPendingPacket = true;
+		return false;
+	}
+
+	if (mVerbose)
+		std::cout << "Network: " << (status == sf::Socket::Error ? "socket error while sending" : "server closed the connection") << std::endl;
+	mConnected = false;
+	return false;
+}
+
+void ClientNetworkThread::reportDroppedPackets()
+{
+	// Game thread only, like the count itself
+	if (mDroppedPackets > 0 && !mVerbose)
+		std::cout << "Network: outgoing queue was full, " << mDroppedPackets << " packets dropped" << std::endl;
+
+	mDroppedPackets = 0;
+}
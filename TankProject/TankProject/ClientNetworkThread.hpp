@@ -0,0 +1,94 @@
+#pragma once
+
+#include "SpscQueue.hpp"
+#include "NetworkSimulator.hpp"
+
+#include <SFML/System/Thread.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/Network/TcpSocket.hpp>
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/Network/Packet.hpp>
+
+#include <atomic>
+
+
+// A message received from the server, with its packet type already read
+struct NetworkMessage
+{
+	NetworkMessage();
+
+	sf::Int32				type;
+	sf::Packet				packet;
+	sf::Time				receivedAt;		// on the ClientNetworkThread clock, see now()
+};
+
+// Owns the client's connection to the server and does all socket I/O on its own thread.
+// The game thread exchanges messages with it through lock-free queues and never waits on the network.
+class ClientNetworkThread : private sf::NonCopyable
+{
+public:
+							ClientNetworkThread();
+							~ClientNetworkThread();
+
+	// Returns at once; the network thread keeps trying until the timeout. A refused attempt is
+	// retried, so a client can start connecting before a local server listens.
+	// The greeting is the first packet sent on the new connection.
+	void					connect(const sf::IpAddress& address, unsigned short port, sf::Time timeout, const sf::Packet& greeting);
+	bool					isConnecting() const;
+	bool					isConnected() const;
+
+	// Stops the network thread and drops anything not yet sent, so that connect() can be called again
+	void					disconnect();
+
+	// Verbose logging reports every failed connection attempt, dropped packet and socket failure;
+	// otherwise only failures to connect are, and dropped packets once per connection
+	void					setVerbose(bool verbose);
+
+	// Game thread side
+	void					send(const sf::Packet& packet);
+	bool					poll(NetworkMessage& message);
+	sf::Time				now() const;
+
+
+private:
+	static const std::size_t	QueueCapacity = 1024;
+	static const sf::Int32		ConnectSliceMilliseconds = 250;
+	static const sf::Int32		ConnectRetryMilliseconds = 50;
+
+
+private:
+	void					executionThread();
+	bool					establishConnection();
+	void					receivePackets();
+	void					sendPackets();
+	void					deliver(sf::Packet& packet);
+	bool					transmit(sf::Packet& packet);
+	void					reportDroppedPackets();
+
+
+private:
+	sf::Thread									mThread;
+	sf::TcpSocket								mSocket;
+	sf::Clock									mClock;
+
+	sf::IpAddress								mAddress;
+	unsigned short								mPort;
+	sf::Time									mConnectTimeout;
+	sf::Packet									mGreeting;
+
+	std::atomic<bool>							mConnecting;
+	std::atomic<bool>							mConnected;
+	std::atomic<bool>							mWaitingThreadEnd;
+	std::atomic<bool>							mVerbose;
+
+	SpscQueue<NetworkMessage, QueueCapacity>	mIncoming;
+	SpscQueue<sf::Packet, QueueCapacity>		mOutgoing;
+	std::size_t									mDroppedPackets;
+
+	// Only touched by the network thread once it runs
+	NetworkSimulator							mSimulator;
+	sf::Packet									mPendingPacket;		// the rest of a partly sent packet
+	bool										mHasPendingPacket;
+};
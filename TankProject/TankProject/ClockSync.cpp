@@ -0,0 +1,82 @@
+#include "ClockSync.hpp"
+
+#include <algorithm>
+
+
+const std::size_t ClockSync::SampleCount;
+
+ClockSync::ClockSync(sf::Time serverTickInterval)
+	: mServerTickInterval(serverTickInterval)
+	, mSamples()
+	, mSampleCount(0)
+	, mNextSample(0)
+	, mOffset(sf::Time::Zero)
+	, mRoundTripTime(sf::Time::Zero)
+	, mJitter(sf::Time::Zero)
+	, mTickPhase(0.f)
+{
+}
+
+void ClockSync::onPong(sf::Time clientSendTime, sf::Time serverTime, sf::Uint32 serverTick, sf::Time clientReceiveTime)
+{
+	sf::Time roundTripTime = clientReceiveTime - clientSendTime;
+	if (roundTripTime < sf::Time::Zero)
+		return;
+
+	// Assume the reply took half the round trip to come back
+	Sample sample;
+	sample.roundTripTime = roundTripTime;
+	sample.offset = serverTime + roundTripTime / 2.f - clientReceiveTime;
+
+	// Smoothed RTT and its mean deviation, with the gains TCP uses (1/8 and 1/4)
+	if (mSampleCount == 0)
+	{
+		mRoundTripTime = roundTripTime;
+		mJitter = roundTripTime / 2.f;
+	}
+	else
+	{
+		sf::Time deviation = roundTripTime - mRoundTripTime;
+		if (deviation < sf::Time::Zero)
+			deviation = -deviation;
+
+		mJitter += (deviation - mJitter) / 4.f;
+		mRoundTripTime += (roundTripTime - mRoundTripTime) / 8.f;
+	}
+
+	mSamples[mNextSample] = sample;
+	mNextSample = (mNextSample + 1) % SampleCount;
+	mSampleCount = std::min(mSampleCount + 1, SampleCount);
+
+	// Queuing delay only ever adds to the round trip, so the fastest sample has the least skewed offset
+	auto best = std::min_element(mSamples.begin(), mSamples.begin() + mSampleCount,
+		[](const Sample& lhs, const Sample& rhs) { return lhs.roundTripTime < rhs.roundTripTime; });
+	mOffset = best->offset;
+
+	mTickPhase = serverTick - serverTime / mServerTickInterval;
+}
+
+bool ClockSync::isSynchronized() const
+{
+	return mSampleCount > 0;
+}
+
+sf::Time ClockSync::getRoundTripTime() const
+{
+	return mRoundTripTime;
+}
+
+sf::Time ClockSync::getJitter() const
+{
+	return mJitter;
+}
+
+sf::Time ClockSync::getServerTime(sf::Time localTime) const
+{
+	return localTime + mOffset;
+}
+
+float ClockSync::getServerTick(sf::Time localTime) const
+{
+	return getServerTime(localTime) / mServerTickInterval + mTickPhase;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <SFML/System/Time.hpp>
+#include <SFML/Config.hpp>
+
+#include <array>
+
+
+// Estimates the round-trip time to the server and the offset between the server clock and a
+// local clock from ping/pong timestamps, the way NTP does: of the recent samples, the one with
+// the lowest round-trip time gives the most trustworthy offset.
+class ClockSync
+{
+public:
+	explicit				ClockSync(sf::Time serverTickInterval);
+
+	void					onPong(sf::Time clientSendTime, sf::Time serverTime, sf::Uint32 serverTick, sf::Time clientReceiveTime);
+
+	bool					isSynchronized() const;
+	sf::Time				getRoundTripTime() const;
+	sf::Time				getJitter() const;
+
+	sf::Time				getServerTime(sf::Time localTime) const;
+	float					getServerTick(sf::Time localTime) const;
+
+
+private:
+	static const std::size_t	SampleCount = 8;
+
+	struct Sample
+	{
+		sf::Time			roundTripTime;
+		sf::Time			offset;
+	};
+
+
+private:
+	sf::Time								mServerTickInterval;
+	std::array<Sample, SampleCount>			mSamples;
+	std::size_t								mSampleCount;
+	std::size_t								mNextSample;
+
+	sf::Time								mOffset;
+	sf::Time								mRoundTripTime;
+	sf::Time								mJitter;
+
+	// Server tick minus (server time / tick interval); the server's ticks don't start at exactly zero
+	float									mTickPhase;
+};
@@ -1,16 +1,18 @@
 #include "CommandQueue.hpp"
 #include "SceneNode.hpp"
 
+#include <algorithm>
+
 
 void CommandQueue::push(const Command& command)
 {
-	mQueue.push(command);
+	mQueue.push_back(command);
 }
 
 Command CommandQueue::pop()
 {
 	Command command = mQueue.front();
-	mQueue.pop();
+	mQueue.pop_front();
 	return command;
 }
 
@@ -18,3 +20,15 @@ bool CommandQueue::isEmpty() const
 {
 	return mQueue.empty();
 }
+
+std::size_t CommandQueue::copyTo(Command* out, std::size_t capacity) const
+{
+	std::size_t count = std::min(capacity, mQueue.size());
+	std::copy(mQueue.begin(), mQueue.begin() + count, out);
+	return count;
+}
+
+void CommandQueue::clear()
+{
+	mQueue.clear();
+}
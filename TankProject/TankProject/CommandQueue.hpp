@@ -3,7 +3,7 @@
 
 #include "Command.hpp"
 
-#include <queue>
+#include <deque>
 
 
 class CommandQueue
@@ -13,9 +13,13 @@ class CommandQueue
 		Command						pop();
 		bool						isEmpty() const;
 
+		// Copies up to capacity pending commands, oldest first, without consuming them
+		std::size_t					copyTo(Command* out, std::size_t capacity) const;
+		void						clear();
+
 		
 	private:
-		std::queue<Command>			mQueue;
+		std::deque<Command>			mQueue;
 };
 
 #endif // BOOK_COMMANDQUEUE_HPP
@@ -0,0 +1,166 @@
+#include "Compression.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstring>
+
+
+namespace
+{
+	const std::size_t MinMatch = 4;
+	const std::size_t MaxOffset = 65535;
+	const unsigned int HashBits = 12;
+
+	unsigned int read32(const char* data)
+	{
+		unsigned int value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	unsigned int hash(unsigned int sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	void writeLength(std::size_t length, std::vector<char>& output)
+	{
+		while (length >= 255)
+		{
+			output.push_back(static_cast<char>(255));
+			length -= 255;
+		}
+
+		output.push_back(static_cast<char>(length));
+	}
+
+	void writeSequence(const char* literals, std::size_t literalCount, std::size_t offset, std::size_t matchLength, std::vector<char>& output)
+	{
+		std::size_t matchCode = matchLength >= MinMatch ? matchLength - MinMatch : 0;
+
+		unsigned char token = static_cast<unsigned char>((literalCount < 15 ? literalCount : 15) << 4);
+		token |= static_cast<unsigned char>(matchCode < 15 ? matchCode : 15);
+		output.push_back(static_cast<char>(token));
+
+		if (literalCount >= 15)
+			writeLength(literalCount - 15, output);
+
+		output.insert(output.end(), literals, literals + literalCount);
+
+		// The last sequence stops after its literals
+		if (matchLength == 0)
+			return;
+
+		output.push_back(static_cast<char>(offset & 0xFF));
+		output.push_back(static_cast<char>(offset >> 8));
+
+		if (matchCode >= 15)
+			writeLength(matchCode - 15, output);
+	}
+
+	bool readLength(const unsigned char*& input, const unsigned char* end, std::size_t& length)
+	{
+		unsigned char byte;
+		do
+		{
+			if (input == end)
+				return false;
+
+			byte = *input++;
+			length += byte;
+		}
+		while (byte == 255);
+
+		return true;
+	}
+}
+
+void compressBlock(const char* data, std::size_t size, std::vector<char>& output)
+{
+	assert(size <= MaxBlockSize);
+
+	// Position + 1 of the last occurrence of each hashed 4 byte sequence, 0 for none
+	std::array<std::size_t, 1 << HashBits> table;
+	table.fill(0);
+
+	std::size_t anchor = 0;
+	std::size_t position = 0;
+
+	while (position + MinMatch <= size)
+	{
+		unsigned int sequence = read32(data + position);
+		std::size_t& entry = table[hash(sequence)];
+		std::size_t candidate = entry;
+		entry = position + 1;
+
+		if (candidate == 0 || position - (candidate - 1) > MaxOffset || read32(data + candidate - 1) != sequence)
+		{
+			++position;
+			continue;
+		}
+
+		std::size_t match = candidate - 1;
+		std::size_t length = MinMatch;
+		while (position + length < size && data[match + length] == data[position + length])
+			++length;
+
+		writeSequence(data + anchor, position - anchor, position - match, length, output);
+
+		position += length;
+		anchor = position;
+	}
+
+	writeSequence(data + anchor, size - anchor, 0, 0, output);
+}
+
+bool decompressBlock(const char* data, std::size_t size, std::size_t uncompressedSize, std::vector<char>& output)
+{
+	output.clear();
+	if (uncompressedSize > MaxBlockSize)
+		return false;
+
+	output.reserve(uncompressedSize);
+
+	const unsigned char* input = reinterpret_cast<const unsigned char*>(data);
+	const unsigned char* end = input + size;
+
+	while (input != end)
+	{
+		unsigned char token = *input++;
+
+		std::size_t literalCount = token >> 4;
+		if (literalCount == 15 && !readLength(input, end, literalCount))
+			return false;
+
+		if (literalCount > static_cast<std::size_t>(end - input) || literalCount > uncompressedSize - output.size())
+			return false;
+
+		output.insert(output.end(), input, input + literalCount);
+		input += literalCount;
+
+		// Last sequence
+		if (input == end)
+			break;
+
+		if (end - input < 2)
+			return false;
+
+		std::size_t offset = input[0] | (input[1] << 8);
+		input += 2;
+
+		std::size_t matchLength = token & 0x0F;
+		if (matchLength == 15 && !readLength(input, end, matchLength))
+			return false;
+
+		matchLength += MinMatch;
+		if (offset == 0 || offset > output.size() || matchLength > uncompressedSize - output.size())
+			return false;
+
+		// Byte by byte: a match may overlap the bytes it produces
+		std::size_t source = output.size() - offset;
+		for (std::size_t i = 0; i < matchLength; ++i)
+			output.push_back(output[source + i]);
+	}
+
+	return output.size() == uncompressedSize;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+
+// Small LZ77 block codec in the spirit of LZ4: a block is a run of sequences, each a token byte
+// (literal count in the high nibble, match length - 4 in the low one, 15 meaning "more bytes
+// follow"), the literals, a 2 byte little endian match offset and the rest of the match length.
+// The last sequence has literals only. Fast to compress, faster to decompress, and good on the
+// repetitive records the game sends.
+
+// Largest block either side handles; the sizes of untrusted blocks are checked against it before
+// anything is allocated
+const std::size_t		MaxBlockSize = 64 * 1024;
+
+// Appends the compressed form of data to output; at most MaxBlockSize bytes of it
+void					compressBlock(const char* data, std::size_t size, std::vector<char>& output);
+
+// Replaces output with the decompressed block. The uncompressed size must be known; untrusted input
+// is safe, anything malformed, larger than MaxBlockSize or not decompressing to exactly that size
+// returns false.
+bool					decompressBlock(const char* data, std::size_t size, std::size_t uncompressedSize, std::vector<char>& output);
@@ -193,9 +193,11 @@ std::vector<ParticleData> initializeParticleData()
 
 	data[Particle::Propellant].color = sf::Color(255, 255, 50);
 	data[Particle::Propellant].lifetime = sf::seconds(0.6f);
+	data[Particle::Propellant].capacity = 1024;
 
 	data[Particle::Smoke].color = sf::Color(50, 50, 50);
 	data[Particle::Smoke].lifetime = sf::seconds(4.f);
+	data[Particle::Smoke].capacity = 4096;
 
 	return data;
 }
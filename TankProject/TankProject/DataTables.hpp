@@ -79,6 +79,7 @@ struct ParticleData
 {
 	sf::Color						color;
 	sf::Time						lifetime;
+	std::size_t						capacity;		// particles alive at once in a ParticleNode
 };
 
 std::vector<TankData> initializeTankData();
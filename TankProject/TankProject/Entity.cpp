@@ -53,6 +53,13 @@ void Entity::setHitpoints(int points)
 {
 	assert(points > 0);
 	mHitpoints = points;
+	markBoundsDirty();
+}
+
+void Entity::restoreHitpoints(int points)
+{
+	mHitpoints = points;
+	markBoundsDirty();
 }
 
 void Entity::repair(int points)
@@ -60,17 +67,21 @@ void Entity::repair(int points)
 	assert(points > 0);
 
 	mHitpoints += points;
+	markBoundsDirty();
 }
 
 void Entity::damage(int points)
 {
 	assert(points > 0);
+	// Destroyed tanks and bases draw their explosion instead
 	mHitpoints -= points;
+	markBoundsDirty();
 }
 
 void Entity::destroy()
 {
 	mHitpoints = 0;
+	markBoundsDirty();
 }
 
 void Entity::remove()
@@ -12,6 +12,8 @@ public:
 
 	int getHitpoints() const;
 	void setHitpoints(int points);
+	// For snapshot restores only: a saved entity may be destroyed and still waiting for removal
+	void restoreHitpoints(int points);
 	void repair(int points);
 	void damage(int point);
 	void destroy();
@@ -1,36 +1,158 @@
 #include "GameServer.hpp"
 #include "NetworkProtocol.hpp"
 #include "Foreach.hpp"
-#include "Utility.hpp"
-#include "Pickup.hpp"
-#include "Tank.hpp"
+#include "Compression.hpp"
+#include "StringHelpers.hpp"
 
 #include <SFML/Network/Packet.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+
+namespace
+{
+	// Extra time allowed on top of the measured interval, to absorb network and scheduling jitter
+	const sf::Time MovementSlack = sf::seconds(0.25f);
+
+	// A lockstep tick goes out without the inputs still missing after this long, even if none arrived at all;
+	// those tanks repeat their last input
+	const sf::Time LockstepInputTimeout = sf::seconds(0.25f);
+
+	// Checksums are kept this many ticks for comparison
+	const sf::Uint32 ChecksumHistory = 600;
+
+	// How long the tanks of a dropped peer wait for it to reconnect
+	const sf::Time ResumeGracePeriod = sf::seconds(10.f);
+
+	// The world state goes to a joining client in chunks of at most this many uncompressed bytes, a few
+	// per tick, so that a large world does not hold up the live traffic queued behind it
+	const std::size_t WorldStateChunkSize = 1024;
+	const std::size_t WorldStateChunksPerTick = 2;
+
+	const sf::Time StepInterval = sf::seconds(1.f / 60.f);
+
+	GameServer::Settings makeSettings(sf::Vector2f battlefieldSize, GameServer::Mode mode)
+	{
+		GameServer::Settings settings;
+		settings.battlefieldSize = battlefieldSize;
+		settings.mode = mode;
+		return settings;
+	}
+}
+
+GameServer::Settings::Settings()
+	: battlefieldSize(1024.f, 768.f)
+	, mode(Networked)
+	, port(ServerPort)
+	, maxPlayers(16)
+	, tickRate(ServerTickRate)
+	, seed(std::random_device()())
+	, sessionSeed(std::random_device()())
+{
+}
+
+GameServer::Statistics::Statistics()
+	: ticks(0)
+	, totalTickTime(sf::Time::Zero)
+	, worstTickTime(sf::Time::Zero)
+	, outboundPackets(0)
+	, outboundBytes(0)
+{
+}
+
 GameServer::RemotePeer::RemotePeer()
-	: ready(false)
+	: connectionNumber(0)
+	, sessionToken(0)
+	, connected(false)
+	, ready(false)
+	, spectator(false)
 	, timedOut(false)
+	, quit(false)
 {
 	socket.setBlocking(false);
 }
 
-GameServer::GameServer(sf::Vector2f battlefieldSize)
+GameServer::TankInfo::TankInfo()
+	: isLiberator(false)
+	, position()
+	, tankRotation(0.f)
+	, turretRotation(0.f)
+	, hitpoints(0)
+	, missileAmmo(0)
+	, lastInputSequence(0)
+	, lastFrameSequence(0)
+	, frameActions()
+	, lastUpdateTime(sf::Time::Zero)
+{
+}
+
+GameServer::GameServer(sf::Vector2f battlefieldSize, Mode mode)
+	: GameServer(makeSettings(battlefieldSize, mode))
+{
+}
+
+GameServer::GameServer(const Settings& settings)
 	: mThread(&GameServer::executionThread, this)
+	, mMode(settings.mode)
+	, mPort(settings.port)
+	, mTickInterval(sf::seconds(1.f / std::max(settings.tickRate, 1u)))
+	, mClock()
+	, mVirtualTime(sf::Time::Zero)
+	, mLastUpdateTime(sf::Time::Zero)
+	, mStepTime(sf::Time::Zero)
+	, mTickTime(sf::Time::Zero)
 	, mListeningState(false)
 	, mClientTimeoutTime(sf::seconds(3.f))
-	, mMaxConnectedPlayers(16)
+	, mMaxConnectedPlayers(std::max<std::size_t>(settings.maxPlayers, 1))
 	, mConnectedPlayers(0)
-	, mBattleFieldRect(0.f, 0.f, battlefieldSize.x, battlefieldSize.y)
+	, mBattleFieldRect(0.f, 0.f, settings.battlefieldSize.x, settings.battlefieldSize.y)
 	, mBattleFieldScrollSpeed(-50.f)
 	, mTankCount(0)
 	, mPeers(1)
 	, mTankIdentifierCounter(1)
 	, mWaitingThreadEnd(false)
+	, mTick(0)
+	, mConnectionCounter(0)
+	, mSimulator(NetworkSimulator::ServerSide)
+	, mRecorder()
+	, mStatistics()
+	, mSuspendedSessions()
+	, mTokenGenerator(settings.sessionSeed)
+	, mRandomEngine(settings.seed)
+	, mRollbackRunning(false)
+	, mLockstepRunning(false)
+	, mLockstepTick(0)
+	, mLockstepTanks()
+	, mLockstepInputs()
+	, mLastLockstepInputs()
+	, mLastBundleTime(sf::Time::Zero)
+	, mLockstepChecksums()
+	, mDesyncReported(false)
 	, mLastSpawnTime(sf::Time::Zero)
 	, mTimeForNextSpawn(sf::seconds(5.f))
 {
 	mListenerSocket.setBlocking(false);
 	mPeers[0].reset(new RemotePeer());
+
+	// A replay gets its packets as they were captured, impairments included
+	if (mMode == Headless)
+		return;
+
+	// Optional impairment script for testing on loopback
+	mSimulator.loadScript("netsim.txt");
+
+	// Optional capture of all incoming traffic, for replaying with --replay
+	std::ifstream captureSettings("servercapture.txt");
+	std::string captureFile;
+	CaptureSeeds seeds;
+	seeds.pickupSeed = settings.seed;
+	seeds.sessionSeed = settings.sessionSeed;
+	if (captureSettings >> captureFile && mRecorder.open(captureFile, seeds))
+		std::cout << "Capture: recording incoming packets to " << captureFile << std::endl;
+
 	mThread.launch();
 }
 
@@ -40,36 +162,17 @@ GameServer::~GameServer()
 	mThread.wait();
 }
 
-void GameServer::notifyPlayerRealtimeChange(sf::Int32 tankIdentifier, sf::Int32 action, bool actionEnabled)
-{
-	for (std::size_t i = 0; i < mConnectedPlayers; ++i)
-	{
-		if (mPeers[i]->ready)
-		{
-			sf::Packet packet;
-			packet << static_cast<sf::Int32>(Server::PlayerRealtimeChange);
-			packet << tankIdentifier;
-			packet << action;
-			packet << actionEnabled;
-
-			mPeers[i]->socket.send(packet);
-		}
-	}
-}
-
 void GameServer::notifyPlayerEvent(sf::Int32 tankIdentifier, sf::Int32 action)
 {
+	PlayerEventMessage message;
+	message.identifier = tankIdentifier;
+	message.action = action;
+	sf::Packet packet = Schema::makePacket(message);
+
 	for (std::size_t i = 0; i < mConnectedPlayers; ++i)
 	{
 		if (mPeers[i]->ready)
-		{
-			sf::Packet packet;
-			packet << static_cast<sf::Int32>(Server::PlayerEvent);
-			packet << tankIdentifier;
-			packet << action;
-
-			mPeers[i]->socket.send(packet);
-		}
+			sendToPeer(*mPeers[i], packet);
 	}
 }
 
@@ -79,15 +182,11 @@ void GameServer::notifyPlayerSpawn(sf::Int32 tankIdentifier)
 	{
 		if (mPeers[i]->ready)
 		{
-			sf::Packet packet;
-			packet << static_cast<sf::Int32>(Server::PlayerConnect);
-			packet << tankIdentifier 
-				<< mTankInfo[tankIdentifier].isLiberator 
-				<< mTankInfo[tankIdentifier].position.x 
-				<< mTankInfo[tankIdentifier].position.y 
-				<< mTankInfo[tankIdentifier].tankRotation
-				<< mTankInfo[tankIdentifier].turretRotation;
-			mPeers[i]->socket.send(packet);
+			PlayerConnectMessage message;
+			message.tank = getSpawnInfo(tankIdentifier);
+
+			sf::Packet packet = Schema::makePacket(message);
+			sendToPeer(*mPeers[i], packet);
 		}
 	}
 }
@@ -97,8 +196,12 @@ void GameServer::setListening(bool enable)
 	// Check if it isn't already listening
 	if (enable)
 	{
-		if (!mListeningState)
-			mListeningState = (mListenerSocket.listen(ServerPort) == sf::TcpListener::Done);
+		if (!mListeningState && mMode != Headless)
+		{
+			mListeningState = (mListenerSocket.listen(mPort) == sf::TcpListener::Done);
+			if (!mListeningState)
+				std::cout << "Network: cannot listen on port " << mPort << std::endl;
+		}
 	}
 	else
 	{
@@ -111,45 +214,76 @@ void GameServer::executionThread()
 {
 	setListening(true);
 
-	sf::Time stepInterval = sf::seconds(1.f / 60.f);
-	sf::Time stepTime = sf::Time::Zero;
-	sf::Time tickInterval = sf::seconds(1.f / 20.f);
-	sf::Time tickTime = sf::Time::Zero;
-	sf::Clock stepClock, tickClock;
-
 	while (!mWaitingThreadEnd)
 	{
-		handleIncomingPackets();
-		handleIncomingConnections();
+		update();
 
-		stepTime += stepClock.getElapsedTime();
-		stepClock.restart();
-
-		tickTime += tickClock.getElapsedTime();
-		tickClock.restart();
+		// Sleep to prevent server from consuming 100% CPU; short enough that ticks go out evenly spaced
+		sf::sleep(sf::milliseconds(5));
+	}
+}
 
-		// Fixed update step
-		while (stepTime >= stepInterval)
-		{
-			mBattleFieldRect.top += mBattleFieldScrollSpeed * stepInterval.asSeconds();
-			stepTime -= stepInterval;
-		}
+void GameServer::advance(sf::Time dt)
+{
+	mVirtualTime += dt;
+	update();
+}
 
-		// Fixed tick step
-		while (tickTime >= tickInterval)
-		{
-			tick();
-			tickTime -= tickInterval;
-		}
+void GameServer::update()
+{
+	handleIncomingPackets();
+	handleIncomingConnections();
+	updateLockstep();
+	flushSimulatedPackets();
+
+	sf::Time currentTime = now();
+	mStepTime += currentTime - mLastUpdateTime;
+	mTickTime += currentTime - mLastUpdateTime;
+	mLastUpdateTime = currentTime;
+
+	// Fixed update step
+	while (mStepTime >= StepInterval)
+	{
+		mBattleFieldRect.top += mBattleFieldScrollSpeed * StepInterval.asSeconds();
+		mStepTime -= StepInterval;
+	}
 
-		// Sleep to prevent server from consuming 100% CPU
-		sf::sleep(sf::milliseconds(100));
+	// Fixed tick step
+	while (mTickTime >= mTickInterval)
+	{
+		sf::Clock tickClock;
+		tick();
+		mTickTime -= mTickInterval;
+
+		sf::Time tickTime = tickClock.getElapsedTime();
+		mStatistics.ticks++;
+		mStatistics.totalTickTime += tickTime;
+		mStatistics.worstTickTime = std::max(mStatistics.worstTickTime, tickTime);
 	}
 }
 
+const GameServer::Statistics& GameServer::getStatistics() const
+{
+	return mStatistics;
+}
+
 void GameServer::tick()
 {
-	updateClientState();
+	++mTick;
+
+	// Lockstep and rollback clients simulate on their own; snapshots would be dropped on arrival
+	if (!mLockstepRunning && !mRollbackRunning)
+	{
+		updateClientState();
+		broadcastInputFrames();
+	}
+	expireSuspendedSessions();
+
+	for (std::size_t i = 0; i < mConnectedPlayers; ++i)
+	{
+		if (mPeers[i]->ready && !mPeers[i]->pendingWorldState.empty())
+			streamWorldState(*mPeers[i]);
+	}
 
 	// Check for mission success = all planes with position.y < offset
 	//bool allAircraftsDone = true;
@@ -217,7 +351,7 @@ void GameServer::tick()
 
 sf::Time GameServer::now() const
 {
-	return mClock.getElapsedTime();
+	return mMode == Headless ? mVirtualTime : mClock.getElapsedTime();
 }
 
 void GameServer::handleIncomingPackets()
@@ -226,19 +360,23 @@ void GameServer::handleIncomingPackets()
 
 	FOREACH(PeerPtr& peer, mPeers)
 	{
-		if (peer->ready)
+		if (peer->connected)
 		{
 			sf::Packet packet;
-			while (peer->socket.receive(packet) == sf::Socket::Done)
+			while (receivePacket(*peer, packet))
 			{
-				// Interpret packet and react to it
-				handleIncomingPacket(packet, *peer, detectedTimeout);
+				// Interpret packet and react to it, unless the simulator holds it back for now
+				if (!mSimulator.submit(peer->connectionNumber, NetworkSimulator::Incoming, packet, now()))
+					handleIncomingPacket(packet, *peer, detectedTimeout);
 
 				// Packet was indeed received, update the ping timer
 				peer->lastPacketTime = now();
 				packet.clear();
 			}
 
+			while (mSimulator.poll(peer->connectionNumber, NetworkSimulator::Incoming, packet, now()))
+				handleIncomingPacket(packet, *peer, detectedTimeout);
+
 			if (now() >= peer->lastPacketTime + mClientTimeoutTime)
 			{
 				peer->timedOut = true;
@@ -253,40 +391,128 @@ void GameServer::handleIncomingPackets()
 
 void GameServer::handleIncomingPacket(sf::Packet& packet, RemotePeer& receivingPeer, bool& detectedTimeout)
 {
+	// Recorded past the simulator, so a replay sees the impairments without applying them again
+	if (mRecorder.isOpen())
+		mRecorder.recordPacket(now(), receivingPeer.connectionNumber, packet);
+
 	sf::Int32 packetType;
 	packet >> packetType;
 
+	// Until the peer has said who it is, nothing else is accepted from it
+	if (!receivingPeer.ready)
+	{
+		ResumeMessage resume;
+		if (packetType == JoinMessage::Type)
+			joinPeer(receivingPeer);
+		else if (packetType == ResumeMessage::Type && Schema::decode(packet, resume))
+			resumePeer(receivingPeer, resume, detectedTimeout);
+		else if (packetType == SpectateMessage::Type)
+			spectatePeer(receivingPeer);
+
+		return;
+	}
+
+	// Spectators only watch
+	if (receivingPeer.spectator && packetType != QuitMessage::Type && packetType != PingMessage::Type)
+		return;
+
 	switch (packetType)
 	{
-	case Client::Quit:
+	case QuitMessage::Type:
 	{
 		receivingPeer.timedOut = true;
+		receivingPeer.quit = true;
 		detectedTimeout = true;
 	} break;
 
-	case Client::PlayerEvent:
+	case PingMessage::Type:
+	{
+		PingMessage ping;
+		if (!Schema::decode(packet, ping))
+			break;
+
+		// Echo the client's timestamp with ours, so it can work out the round trip and our clock offset
+		PongMessage pong;
+		pong.clientTime = ping.clientTime;
+		pong.serverTime = now().asMicroseconds();
+		pong.serverTick = mTick;
+
+		sf::Packet pongPacket = Schema::makePacket(pong);
+		sendToPeer(receivingPeer, pongPacket);
+	} break;
+
+	case ClientPlayerEventMessage::Type:
+	{
+		ClientPlayerEventMessage message;
+		if (Schema::decode(packet, message))
+			notifyPlayerEvent(message.identifier, message.action);
+	} break;
+
+	case ClientRollbackInputMessage::Type:
+	{
+		ClientRollbackInputMessage input;
+		if (!Schema::decode(packet, input))
+			break;
+
+		// Rollback clients simulate on their own, the server only passes their inputs on
+		mRollbackRunning = true;
+
+		RollbackInputMessage relay;
+		relay.identifier = input.identifier;
+		relay.frame = input.frame;
+		relay.actions = input.actions;
+		sf::Packet relayPacket = Schema::makePacket(relay);
+
+		FOREACH(PeerPtr& peer, mPeers)
+		{
+			if (peer.get() != &receivingPeer && peer->ready)
+				sendToPeer(*peer, relayPacket);
+		}
+	} break;
+
+	case LockstepInputMessage::Type:
 	{
-		sf::Int32 tankIdentifier;
-		sf::Int32 action;
-		packet >> tankIdentifier >> action;
+		LockstepInputMessage input;
+		if (!Schema::decode(packet, input))
+			break;
+
+		// The first input starts the match, with the tanks that exist now
+		if (!mLockstepRunning)
+		{
+			resetLockstep();
+			mLockstepRunning = true;
+			mLastBundleTime = now();
+			FOREACH(auto& pair, mTankInfo)
+				mLockstepTanks.push_back(pair.first);
+		}
+
+		// Nothing from before the next bundle, nor from further ahead than any client may send
+		bool inWindow = input.tick >= mLockstepTick && input.tick - mLockstepTick <= LockstepInputDelay;
+		if (inWindow && std::find(mLockstepTanks.begin(), mLockstepTanks.end(), input.identifier) != mLockstepTanks.end())
+			mLockstepInputs[input.tick][input.identifier] = input.actions;
+	} break;
 
-		notifyPlayerEvent(tankIdentifier, action);
+	case LockstepChecksumMessage::Type:
+	{
+		LockstepChecksumMessage message;
+		if (Schema::decode(packet, message))
+			handleLockstepChecksum(message.tick, message.checksum);
 	} break;
 
-	case Client::PlayerRealtimeChange:
+	case ClientInputFramesMessage::Type:
 	{
-		sf::Int32 tankIdentifier;
-		sf::Int32 action;
-		bool actionEnabled;
-		packet >> tankIdentifier >> action >> actionEnabled;
-		mTankInfo[tankIdentifier].realtimeActions[action] = actionEnabled;
-		notifyPlayerRealtimeChange(tankIdentifier, action, actionEnabled);
+		ClientInputFramesMessage message;
+		if (Schema::decode(packet, message))
+			handleInputFrames(message);
 	} break;
 
-	case Client::RequestCoopPartner:
+	case RequestCoopPartnerMessage::Type:
 	{
-		bool isLiberator;
-		packet >> isLiberator;
+		RequestCoopPartnerMessage request;
+		if (!Schema::decode(packet, request))
+			break;
+
+		bool isLiberator = request.isLiberator;
 		receivingPeer.tankIdentifiers.push_back(mTankIdentifierCounter);
 		mTankInfo[mTankIdentifierCounter].position = getSpawnLocation(isLiberator, mTankIdentifierCounter);
 		mTankInfo[mTankIdentifierCounter].hitpoints = 100;
@@ -294,80 +520,68 @@ void GameServer::handleIncomingPacket(sf::Packet& packet, RemotePeer& receivingP
 		mTankInfo[mTankIdentifierCounter].tankRotation = (isLiberator == true ? 90.f : -90.f);
 		mTankInfo[mTankIdentifierCounter].turretRotation = 0;
 		mTankInfo[mTankIdentifierCounter].isLiberator = isLiberator;
+		mTankInfo[mTankIdentifierCounter].lastUpdateTime = now();
 
-		sf::Packet requestPacket;
-		requestPacket << static_cast<sf::Int32>(Server::AcceptCoopPartner);
-		requestPacket << mTankIdentifierCounter;
-		requestPacket << isLiberator;
-		requestPacket << mTankInfo[mTankIdentifierCounter].position.x;
-		requestPacket << mTankInfo[mTankIdentifierCounter].position.y;
+		AcceptCoopPartnerMessage accept;
+		accept.identifier = mTankIdentifierCounter;
+		accept.isLiberator = isLiberator;
+		accept.x = mTankInfo[mTankIdentifierCounter].position.x;
+		accept.y = mTankInfo[mTankIdentifierCounter].position.y;
 
-		receivingPeer.socket.send(requestPacket);
+		sf::Packet requestPacket = Schema::makePacket(accept);
+		sendToPeer(receivingPeer, requestPacket);
 		mTankCount++;
 
 		// Inform every other peer about this new tank
+		PlayerConnectMessage notify;
+		notify.tank = getSpawnInfo(mTankIdentifierCounter);
+		sf::Packet notifyPacket = Schema::makePacket(notify);
+
 		FOREACH(PeerPtr& peer, mPeers)
 		{
 			if (peer.get() != &receivingPeer && peer->ready)
-			{
-				sf::Packet notifyPacket;
-				notifyPacket << static_cast<sf::Int32>(Server::PlayerConnect);
-				notifyPacket << mTankIdentifierCounter;
-				notifyPacket << mTankInfo[mTankIdentifierCounter].isLiberator;
-				notifyPacket << mTankInfo[mTankIdentifierCounter].position.x;
-				notifyPacket << mTankInfo[mTankIdentifierCounter].position.y;
-				notifyPacket << mTankInfo[mTankIdentifierCounter].tankRotation;
-				notifyPacket << mTankInfo[mTankIdentifierCounter].turretRotation;
-				peer->socket.send(notifyPacket);
-			}
+				sendToPeer(*peer, notifyPacket);
 		}
 		mTankIdentifierCounter++;
 	} break;
 
-	case Client::PositionUpdate:
+	case PositionUpdateMessage::Type:
 	{
-		sf::Int32 numTanks;
-		packet >> numTanks;
+		PositionUpdateMessage message;
+		if (!Schema::decode(packet, message))
+			break;
 
-		for (sf::Int32 i = 0; i < numTanks; ++i)
+		FOREACH(const PositionUpdateMessage::Tank& update, message.tanks)
 		{
-			sf::Int32 tankIdentifier;
-			sf::Int32 tankHitpoints;
-			sf::Int32 missileAmmo;
-			sf::Vector2f tankPosition;
-			float tankRotation, turretRotation;
-			packet >> tankIdentifier >> tankPosition.x >> tankPosition.y >> tankRotation >> turretRotation >> tankHitpoints >> missileAmmo;
-			mTankInfo[tankIdentifier].position = tankPosition;
-			mTankInfo[tankIdentifier].tankRotation = tankRotation;
-			mTankInfo[tankIdentifier].turretRotation = turretRotation;
-			mTankInfo[tankIdentifier].hitpoints = tankHitpoints;
-			mTankInfo[tankIdentifier].missileAmmo = missileAmmo;
+			// Clamp the reported position to what the acknowledged inputs could have achieved; the client reconciles against it
+			TankInfo& tank = mTankInfo[update.identifier];
+			tank.position = validateMovement(tank, sf::Vector2f(update.x, update.y), update.inputSequence);
+			tank.tankRotation = update.rotation;
+			tank.turretRotation = update.turretRotation;
+			tank.hitpoints = update.hitpoints;
+			tank.missileAmmo = update.missileAmmo;
+			tank.lastInputSequence = std::max(tank.lastInputSequence, update.inputSequence);
+			tank.lastUpdateTime = now();
 		}
 	} break;
 
-	case Client::GameEvent:
+	case GameEventMessage::Type:
 	{
-		sf::Int32 action;
-		float x;
-		float y;
-
-		packet >> action;
-		packet >> x;
-		packet >> y;
-
-		
+		GameEventMessage event;
+		if (!Schema::decode(packet, event))
+			break;
 
 		// Enemy explodes: With certain probability, drop pickup
 		// To avoid multiple messages spawning multiple pickups, only listen to first peer (host)
-		if (action == GameActions::EnemyExplode && randomInt(3) == 0 && &receivingPeer == mPeers[0].get())
+		if (event.action == GameActions::EnemyExplode && randomInt(3) == 0 && &receivingPeer == mPeers[0].get())
 		{
-			sf::Packet packet;
-			packet << static_cast<sf::Int32>(Server::SpawnPickup);
-			packet << static_cast<sf::Int32>(randomInt(Pickup::TypeCount));
-			packet << x;
-			packet << y;
+			SpawnPickupMessage pickup;
+			pickup.type = static_cast<sf::Int32>(randomInt(PickupTypeCount));
+			pickup.x = event.x;
+			pickup.y = event.y;
 
-			sendToAll(packet);
+			sf::Packet pickupPacket = Schema::makePacket(pickup);
+			sendToAll(pickupPacket);
 		}
 	}
 	}
@@ -375,17 +589,105 @@ void GameServer::handleIncomingPacket(sf::Packet& packet, RemotePeer& receivingP
 
 void GameServer::updateClientState()
 {
-	sf::Packet updateClientStatePacket;
-	updateClientStatePacket << static_cast<sf::Int32>(Server::UpdateClientState);
-	updateClientStatePacket << static_cast<float>(mBattleFieldRect.top + mBattleFieldRect.height);
-	updateClientStatePacket << static_cast<sf::Int32>(mTankInfo.size());
+	UpdateClientStateMessage message;
+	message.serverTick = mTick;
+	message.battlefieldTop = mBattleFieldRect.top + mBattleFieldRect.height;
+	message.tanks.resize(mTankInfo.size());
 
-	FOREACH(auto tank, mTankInfo)
-		updateClientStatePacket << tank.first << tank.second.position.x << tank.second.position.y << tank.second.tankRotation << tank.second.turretRotation;
+	std::size_t i = 0;
+	FOREACH(auto& pair, mTankInfo)
+	{
+		UpdateClientStateMessage::Tank& tank = message.tanks[i++];
+		tank.identifier = pair.first;
+		tank.x = pair.second.position.x;
+		tank.y = pair.second.position.y;
+		tank.rotation = pair.second.tankRotation;
+		tank.turretRotation = pair.second.turretRotation;
+		tank.lastInputSequence = pair.second.lastInputSequence;
+	}
 
+	sf::Packet updateClientStatePacket = Schema::makePacket(message);
 	sendToAll(updateClientStatePacket);
 }
 
+void GameServer::handleInputFrames(const ClientInputFramesMessage& message)
+{
+	FOREACH(const TankInputFrames& frames, message.tanks)
+	{
+		const std::vector<sf::Uint8>& actions = frames.actions;
+		sf::Uint32 newestSequence = frames.newestSequence;
+		sf::Uint32 frameCount = std::min<sf::Uint32>(static_cast<sf::Uint32>(actions.size()), RedundantInputFrames);
+
+		auto tank = mTankInfo.find(frames.identifier);
+		if (frameCount == 0 || tank == mTankInfo.end())
+			continue;
+
+		// Take only frames we haven't seen, oldest first. Frames lost along with all their copies
+		// are filled in with the previous one: the keys were most likely still held.
+		TankInfo& info = tank->second;
+		sf::Uint32 oldestSequence = newestSequence - (frameCount - 1);
+		sf::Uint32 sequence = info.lastFrameSequence + 1;
+		if (newestSequence >= BundledInputFrames)
+			sequence = std::max(sequence, newestSequence - BundledInputFrames + 1);
+
+		for (; sequence <= newestSequence; ++sequence)
+		{
+			sf::Uint8 frameActions = sequence >= oldestSequence ? actions[newestSequence - sequence] : info.frameActions[(sequence - 1) % BundledInputFrames];
+			info.frameActions[sequence % BundledInputFrames] = frameActions;
+		}
+
+		info.lastFrameSequence = std::max(info.lastFrameSequence, newestSequence);
+	}
+}
+
+void GameServer::broadcastInputFrames()
+{
+	// One bundle per tick with every tank's latest frames; each frame goes out in several bundles
+	InputFramesMessage message;
+	message.serverTick = mTick;
+
+	FOREACH(auto& pair, mTankInfo)
+	{
+		const TankInfo& tank = pair.second;
+		if (tank.lastFrameSequence == 0)
+			continue;
+
+		message.tanks.push_back(TankInputFrames());
+		TankInputFrames& frames = message.tanks.back();
+		frames.identifier = pair.first;
+		frames.newestSequence = tank.lastFrameSequence;
+
+		sf::Uint32 frameCount = std::min<sf::Uint32>(tank.lastFrameSequence, BundledInputFrames);
+		for (sf::Uint32 frame = 0; frame < frameCount; ++frame)
+			frames.actions.push_back(tank.frameActions[(tank.lastFrameSequence - frame) % BundledInputFrames]);
+	}
+
+	if (message.tanks.empty())
+		return;
+
+	sf::Packet packet = Schema::makePacket(message);
+	sendToAll(packet);
+}
+
+sf::Vector2f GameServer::validateMovement(const TankInfo& tank, sf::Vector2f position, sf::Uint32 inputSequence) const
+{
+	// Stale or repeated input: the tank cannot have moved
+	if (inputSequence <= tank.lastInputSequence && tank.lastInputSequence != 0)
+		return tank.position;
+
+	// Number of simulation steps covered by this update, bounded by the time that really passed
+	float elapsedSteps = (now() - tank.lastUpdateTime + MovementSlack).asSeconds() * ClientTickRate;
+	float steps = std::min(static_cast<float>(inputSequence - tank.lastInputSequence), elapsedSteps);
+	float maxDistance = steps / ClientTickRate * MaxTankSpeed;
+
+	sf::Vector2f displacement = position - tank.position;
+	float distance = std::sqrt(displacement.x * displacement.x + displacement.y * displacement.y);
+	if (distance <= maxDistance)
+		return position;
+
+	return tank.position + displacement / distance * maxDistance;
+}
+
 void GameServer::handleIncomingConnections()
 {
 	if (!mListeningState)
@@ -393,45 +695,303 @@ void GameServer::handleIncomingConnections()
 
 	if (mListenerSocket.accept(mPeers[mConnectedPlayers]->socket) == sf::TcpListener::Done)
 	{
-		
-		// order the new client to spawn its own tank	
-		mTankInfo[mTankIdentifierCounter].hitpoints = 100;
-		mTankInfo[mTankIdentifierCounter].missileAmmo = 20;
-		mTankInfo[mTankIdentifierCounter].turretRotation = 0;
+		if (mRecorder.isOpen())
+			mRecorder.recordConnection(now(), mConnectionCounter + 1);
 
-		//Check for if on the resistace team
-		lastConnected = !lastConnected;
+		connectPeer(*mPeers[mConnectedPlayers], ++mConnectionCounter);
+	}
+}
 
-		mTankInfo[mTankIdentifierCounter].position = getSpawnLocation(lastConnected, mTankIdentifierCounter);
-		mTankInfo[mTankIdentifierCounter].tankRotation = (lastConnected ? 90 : -90);
-		mTankInfo[mTankIdentifierCounter].isLiberator = lastConnected;
+void GameServer::injectConnection(int connectionNumber)
+{
+	if (mConnectedPlayers < mMaxConnectedPlayers)
+		connectPeer(*mPeers[mConnectedPlayers], connectionNumber);
+}
 
-		sf::Packet packet;
-		packet << static_cast<sf::Int32>(Server::SpawnSelf);
-		packet << mTankIdentifierCounter;
-		packet << mTankInfo[mTankIdentifierCounter].isLiberator;
-		packet << mTankInfo[mTankIdentifierCounter].position.x;
-		packet << mTankInfo[mTankIdentifierCounter].position.y;
-		packet << mTankInfo[mTankIdentifierCounter].tankRotation;
-		packet << mTankInfo[mTankIdentifierCounter].turretRotation;
-
-		mPeers[mConnectedPlayers]->tankIdentifiers.push_back(mTankIdentifierCounter);
-
-		broadcastMessage("Someone has joined the fight!");
-		informWorldState(mPeers[mConnectedPlayers]->socket);
-		notifyPlayerSpawn(mTankIdentifierCounter++);
-
-		mPeers[mConnectedPlayers]->socket.send(packet);
-		mPeers[mConnectedPlayers]->ready = true;
-		mPeers[mConnectedPlayers]->lastPacketTime = now(); // prevent initial timeouts
-		mTankCount++;
-		mConnectedPlayers++;
+void GameServer::injectPacket(int connectionNumber, const sf::Packet& packet)
+{
+	FOREACH(PeerPtr& peer, mPeers)
+	{
+		if (peer->connected && peer->connectionNumber == connectionNumber)
+		{
+			peer->injectedPackets.push_back(packet);
+			return;
+		}
+	}
+}
+
+void GameServer::connectPeer(RemotePeer& peer, int connectionNumber)
+{
+	// The peer joins or resumes once its first packet arrives
+	peer.connectionNumber = connectionNumber;
+	peer.connected = true;
+	peer.lastPacketTime = now(); // prevent initial timeouts
+	mConnectedPlayers++;
+
+	if (mConnectedPlayers >= mMaxConnectedPlayers)
+		setListening(false);
+	else // Add a new waiting peer
+		mPeers.push_back(PeerPtr(new RemotePeer()));
+}
+
+void GameServer::joinPeer(RemotePeer& peer)
+{
+	// order the new client to spawn its own tank	
+	mTankInfo[mTankIdentifierCounter].hitpoints = 100;
+	mTankInfo[mTankIdentifierCounter].missileAmmo = 20;
+	mTankInfo[mTankIdentifierCounter].turretRotation = 0;
 
-		if (mConnectedPlayers >= mMaxConnectedPlayers)
-			setListening(false);
-		else // Add a new waiting peer
-			mPeers.push_back(PeerPtr(new RemotePeer()));
+	//Check for if on the resistace team
+	lastConnected = !lastConnected;
+
+	mTankInfo[mTankIdentifierCounter].position = getSpawnLocation(lastConnected, mTankIdentifierCounter);
+	mTankInfo[mTankIdentifierCounter].tankRotation = (lastConnected ? 90 : -90);
+	mTankInfo[mTankIdentifierCounter].isLiberator = lastConnected;
+	mTankInfo[mTankIdentifierCounter].lastUpdateTime = now();
+
+	SpawnSelfMessage spawn;
+	spawn.tank = getSpawnInfo(mTankIdentifierCounter);
+	sf::Packet packet = Schema::makePacket(spawn);
+
+	peer.tankIdentifiers.push_back(mTankIdentifierCounter);
+
+	broadcastMessage("Someone has joined the fight!");
+	informWorldState(peer);
+	notifyPlayerSpawn(mTankIdentifierCounter++);
+
+	sendToPeer(peer, packet);
+	peer.ready = true;
+	mTankCount++;
+
+	// Lets the client pick up its tanks again if the connection drops
+	do
+		peer.sessionToken = mTokenGenerator();
+	while (peer.sessionToken == 0 || mSuspendedSessions.count(peer.sessionToken));
+
+	SessionTokenMessage token;
+	token.token = peer.sessionToken;
+
+	sf::Packet tokenPacket = Schema::makePacket(token);
+	sendToPeer(peer, tokenPacket);
+}
+
+void GameServer::spectatePeer(RemotePeer& peer)
+{
+	// No tank and no session: the peer gets the world state, then everything sent to all
+	peer.spectator = true;
+	informWorldState(peer);
+	peer.ready = true;
+
+	if (mMode != Headless)
+		std::cout << "Server: spectator connected" << std::endl;
+}
+
+void GameServer::resumePeer(RemotePeer& peer, const ResumeMessage& resume, bool& detectedTimeout)
+{
+	sf::Uint64 token = resume.token;
+	const std::vector<sf::Int32>& knownTanks = resume.knownTanks;
+
+	auto suspended = mSuspendedSessions.find(token);
+	if (suspended != mSuspendedSessions.end())
+	{
+		peer.tankIdentifiers = suspended->second.tankIdentifiers;
+		mSuspendedSessions.erase(suspended);
 	}
+	else
+	{
+		// The client may notice the drop before we do; then the old connection is still here and hands over its tanks
+		auto previous = std::find_if(mPeers.begin(), mPeers.end(), [&] (const PeerPtr& other)
+		{
+			return other.get() != &peer && other->ready && other->sessionToken == token;
+		});
+
+		if (token == 0 || previous == mPeers.end())
+		{
+			sf::Packet rejectPacket = Schema::makePacket(ResumeRejectedMessage());
+			sendToPeer(peer, rejectPacket);
+			peer.timedOut = true;
+			detectedTimeout = true;
+			return;
+		}
+
+		peer.tankIdentifiers.swap((*previous)->tankIdentifiers);
+		(*previous)->sessionToken = 0;
+		(*previous)->timedOut = true;
+		detectedTimeout = true;
+	}
+
+	// Tanks destroyed in the meantime are gone
+	peer.tankIdentifiers.erase(std::remove_if(peer.tankIdentifiers.begin(), peer.tankIdentifiers.end(), [&] (sf::Int32 identifier)
+	{
+		return mTankInfo.find(identifier) == mTankInfo.end();
+	}), peer.tankIdentifiers.end());
+
+	// Catch up on the tanks that came and went, rather than sending the whole world again;
+	// positions follow with the next state update
+	FOREACH(auto& pair, mTankInfo)
+	{
+		if (std::find(knownTanks.begin(), knownTanks.end(), pair.first) == knownTanks.end())
+		{
+			PlayerConnectMessage message;
+			message.tank = getSpawnInfo(pair.first);
+
+			sf::Packet connectPacket = Schema::makePacket(message);
+			sendToPeer(peer, connectPacket);
+		}
+	}
+
+	FOREACH(sf::Int32 identifier, knownTanks)
+	{
+		if (mTankInfo.find(identifier) == mTankInfo.end())
+		{
+			PlayerDisconnectMessage message;
+			message.identifier = identifier;
+
+			sf::Packet disconnectPacket = Schema::makePacket(message);
+			sendToPeer(peer, disconnectPacket);
+		}
+	}
+
+	sf::Packet acceptPacket = Schema::makePacket(ResumeAcceptedMessage());
+	sendToPeer(peer, acceptPacket);
+
+	peer.sessionToken = token;
+	peer.ready = true;
+	broadcastMessage("A player has reconnected.");
+}
+
+void GameServer::expireSuspendedSessions()
+{
+	for (auto itr = mSuspendedSessions.begin(); itr != mSuspendedSessions.end(); )
+	{
+		if (now() >= itr->second.expiryTime)
+		{
+			removeTanks(itr->second.tankIdentifiers);
+			mSuspendedSessions.erase(itr++);
+
+			broadcastMessage("A player has disconnected.");
+		}
+		else
+		{
+			++itr;
+		}
+	}
+}
+
+void GameServer::removeTanks(const std::vector<sf::Int32>& tankIdentifiers)
+{
+	// Inform everyone of the disconnection, erase 
+	FOREACH(sf::Int32 identifier, tankIdentifiers)
+	{
+		PlayerDisconnectMessage message;
+		message.identifier = identifier;
+
+		sf::Packet packet = Schema::makePacket(message);
+		sendToAll(packet);
+
+		mTankInfo.erase(identifier);
+	}
+
+	mTankCount -= tankIdentifiers.size();
+
+	// The rollback match is over once its tanks are gone
+	if (mTankInfo.empty())
+		mRollbackRunning = false;
+}
+
+void GameServer::updateLockstep()
+{
+	while (mLockstepRunning)
+	{
+		auto inputs = mLockstepInputs.find(mLockstepTick);
+
+		// Wait for every tank that is still connected, up to a time limit
+		bool complete = true;
+		bool anyConnected = false;
+		FOREACH(sf::Int32 identifier, mLockstepTanks)
+		{
+			if (mTankInfo.find(identifier) == mTankInfo.end())
+				continue;
+
+			anyConnected = true;
+			if (inputs == mLockstepInputs.end() || inputs->second.find(identifier) == inputs->second.end())
+				complete = false;
+		}
+
+		if (!anyConnected)
+		{
+			resetLockstep();
+			break;
+		}
+
+		// Idle or stalled peers cannot hold up the others: a tick with no input at all goes out too
+		bool overdue = now() - mLastBundleTime > LockstepInputTimeout;
+		if (!complete && !overdue)
+			break;
+
+		InputBundleMessage bundle;
+		bundle.tick = mLockstepTick;
+
+		FOREACH(sf::Int32 identifier, mLockstepTanks)
+		{
+			sf::Uint8& actions = mLastLockstepInputs[identifier];
+			if (mTankInfo.find(identifier) == mTankInfo.end())
+				actions = 0;
+			else if (inputs != mLockstepInputs.end() && inputs->second.find(identifier) != inputs->second.end())
+				actions = inputs->second[identifier];
+
+			InputBundleMessage::Input input;
+			input.identifier = identifier;
+			input.actions = actions;
+			bundle.inputs.push_back(input);
+		}
+
+		sf::Packet packet = Schema::makePacket(bundle);
+		sendToAll(packet);
+
+		if (inputs != mLockstepInputs.end())
+			mLockstepInputs.erase(inputs);
+
+		++mLockstepTick;
+		mLastBundleTime = now();
+	}
+}
+
+void GameServer::resetLockstep()
+{
+	// Nothing carries over into the next match, a desync in it is reported again
+	mLockstepRunning = false;
+	mLockstepTick = 0;
+	mLockstepTanks.clear();
+	mLockstepInputs.clear();
+	mLastLockstepInputs.clear();
+	mLockstepChecksums.clear();
+	mDesyncReported = false;
+}
+
+void GameServer::handleLockstepChecksum(sf::Uint32 tick, sf::Uint32 checksum)
+{
+	auto found = mLockstepChecksums.find(tick);
+	if (found == mLockstepChecksums.end())
+	{
+		mLockstepChecksums[tick] = checksum;
+	}
+	else if (found->second != checksum && !mDesyncReported)
+	{
+		// Reported once; every client then dumps its state of that tick
+		mDesyncReported = true;
+
+		LockstepDesyncMessage desync;
+		desync.tick = tick;
+
+		sf::Packet packet = Schema::makePacket(desync);
+		sendToAll(packet);
+
+		broadcastMessage("Desync detected at tick " + toString(tick));
+	}
+
+	while (!mLockstepChecksums.empty() && mLockstepChecksums.begin()->first + ChecksumHistory < tick)
+		mLockstepChecksums.erase(mLockstepChecksums.begin());
 }
 
 sf::Vector2f GameServer::getSpawnLocation(bool isLiberator, int tankIdentifier)
@@ -452,22 +1012,55 @@ sf::Vector2f GameServer::getSpawnLocation(bool isLiberator, int tankIdentifier)
 	return spawnPosition;
 }
 
+int GameServer::randomInt(int exclusiveMax)
+{
+	std::uniform_int_distribution<int> distribution(0, exclusiveMax - 1);
+	return distribution(mRandomEngine);
+}
+
+TankSpawnInfo GameServer::getSpawnInfo(sf::Int32 tankIdentifier) const
+{
+	TankSpawnInfo spawn;
+	spawn.identifier = tankIdentifier;
+
+	auto tank = mTankInfo.find(tankIdentifier);
+	if (tank != mTankInfo.end())
+	{
+		spawn.isLiberator = tank->second.isLiberator;
+		spawn.x = tank->second.position.x;
+		spawn.y = tank->second.position.y;
+		spawn.rotation = tank->second.tankRotation;
+		spawn.turretRotation = tank->second.turretRotation;
+	}
+
+	return spawn;
+}
+
 void GameServer::handleDisconnections()
 {
 	for (auto itr = mPeers.begin(); itr != mPeers.end(); )
 	{
 		if ((*itr)->timedOut)
 		{
-			// Inform everyone of the disconnection, erase 
-			FOREACH(sf::Int32 identifier, (*itr)->tankIdentifiers)
-			{
-				sendToAll(sf::Packet() << static_cast<sf::Int32>(Server::PlayerDisconnect) << identifier);
+			RemotePeer& peer = **itr;
+			bool hadTanks = !peer.tankIdentifiers.empty();
 
-				mTankInfo.erase(identifier);
+			// A dropped connection may come back; lockstep matches cannot wait for it (every tick would stall) and
+			// rollback clients never try to resume
+			bool suspend = !peer.quit && peer.sessionToken != 0 && hadTanks && !mLockstepRunning && !mRollbackRunning;
+			if (suspend)
+			{
+				SuspendedSession& session = mSuspendedSessions[peer.sessionToken];
+				session.tankIdentifiers = peer.tankIdentifiers;
+				session.expiryTime = now() + ResumeGracePeriod;
+			}
+			else
+			{
+				removeTanks(peer.tankIdentifiers);
 			}
 
 			mConnectedPlayers--;
-			mTankCount -= (*itr)->tankIdentifiers.size();
+			mSimulator.removePeer(peer.connectionNumber);
 
 			itr = mPeers.erase(itr);
 
@@ -478,7 +1071,9 @@ void GameServer::handleDisconnections()
 				setListening(true);
 			}
 
-			broadcastMessage("A player has disconnected.");
+			// Peers that never joined, or handed their tanks to a resumed connection, leave silently
+			if (hadTanks)
+				broadcastMessage(suspend ? "A player lost connection." : "A player has disconnected.");
 		}
 		else
 		{
@@ -488,36 +1083,83 @@ void GameServer::handleDisconnections()
 }
 
 // Tell the newly connected peer about how the world is currently
-void GameServer::informWorldState(sf::TcpSocket& socket)
+void GameServer::informWorldState(RemotePeer& peer)
 {
-	sf::Packet packet;
-	packet << static_cast<sf::Int32>(Server::InitialState);
-	packet << static_cast<sf::Int32>(mTankCount);
-
+	// Tanks of connected peers, and of dropped peers that may still come back
+	peer.pendingWorldState.clear();
 	for (std::size_t i = 0; i < mConnectedPlayers; ++i)
 	{
 		if (mPeers[i]->ready)
+			peer.pendingWorldState.insert(peer.pendingWorldState.end(), mPeers[i]->tankIdentifiers.begin(), mPeers[i]->tankIdentifiers.end());
+	}
+
+	FOREACH(auto& session, mSuspendedSessions)
+		peer.pendingWorldState.insert(peer.pendingWorldState.end(), session.second.tankIdentifiers.begin(), session.second.tankIdentifiers.end());
+
+	// The first chunk goes out right away, the rest with the following ticks
+	streamWorldState(peer);
+}
+
+// Send the next few chunks of the world state. Each is built from the tank's current state when it is
+// sent, so tanks that are gone by then are skipped and the ones moved are not stale; tanks that joined
+// meanwhile reach the peer through PlayerConnect.
+void GameServer::streamWorldState(RemotePeer& peer)
+{
+	for (std::size_t chunk = 0; chunk < WorldStateChunksPerTick; ++chunk)
+	{
+		InitialStateMessage message;
+		std::size_t size = 0;
+
+		while (!peer.pendingWorldState.empty() && size < WorldStateChunkSize)
 		{
-			FOREACH(sf::Int32 identifier, mPeers[i]->tankIdentifiers)
-				packet << identifier << mTankInfo[identifier].isLiberator << mTankInfo[identifier].position.x << mTankInfo[identifier].position.y << mTankInfo[identifier].tankRotation << mTankInfo[identifier].turretRotation << mTankInfo[identifier].hitpoints << mTankInfo[identifier].missileAmmo;
+			sf::Int32 identifier = peer.pendingWorldState.front();
+			peer.pendingWorldState.pop_front();
+
+			auto tank = mTankInfo.find(identifier);
+			if (tank == mTankInfo.end())
+				continue;
+
+			InitialStateMessage::Tank state;
+			state.spawn = getSpawnInfo(identifier);
+			state.hitpoints = tank->second.hitpoints;
+			state.missileAmmo = tank->second.missileAmmo;
+			message.tanks.push_back(state);
+
+			size += Schema::encodedSize(state);
 		}
-	}
 
-	socket.send(packet);
+		std::vector<char> bytes;
+		Schema::encode(bytes, message);
+
+		std::vector<char> compressed;
+		compressBlock(bytes.data(), bytes.size(), compressed);
+
+		InitialStateChunkMessage chunkMessage;
+		chunkMessage.uncompressedSize = static_cast<sf::Uint32>(bytes.size());
+		chunkMessage.isLast = peer.pendingWorldState.empty();
+		chunkMessage.data.assign(compressed.begin(), compressed.end());
+
+		sf::Packet packet = Schema::makePacket(chunkMessage);
+		sendToPeer(peer, packet);
+
+		if (chunkMessage.isLast)
+			break;
+	}
 }
 
 void GameServer::broadcastMessage(const std::string& message)
 {
+	if (mMode != Headless)
+		std::cout << "Server: " << message << std::endl;
+
+	BroadcastTextMessage broadcast;
+	broadcast.text = message;
+	sf::Packet packet = Schema::makePacket(broadcast);
+
 	for (std::size_t i = 0; i < mConnectedPlayers; ++i)
 	{
 		if (mPeers[i]->ready)
-		{
-			sf::Packet packet;
-			packet << static_cast<sf::Int32>(Server::BroadcastMessage);
-			packet << message;
-
-			mPeers[i]->socket.send(packet);
-		}
+			sendToPeer(*mPeers[i], packet);
 	}
 }
 
@@ -526,6 +1168,53 @@ void GameServer::sendToAll(sf::Packet& packet)
 	FOREACH(PeerPtr& peer, mPeers)
 	{
 		if (peer->ready)
-			peer->socket.send(packet);
+			sendToPeer(*peer, packet);
+	}
+}
+
+// Every packet to a client goes out through here, so the network simulator sees all traffic
+void GameServer::sendToPeer(RemotePeer& peer, sf::Packet& packet)
+{
+	if (!mSimulator.submit(peer.connectionNumber, NetworkSimulator::Outgoing, packet, now()))
+		transmit(peer, packet);
+}
+
+bool GameServer::receivePacket(RemotePeer& peer, sf::Packet& packet)
+{
+	if (mMode == Headless)
+	{
+		if (peer.injectedPackets.empty())
+			return false;
+
+		packet = peer.injectedPackets.front();
+		peer.injectedPackets.pop_front();
+		return true;
+	}
+
+	return peer.socket.receive(packet) == sf::Socket::Done;
+}
+
+void GameServer::transmit(RemotePeer& peer, sf::Packet& packet)
+{
+	mStatistics.outboundPackets++;
+	mStatistics.outboundBytes += packet.getDataSize();
+
+	if (mMode != Headless)
+		peer.socket.send(packet);
+}
+
+void GameServer::flushSimulatedPackets()
+{
+	if (!mSimulator.isEnabled())
+		return;
+
+	FOREACH(PeerPtr& peer, mPeers)
+	{
+		if (!peer->ready)
+			continue;
+
+		sf::Packet packet;
+		while (mSimulator.poll(peer->connectionNumber, NetworkSimulator::Outgoing, packet, now()))
+			transmit(*peer, packet);
 	}
 }
@@ -8,18 +8,67 @@
 #include <SFML/Network/TcpListener.hpp>
 #include <SFML/Network/TcpSocket.hpp>
 
+#include "NetworkSimulator.hpp"
+#include "PacketCapture.hpp"
+#include "NetworkProtocol.hpp"
+#include "NetworkMessages.hpp"
+
+#include <array>
+#include <deque>
 #include <vector>
 #include <memory>
 #include <map>
+#include <random>
 
 class GameServer
 {
 public:
-	explicit							GameServer(sf::Vector2f battlefieldSize);
+	// A headless server has no thread and no sockets: connections and packets are injected, and
+	// time only passes in advance(). Used to replay captured traffic.
+	enum Mode
+	{
+		Networked,
+		Headless,
+	};
+
+	struct Statistics
+	{
+		Statistics();
+
+		sf::Uint64						ticks;
+		sf::Time						totalTickTime;
+		sf::Time						worstTickTime;
+		sf::Uint64						outboundPackets;
+		sf::Uint64						outboundBytes;
+	};
+
+
+	// How a server is started; the defaults are those of a game hosted from the menu
+	struct Settings
+	{
+		Settings();
+
+		sf::Vector2f					battlefieldSize;
+		Mode							mode;
+		unsigned short					port;
+		std::size_t						maxPlayers;
+		unsigned int					tickRate;
+		unsigned int					seed;		// pickup drops
+		unsigned int					sessionSeed;	// session tokens
+	};
+
+
+public:
+	explicit							GameServer(sf::Vector2f battlefieldSize, Mode mode = Networked);
+	explicit							GameServer(const Settings& settings);
 	~GameServer();
 
+	void								injectConnection(int connectionNumber);
+	void								injectPacket(int connectionNumber, const sf::Packet& packet);
+	void								advance(sf::Time dt);
+	const Statistics&					getStatistics() const;
+
 	void								notifyPlayerSpawn(sf::Int32 tankIdentifier);
-	void								notifyPlayerRealtimeChange(sf::Int32 tankIdentifier, sf::Int32 action, bool actionEnabled);
 	void								notifyPlayerEvent(sf::Int32 tankIdentifier, sf::Int32 action);
 
 private:
@@ -29,22 +78,43 @@ private:
 		RemotePeer();
 
 		sf::TcpSocket			socket;
+		int						connectionNumber;
 		sf::Time				lastPacketTime;
 		std::vector<sf::Int32>	tankIdentifiers;
+		sf::Uint64				sessionToken;
+		std::deque<sf::Packet>	injectedPackets;	// headless mode only
+		std::deque<sf::Int32>	pendingWorldState;	// tanks still to be sent in InitialState chunks
+		bool					connected;		// accepted, waiting for Client::Join, Client::Resume or Client::Spectate
 		bool					ready;
+		bool					spectator;
 		bool					timedOut;
+		bool					quit;
+	};
+
+	// Tanks of a peer that dropped without quitting, kept in the game until it resumes or the grace period ends
+	struct SuspendedSession
+	{
+		std::vector<sf::Int32>	tankIdentifiers;
+		sf::Time				expiryTime;
 	};
 
 	// Structure to store information about current tank state
 	struct TankInfo
 	{
+		TankInfo();
+
 		bool						isLiberator;
 		sf::Vector2f				position;
 		float						tankRotation;
 		float						turretRotation;
 		sf::Int32					hitpoints;
 		sf::Int32                   missileAmmo;
-		std::map<sf::Int32, bool>	realtimeActions;
+		sf::Uint32					lastInputSequence;
+
+		// Input frames of the tank's owner, by sequence modulo BundledInputFrames
+		sf::Uint32					lastFrameSequence;
+		std::array<sf::Uint8, BundledInputFrames>	frameActions;
+		sf::Time					lastUpdateTime;
 	};
 
 	// Unique pointer to remote peers
@@ -54,6 +124,7 @@ private:
 private:
 	void								setListening(bool enable);
 	void								executionThread();
+	void								update();
 	void								tick();
 	
 
@@ -61,13 +132,32 @@ private:
 	void								handleIncomingPacket(sf::Packet& packet, RemotePeer& receivingPeer, bool& detectedTimeout);
 
 	void								handleIncomingConnections();
+	void								connectPeer(RemotePeer& peer, int connectionNumber);
 	void								handleDisconnections();
-
-	void								informWorldState(sf::TcpSocket& socket);
+	void								joinPeer(RemotePeer& peer);
+	void								resumePeer(RemotePeer& peer, const ResumeMessage& resume, bool& detectedTimeout);
+	void								spectatePeer(RemotePeer& peer);
+	void								expireSuspendedSessions();
+	void								removeTanks(const std::vector<sf::Int32>& tankIdentifiers);
+
+	void								informWorldState(RemotePeer& peer);
+	void								streamWorldState(RemotePeer& peer);
 	void								broadcastMessage(const std::string& message);
 	void								sendToAll(sf::Packet& packet);
+	void								sendToPeer(RemotePeer& peer, sf::Packet& packet);
+	bool								receivePacket(RemotePeer& peer, sf::Packet& packet);
+	void								transmit(RemotePeer& peer, sf::Packet& packet);
+	void								flushSimulatedPackets();
+	void								updateLockstep();
+	void								resetLockstep();
+	void								handleLockstepChecksum(sf::Uint32 tick, sf::Uint32 checksum);
 	void								updateClientState();
+	void								handleInputFrames(const ClientInputFramesMessage& message);
+	void								broadcastInputFrames();
+	sf::Vector2f						validateMovement(const TankInfo& tank, sf::Vector2f position, sf::Uint32 inputSequence) const;
 	sf::Vector2f						getSpawnLocation(bool isLiberator, int tankIdentifier);
+	int									randomInt(int exclusiveMax);
+	TankSpawnInfo						getSpawnInfo(sf::Int32 tankIdentifier) const;
 
 public:
 	sf::Time							now() const;
@@ -75,7 +165,14 @@ public:
 
 private:
 	sf::Thread							mThread;
+	Mode								mMode;
+	unsigned short						mPort;
+	sf::Time							mTickInterval;
 	sf::Clock							mClock;
+	sf::Time							mVirtualTime;
+	sf::Time							mLastUpdateTime;
+	sf::Time							mStepTime;
+	sf::Time							mTickTime;
 	sf::TcpListener						mListenerSocket;
 	bool								mListeningState;
 	sf::Time							mClientTimeoutTime;
@@ -94,6 +191,29 @@ private:
 	sf::Int32							mTankIdentifierCounter;
 	bool								mWaitingThreadEnd;
 
+	sf::Uint32							mTick;
+	int									mConnectionCounter;
+	NetworkSimulator					mSimulator;
+	PacketRecorder						mRecorder;
+	Statistics							mStatistics;
+
+	std::map<sf::Uint64, SuspendedSession>	mSuspendedSessions;
+	std::mt19937_64						mTokenGenerator;
+	std::default_random_engine			mRandomEngine;
+
+	// Rollback matches: set by the first relayed input, clients need no snapshots from then on
+	bool								mRollbackRunning;
+
+	// Lockstep matches: inputs per tick and tank, sent out as one bundle once all tanks' inputs are in
+	bool								mLockstepRunning;
+	sf::Uint32							mLockstepTick;
+	std::vector<sf::Int32>				mLockstepTanks;
+	std::map<sf::Uint32, std::map<sf::Int32, sf::Uint8>>	mLockstepInputs;
+	std::map<sf::Int32, sf::Uint8>		mLastLockstepInputs;
+	sf::Time							mLastBundleTime;
+	std::map<sf::Uint32, sf::Uint32>	mLockstepChecksums;
+	bool								mDesyncReported;
+
 	sf::Time							mLastSpawnTime;
 	sf::Time							mTimeForNextSpawn;
 };
\ No newline at end of file
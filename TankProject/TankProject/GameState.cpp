@@ -1,5 +1,6 @@
 #include "GameState.hpp"
 #include "MusicPlayer.hpp"
+#include "Statistics.hpp"
 #include <iostream>
 #include <fstream>
 
@@ -8,7 +9,7 @@
 
 GameState::GameState(StateStack& stack, Context context)
 	: State(stack, context)
-	, mWorld(*context.window, *context.fonts, *context.sounds, false)
+	, mWorld(*context.window, *context.fonts, *context.sounds, false, nullptr, *context.graphics)
 	, mPlayer(nullptr, 1, context.keys1)
 	, LiberatorTank(mWorld.addTank(1, Tank::Hotchkiss))
 {
@@ -23,6 +24,7 @@ GameState::GameState(StateStack& stack, Context context)
 void GameState::draw()
 {
 	mWorld.draw();
+	getContext().statistics->drawCalls = mWorld.getDrawCalls();
 }
 
 bool GameState::update(sf::Time dt)
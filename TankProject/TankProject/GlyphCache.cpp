@@ -0,0 +1,137 @@
+#include "GlyphCache.hpp"
+
+#include <SFML/Graphics/Font.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+
+GlyphCache::GlyphCache(const sf::Font& font, unsigned int characterSize, const std::string& characters)
+	: mFont(font)
+	, mTexture(nullptr)
+	, mCharacterSize(characterSize)
+	, mSpaceAdvance(mFont.getGlyph(' ', characterSize, false).advance)
+	, mFallbackSlot(-1)
+	, mSlots()
+	, mGlyphs()
+	, mKerning()
+{
+	mSlots.fill(-1);
+
+	for (std::size_t i = 0; i < characters.size(); ++i)
+	{
+		unsigned char character = static_cast<unsigned char>(characters[i]);
+		if (character >= mSlots.size() || mSlots[character] >= 0)
+			continue;
+
+		const sf::Glyph& loaded = mFont.getGlyph(character, characterSize, false);
+
+		Glyph glyph;
+		glyph.advance = loaded.advance;
+		glyph.bounds = loaded.bounds;
+		glyph.textureRect = loaded.textureRect;
+
+		mSlots[character] = static_cast<int>(mGlyphs.size());
+		mGlyphs.push_back(glyph);
+	}
+
+	mFallbackSlot = mSlots['?'];
+
+	// Kerning between every pair, in slot order
+	mKerning.resize(mGlyphs.size() * mGlyphs.size(), 0.f);
+	for (std::size_t first = 0; first < mSlots.size(); ++first)
+	{
+		for (std::size_t second = 0; second < mSlots.size(); ++second)
+		{
+			if (mSlots[first] >= 0 && mSlots[second] >= 0)
+				mKerning[mSlots[first] * mGlyphs.size() + mSlots[second]] = mFont.getKerning(first, second, characterSize);
+		}
+	}
+
+	// Taken last, every glyph is in it by now
+	mTexture = &mFont.getTexture(characterSize);
+}
+
+const sf::Texture& GlyphCache::getTexture() const
+{
+	return *mTexture;
+}
+
+sf::FloatRect GlyphCache::layout(const std::string& text, sf::Color color, std::vector<sf::Vertex>& vertices) const
+{
+	if (text.empty())
+		return sf::FloatRect();
+
+	std::size_t firstVertex = vertices.size();
+
+	// Same pen movement and bounds as sf::Text, on one line
+	float x = 0.f;
+	float y = static_cast<float>(mCharacterSize);
+	float minX = static_cast<float>(mCharacterSize);
+	float minY = static_cast<float>(mCharacterSize);
+	float maxX = 0.f;
+	float maxY = 0.f;
+	int previous = -1;
+
+	for (std::size_t i = 0; i < text.size(); ++i)
+	{
+		unsigned char character = static_cast<unsigned char>(text[i]);
+
+		if (character == ' ')
+		{
+			minX = std::min(minX, x);
+			minY = std::min(minY, y);
+			x += mSpaceAdvance;
+			maxX = std::max(maxX, x);
+			maxY = std::max(maxY, y);
+			previous = -1;
+			continue;
+		}
+
+		int slot = character < mSlots.size() ? mSlots[character] : -1;
+		if (slot < 0)
+			slot = mFallbackSlot;
+		if (slot < 0)
+			continue;
+
+		if (previous >= 0)
+			x += mKerning[previous * mGlyphs.size() + slot];
+		previous = slot;
+
+		const Glyph& glyph = mGlyphs[slot];
+		float left = x + glyph.bounds.left;
+		float top = y + glyph.bounds.top;
+		float right = left + glyph.bounds.width;
+		float bottom = top + glyph.bounds.height;
+
+		float u1 = static_cast<float>(glyph.textureRect.left);
+		float v1 = static_cast<float>(glyph.textureRect.top);
+		float u2 = u1 + glyph.textureRect.width;
+		float v2 = v1 + glyph.textureRect.height;
+
+		vertices.push_back(sf::Vertex(sf::Vector2f(left, top), color, sf::Vector2f(u1, v1)));
+		vertices.push_back(sf::Vertex(sf::Vector2f(right, top), color, sf::Vector2f(u2, v1)));
+		vertices.push_back(sf::Vertex(sf::Vector2f(left, bottom), color, sf::Vector2f(u1, v2)));
+		vertices.push_back(sf::Vertex(sf::Vector2f(left, bottom), color, sf::Vector2f(u1, v2)));
+		vertices.push_back(sf::Vertex(sf::Vector2f(right, top), color, sf::Vector2f(u2, v1)));
+		vertices.push_back(sf::Vertex(sf::Vector2f(right, bottom), color, sf::Vector2f(u2, v2)));
+
+		minX = std::min(minX, left);
+		maxX = std::max(maxX, right);
+		minY = std::min(minY, top);
+		maxY = std::max(maxY, bottom);
+
+		x += glyph.advance;
+	}
+
+	if (maxX < minX || maxY < minY)
+		return sf::FloatRect();
+
+	// Centred the way centerOrigin() centres a text
+	sf::Vector2f origin(std::floor(minX + (maxX - minX) / 2.f), std::floor(minY + (maxY - minY) / 2.f));
+	for (std::size_t i = firstVertex; i < vertices.size(); ++i)
+		vertices[i].position -= origin;
+
+	return sf::FloatRect(minX - origin.x, minY - origin.y, maxX - minX, maxY - minY);
+}
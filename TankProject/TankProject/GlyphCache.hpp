@@ -0,0 +1,54 @@
+#pragma once
+
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Font.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+
+#include <array>
+#include <string>
+#include <vector>
+
+
+namespace sf
+{
+	class Texture;
+}
+
+// The glyphs of a fixed set of characters at one size, loaded once up front into a copy of the font
+// that nothing else uses. Laying out text from it matches sf::Text without touching the font again,
+// and an sf::Text using the original font loads its glyphs into the original's texture, so the cache's
+// texture never changes while another thread may be drawing it.
+class GlyphCache : private sf::NonCopyable
+{
+public:
+							GlyphCache(const sf::Font& font, unsigned int characterSize, const std::string& characters);
+
+	const sf::Texture&		getTexture() const;
+
+	// Appends the text as triangles, centred on the origin like a text after centerOrigin(), and
+	// returns their bounds. Characters that are not cached are drawn as '?', or left out if that is
+	// not cached either.
+	sf::FloatRect			layout(const std::string& text, sf::Color color, std::vector<sf::Vertex>& vertices) const;
+
+
+private:
+	struct Glyph
+	{
+		float				advance;
+		sf::FloatRect		bounds;
+		sf::IntRect			textureRect;
+	};
+
+
+private:
+	sf::Font					mFont;		// its own copy, so its glyph pages are its own
+	const sf::Texture*			mTexture;
+	unsigned int				mCharacterSize;
+	float						mSpaceAdvance;
+	int							mFallbackSlot;	// '?', -1 if not cached
+	std::array<int, 128>		mSlots;		// index into mGlyphs per ASCII character, -1 if not cached
+	std::vector<Glyph>			mGlyphs;
+	std::vector<float>			mKerning;	// mGlyphs.size() squared, first glyph major
+};
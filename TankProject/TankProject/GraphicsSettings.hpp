@@ -0,0 +1,19 @@
+#pragma once
+
+#include "BloomEffect.hpp"
+
+
+// Graphics options chosen at startup (owned by Application). The default is high quality bloom that
+// steps down while frames run slow and back up once they recover; TankProject --bloom off|low|high
+// fixes the quality instead.
+struct GraphicsSettings
+{
+	GraphicsSettings()
+		: bloomQuality(BloomEffect::High)
+		, bloomAdaptive(true)
+	{
+	}
+
+	BloomEffect::Quality	bloomQuality;		// the quality bloom starts at
+	bool					bloomAdaptive;		// whether it follows the render thread's frame times
+};
@@ -0,0 +1,235 @@
+#include "InterpolationReplay.hpp"
+#include "SnapshotInterpolator.hpp"
+#include "NetworkProtocol.hpp"
+#include "Foreach.hpp"
+#include "Utility.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+	// The game samples every remote tank once per drawn frame
+	const sf::Time FrameInterval = sf::seconds(1.f / 60.f);
+
+	const sf::Time TickInterval = sf::seconds(1.f / ServerTickRate);
+
+	// The snapshots of one server tick, which arrive together
+	struct TraceTick
+	{
+		TraceTick()
+			: delivered(false), arrival(sf::Time::Zero), tanks()
+		{
+		}
+
+		bool											delivered;
+		sf::Time										arrival;
+		std::vector<std::pair<sf::Int32, TankSnapshot>>	tanks;
+	};
+
+	struct ErrorStatistics
+	{
+		ErrorStatistics()
+			: samples(0), total(0.0), worst(0.f)
+		{
+		}
+
+		void add(float error)
+		{
+			++samples;
+			total += error;
+			worst = std::max(worst, error);
+		}
+
+		float mean() const
+		{
+			return samples > 0 ? static_cast<float>(total / samples) : 0.f;
+		}
+
+		std::size_t		samples;
+		double			total;
+		float			worst;
+	};
+
+	// Where a tank really was, per tick
+	typedef std::map<sf::Uint32, sf::Vector2f> Path;
+
+	bool getTruePosition(const Path& path, float tick, sf::Vector2f& position)
+	{
+		if (path.empty() || tick < path.begin()->first || tick > path.rbegin()->first)
+			return false;
+
+		auto next = path.lower_bound(static_cast<sf::Uint32>(std::ceil(tick)));
+		if (next == path.begin())
+		{
+			position = next->second;
+			return true;
+		}
+
+		auto previous = std::prev(next);
+		float t = (tick - previous->first) / static_cast<float>(next->first - previous->first);
+		position = previous->second + (next->second - previous->second) * t;
+		return true;
+	}
+
+	bool readTrace(const std::string& filename, std::map<sf::Uint32, TraceTick>& ticks, std::map<sf::Int32, Path>& paths)
+	{
+		std::ifstream file(filename);
+		if (!file)
+			return false;
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::istringstream stream(line);
+			std::string arrival;
+			sf::Int32 identifier;
+			TankSnapshot snapshot;
+			if (!(stream >> arrival >> snapshot.tick >> identifier >> snapshot.position.x >> snapshot.position.y >> snapshot.rotation >> snapshot.turretRotation))
+				continue;
+
+			TraceTick& tick = ticks[snapshot.tick];
+			if (arrival != "-")
+			{
+				tick.delivered = true;
+				tick.arrival = sf::microseconds(std::stoll(arrival));
+			}
+
+			tick.tanks.push_back(std::make_pair(identifier, snapshot));
+			paths[identifier][snapshot.tick] = snapshot.position;
+		}
+
+		return true;
+	}
+}
+
+int runInterpolationReplay(const std::string& filename, unsigned int stallTicks, unsigned int stallInterval)
+{
+	std::map<sf::Uint32, TraceTick> ticks;
+	std::map<sf::Int32, Path> paths;
+	if (!readTrace(filename, ticks, paths) || ticks.empty())
+	{
+		std::cout << "Interpolation: cannot read trace " << filename << std::endl;
+		return 1;
+	}
+
+	// The client clock against the server's, as a perfect clock sync would have it: the fastest delivery
+	// took no time
+	bool hasOffset = false;
+	sf::Time offset = sf::Time::Zero;
+	FOREACH(auto& pair, ticks)
+	{
+		sf::Time sent = TickInterval * static_cast<float>(pair.first);
+		if (pair.second.delivered && (!hasOffset || pair.second.arrival - sent < offset))
+		{
+			offset = pair.second.arrival - sent;
+			hasOffset = true;
+		}
+	}
+
+	if (!hasOffset)
+	{
+		std::cout << "Interpolation: no snapshot in " << filename << " arrived" << std::endl;
+		return 1;
+	}
+
+	// Stalled snapshots arrive along with the first one after them that gets through
+	std::size_t lost = 0;
+	std::size_t held = 0;
+	bool hasRelease = false;
+	sf::Time release = sf::Time::Zero;
+	sf::Uint32 firstTick = ticks.begin()->first;
+	for (auto itr = ticks.rbegin(); itr != ticks.rend(); ++itr)
+	{
+		TraceTick& tick = itr->second;
+		bool stalled = stallTicks > 0 && stallInterval > 0 && (itr->first - firstTick) % stallInterval < stallTicks;
+
+		if (!tick.delivered)
+		{
+			++lost;
+		}
+		else if (!stalled)
+		{
+			hasRelease = true;
+			release = tick.arrival;
+		}
+		else if (hasRelease)
+		{
+			tick.arrival = std::max(tick.arrival, release);
+			++held;
+		}
+		else
+		{
+			tick.delivered = false;
+			++lost;
+		}
+	}
+
+	std::vector<std::pair<sf::Time, sf::Uint32>> deliveries;
+	FOREACH(auto& pair, ticks)
+	{
+		if (pair.second.delivered)
+			deliveries.push_back(std::make_pair(pair.second.arrival, pair.first));
+	}
+	std::sort(deliveries.begin(), deliveries.end());
+
+	SnapshotInterpolator interpolator(TickInterval);
+	std::map<sf::Int32, sf::Uint32> newestTicks;
+	ErrorStatistics allFrames;
+	ErrorStatistics gapFrames;
+
+	std::size_t next = 0;
+	sf::Time endTime = deliveries.back().first;
+	for (sf::Time now = deliveries.front().first; now <= endTime; now += FrameInterval)
+	{
+		float serverTick = (now - offset) / TickInterval;
+		interpolator.setServerTickEstimate(serverTick);
+
+		for (; next < deliveries.size() && deliveries[next].first <= now; ++next)
+		{
+			const TraceTick& tick = ticks[deliveries[next].second];
+			interpolator.onSnapshotReceived(deliveries[next].second, tick.arrival);
+
+			FOREACH(auto& tank, tick.tanks)
+			{
+				interpolator.pushSnapshot(tank.first, tank.second);
+				newestTicks[tank.first] = std::max(newestTicks[tank.first], tank.second.tick);
+			}
+		}
+
+		interpolator.update(FrameInterval);
+
+		// Compared with the true state at the moment the interpolator means to show
+		float playbackTick = serverTick - interpolator.getInterpolationDelay() / TickInterval;
+		FOREACH(auto& pair, paths)
+		{
+			TankSnapshot shown;
+			sf::Vector2f truth;
+			if (!interpolator.sample(pair.first, shown) || !getTruePosition(pair.second, playbackTick, truth))
+				continue;
+
+			float error = length(shown.position - truth);
+			allFrames.add(error);
+			if (playbackTick > newestTicks[pair.first])
+				gapFrames.add(error);
+		}
+	}
+
+	std::cout << "Interpolation: " << ticks.size() << " ticks of " << paths.size() << " tanks over "
+		<< (endTime - deliveries.front().first).asSeconds() << "s, " << lost << " lost, " << held << " held back" << std::endl;
+	std::cout << "Interpolation: " << allFrames.samples << " samples, mean error " << allFrames.mean()
+		<< "px, worst " << allFrames.worst << "px" << std::endl;
+	std::cout << "Interpolation: " << gapFrames.samples << " samples past the newest snapshot, mean error " << gapFrames.mean()
+		<< "px, worst " << gapFrames.worst << "px" << std::endl;
+	std::cout << "Interpolation: final delay " << interpolator.getInterpolationDelay().asMilliseconds() << "ms, jitter "
+		<< interpolator.getJitter().asMilliseconds() << "ms" << std::endl;
+
+	return 0;
+}
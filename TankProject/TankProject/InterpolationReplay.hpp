@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+
+// Feeds a snapshot trace recorded by a client (see interpolationtrace.txt) through a SnapshotInterpolator
+// in virtual time and reports how far the tanks it shows are from where they really were. A trace line
+// is "arrival tick identifier x y rotation turretRotation", with the arrival in microseconds of client
+// time, or "-" for a snapshot that never arrived. Every stallInterval ticks, stallTicks snapshots in a
+// row are also held back until the one after them arrives, as a stalled connection would; 0 for none.
+// Returns the process exit code.
+int runInterpolationReplay(const std::string& filename, unsigned int stallTicks, unsigned int stallInterval);
@@ -0,0 +1,64 @@
+#include "LabelNode.hpp"
+#include "GlyphCache.hpp"
+#include "SpriteBatch.hpp"
+
+#include <SFML/Graphics/RenderTarget.hpp>
+
+#include <memory>
+
+
+namespace
+{
+	// Same size as a TextNode; every printable ASCII character, labels and world texts alike
+	const unsigned int CharacterSize = 20;
+	const char* const Characters = " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~";
+
+	std::unique_ptr<GlyphCache> Glyphs;
+}
+
+LabelNode::LabelNode(const FontHolder& fonts)
+	: mString()
+	, mVertices()
+	, mBounds()
+{
+	loadGlyphs(fonts);
+}
+
+void LabelNode::loadGlyphs(const FontHolder& fonts)
+{
+	if (!Glyphs)
+		Glyphs.reset(new GlyphCache(fonts.get(Fonts::Main), CharacterSize, Characters));
+}
+
+const GlyphCache& LabelNode::getGlyphs()
+{
+	return *Glyphs;
+}
+
+void LabelNode::setString(const std::string& text)
+{
+	// Labels are set every frame but seldom change
+	if (text == mString)
+		return;
+
+	mString = text;
+	mVertices.clear();
+	mBounds = Glyphs->layout(text, sf::Color::White, mVertices);
+	markBoundsDirty();
+}
+
+void LabelNode::drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const
+{
+	states.texture = &Glyphs->getTexture();
+	target.draw(mVertices.data(), mVertices.size(), sf::Triangles, states);
+}
+
+void LabelNode::batchCurrent(SpriteBatch& batch, sf::RenderStates states) const
+{
+	batch.drawOverlay(mVertices.data(), mVertices.size(), Glyphs->getTexture(), states.transform);
+}
+
+sf::FloatRect LabelNode::getDrawBounds() const
+{
+	return mBounds;
+}
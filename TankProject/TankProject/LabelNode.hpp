@@ -0,0 +1,39 @@
+#pragma once
+#include "ResourceHolder.hpp"
+#include "ResourceIdentifiers.hpp"
+#include "SceneNode.hpp"
+
+#include <SFML/Graphics/Vertex.hpp>
+
+#include <string>
+#include <vector>
+
+
+class GlyphCache;
+
+// A short line of text above an entity (hitpoints, ammo), laid out from a glyph cache of the main font
+// instead of an sf::Text. Batched labels all go into one overlay stream drawn in a single call.
+class LabelNode : public SceneNode
+{
+public:
+	explicit			LabelNode(const FontHolder& fonts);
+
+	// Loads the cached glyphs if they are not yet; a label does so itself otherwise
+	static void			loadGlyphs(const FontHolder& fonts);
+	// The cache every label lays out from; loadGlyphs() must have run
+	static const GlyphCache&	getGlyphs();
+
+	void				setString(const std::string& text);
+
+
+private:
+	virtual void		drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const;
+	virtual void		batchCurrent(SpriteBatch& batch, sf::RenderStates states) const;
+	virtual sf::FloatRect	getDrawBounds() const;
+
+
+private:
+	std::string				mString;
+	std::vector<sf::Vertex>	mVertices;
+	sf::FloatRect			mBounds;
+};
@@ -0,0 +1,108 @@
+#include "LockstepSession.hpp"
+#include "World.hpp"
+#include "Player.hpp"
+#include "Foreach.hpp"
+#include "Utility.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+
+LockstepSession::LockstepSession(World& world, sf::Time tickTime)
+	: mWorld(world)
+	, mTickTime(tickTime)
+	, mRunning(false)
+	, mPlayers()
+	, mBundles()
+	, mTick(0)
+	, mNextInputTick(0)
+	, mHistory(HistorySize)
+	, mHistoryTicks()
+{
+	mHistoryTicks.fill(std::numeric_limits<sf::Uint32>::max());
+}
+
+void LockstepSession::addPlayer(sf::Int32 identifier, Player& player)
+{
+	mPlayers[identifier] = &player;
+}
+
+void LockstepSession::start()
+{
+	// Every peer starts from the same random sequence
+	randomEngine().seed(static_cast<unsigned int>(mPlayers.size() * 7919 + mPlayers.begin()->first));
+
+	mRunning = true;
+	std::cout << "Lockstep: started with " << mPlayers.size() << " tanks, input delay " << InputDelay << " ticks" << std::endl;
+}
+
+bool LockstepSession::isRunning() const
+{
+	return mRunning;
+}
+
+bool LockstepSession::isInputDue(sf::Uint32& tick) const
+{
+	// Before the first bundle arrives, this fills the delay window with input for ticks 0 to InputDelay
+	if (mNextInputTick > mTick + InputDelay)
+		return false;
+
+	tick = mNextInputTick;
+	return true;
+}
+
+void LockstepSession::inputSent()
+{
+	++mNextInputTick;
+}
+
+void LockstepSession::addBundle(sf::Uint32 tick, const std::vector<LockstepInput>& inputs)
+{
+	if (tick >= mTick)
+		mBundles[tick] = inputs;
+}
+
+bool LockstepSession::step(sf::Uint32& tick, sf::Uint32& checksum)
+{
+	if (!mRunning)
+		return false;
+
+	auto bundle = mBundles.find(mTick);
+	if (bundle == mBundles.end())
+		return false;
+
+	// Bundles are sorted by identifier on the server, so commands are queued in the same order everywhere
+	CommandQueue& commands = mWorld.getCommandQueue();
+	FOREACH(const LockstepInput& input, bundle->second)
+	{
+		auto player = mPlayers.find(input.identifier);
+		if (player != mPlayers.end())
+			player->second->applyActionMask(input.actions, commands);
+	}
+
+	mWorld.update(mTickTime);
+	mBundles.erase(bundle);
+
+	WorldSnapshot& snapshot = mHistory[mTick % HistorySize];
+	mWorld.saveSnapshot(snapshot);
+	mHistoryTicks[mTick % HistorySize] = mTick;
+
+	tick = mTick++;
+	checksum = computeChecksum(snapshot);
+	return true;
+}
+
+bool LockstepSession::writeDesyncDump(sf::Uint32 tick, const std::string& filename) const
+{
+	if (mHistoryTicks[tick % HistorySize] != tick)
+		return false;
+
+	std::ofstream file(filename);
+	if (!file)
+		return false;
+
+	file << "tick " << tick << "\n";
+	writeSnapshot(file, mHistory[tick % HistorySize]);
+	return true;
+}
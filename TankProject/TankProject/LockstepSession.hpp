@@ -0,0 +1,73 @@
+#pragma once
+
+#include "WorldSnapshot.hpp"
+#include "NetworkProtocol.hpp"
+
+#include <SFML/System/Time.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/Config.hpp>
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+
+class World;
+class Player;
+
+// One tank's input for a lockstep tick
+struct LockstepInput
+{
+	sf::Int32				identifier;
+	sf::Uint8				actions;
+};
+
+// Deterministic lockstep: every peer simulates the same ticks from the same inputs, so nothing
+// but inputs ever crosses the network. Local input is sent InputDelay ticks ahead of the tick it
+// applies to; the server collects the inputs of all tanks into one bundle per tick, and a tick is
+// only simulated once its bundle has arrived.
+// After each tick the world is hashed; the server compares the hashes of all peers, and on a
+// mismatch each peer writes the state it had at that tick to disk.
+class LockstepSession : private sf::NonCopyable
+{
+public:
+	static const sf::Uint32		InputDelay = LockstepInputDelay;
+	static const sf::Uint32		MaxTicksPerUpdate = 3;
+	static const std::size_t	HistorySize = 64;
+
+
+public:
+	explicit					LockstepSession(World& world, sf::Time tickTime);
+
+	void						addPlayer(sf::Int32 identifier, Player& player);
+	void						start();
+	bool						isRunning() const;
+
+	// Next tick to send local input for, if it is due. Call inputSent() once it went out.
+	bool						isInputDue(sf::Uint32& tick) const;
+	void						inputSent();
+
+	void						addBundle(sf::Uint32 tick, const std::vector<LockstepInput>& inputs);
+
+	// Simulates the next tick if its bundle is there, and hashes the result
+	bool						step(sf::Uint32& tick, sf::Uint32& checksum);
+
+	bool						writeDesyncDump(sf::Uint32 tick, const std::string& filename) const;
+
+
+private:
+	World&											mWorld;
+	sf::Time										mTickTime;
+	bool											mRunning;
+
+	std::map<sf::Int32, Player*>					mPlayers;
+	std::map<sf::Uint32, std::vector<LockstepInput>>	mBundles;
+
+	sf::Uint32										mTick;
+	sf::Uint32										mNextInputTick;
+
+	// State after each of the last HistorySize ticks, for desync dumps
+	std::vector<WorldSnapshot>						mHistory;
+	std::array<sf::Uint32, HistorySize>				mHistoryTicks;
+};
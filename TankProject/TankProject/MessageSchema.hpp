@@ -0,0 +1,476 @@
+#pragma once
+
+#include "Foreach.hpp"
+
+#include <SFML/Network/Packet.hpp>
+#include <SFML/Config.hpp>
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+// A network message is a plain struct that lists its fields once, in wire order:
+//
+//	struct ExampleMessage
+//	{
+//		static const sf::Int32	Type = Server::Example;		// only for messages sent as a packet
+//
+//		sf::Int32				identifier;
+//		std::vector<float>		values;
+//
+//		template <typename Archive, typename Self>
+//		static void fields(Archive& archive, Self& self)
+//		{
+//			archive & self.identifier & self.values;
+//		}
+//	};
+//
+// Every encoder, decoder and size function below is generated from that list, so the writer and
+// the reader of a message cannot disagree on its layout. Fields may be fixed width integers, bool,
+// float, double, std::string, std::vector of any of these, or another message; anything else
+// (int, std::size_t, an enum...) does not compile.
+//
+// The wire format is the one of sf::Packet: integers in network byte order, bool as one byte,
+// floating point as is, strings as [Uint32:length] {bytes}, vectors as [Int32:count] {elements}.
+// Messages can therefore be written into a packet and read back from its raw bytes, or the other way.
+namespace Schema
+{
+	template <typename T> struct IsScalar : std::false_type {};
+	template <> struct IsScalar<bool> : std::true_type {};
+	template <> struct IsScalar<sf::Int8> : std::true_type {};
+	template <> struct IsScalar<sf::Uint8> : std::true_type {};
+	template <> struct IsScalar<sf::Int16> : std::true_type {};
+	template <> struct IsScalar<sf::Uint16> : std::true_type {};
+	template <> struct IsScalar<sf::Int32> : std::true_type {};
+	template <> struct IsScalar<sf::Uint32> : std::true_type {};
+	template <> struct IsScalar<sf::Int64> : std::true_type {};
+	template <> struct IsScalar<sf::Uint64> : std::true_type {};
+	template <> struct IsScalar<float> : std::true_type {};
+	template <> struct IsScalar<double> : std::true_type {};
+
+
+	namespace Detail
+	{
+		template <typename T>
+		void store(char* bytes, T value, std::true_type /*integral*/)
+		{
+			typedef typename std::make_unsigned<T>::type Unsigned;
+			Unsigned bits = static_cast<Unsigned>(value);
+
+			for (std::size_t i = 0; i < sizeof(T); ++i)
+				bytes[i] = static_cast<char>((bits >> (8 * (sizeof(T) - 1 - i))) & 0xFF);
+		}
+
+		template <typename T>
+		void store(char* bytes, T value, std::false_type /*floating point*/)
+		{
+			std::memcpy(bytes, &value, sizeof(T));
+		}
+
+		template <typename T>
+		T load(const char* bytes, std::true_type /*integral*/)
+		{
+			typedef typename std::make_unsigned<T>::type Unsigned;
+			Unsigned bits = 0;
+
+			for (std::size_t i = 0; i < sizeof(T); ++i)
+				bits = static_cast<Unsigned>((bits << 8) | static_cast<unsigned char>(bytes[i]));
+
+			return static_cast<T>(bits);
+		}
+
+		template <typename T>
+		T load(const char* bytes, std::false_type /*floating point*/)
+		{
+			T value;
+			std::memcpy(&value, bytes, sizeof(T));
+			return value;
+		}
+
+		template <typename T>
+		void store(char* bytes, T value)
+		{
+			store(bytes, value, std::is_integral<T>());
+		}
+
+		inline void store(char* bytes, bool value)
+		{
+			bytes[0] = value ? 1 : 0;
+		}
+
+		template <typename T>
+		void load(const char* bytes, T& value)
+		{
+			value = load<T>(bytes, std::is_integral<T>());
+		}
+
+		inline void load(const char* bytes, bool& value)
+		{
+			value = bytes[0] != 0;
+		}
+	}
+
+
+	// Appends messages to an sf::Packet
+	class PacketWriter
+	{
+	public:
+		explicit PacketWriter(sf::Packet& packet)
+			: mPacket(packet)
+		{
+		}
+
+		template <typename T>
+		PacketWriter& operator& (const T& value)
+		{
+			write(value);
+			return *this;
+		}
+
+	private:
+		template <typename T>
+		typename std::enable_if<IsScalar<T>::value>::type write(const T& value)
+		{
+			mPacket << value;
+		}
+
+		template <typename T>
+		typename std::enable_if<!IsScalar<T>::value>::type write(const T& message)
+		{
+			T::fields(*this, message);
+		}
+
+		void write(const std::string& value)
+		{
+			mPacket << value;
+		}
+
+		template <typename T>
+		void write(const std::vector<T>& values)
+		{
+			mPacket << static_cast<sf::Int32>(values.size());
+			FOREACH(const T& value, values)
+				write(value);
+		}
+
+	private:
+		sf::Packet&		mPacket;
+	};
+
+
+	// Reads messages from an sf::Packet; on malformed data the packet turns invalid and reading stops
+	class PacketReader
+	{
+	public:
+		explicit PacketReader(sf::Packet& packet)
+			: mPacket(packet)
+		{
+		}
+
+		template <typename T>
+		PacketReader& operator& (T& value)
+		{
+			static_assert(!std::is_const<T>::value, "Schema: cannot decode into a const field");
+
+			if (mPacket)
+				read(value);
+
+			return *this;
+		}
+
+	private:
+		template <typename T>
+		typename std::enable_if<IsScalar<T>::value>::type read(T& value)
+		{
+			mPacket >> value;
+		}
+
+		template <typename T>
+		typename std::enable_if<!IsScalar<T>::value>::type read(T& message)
+		{
+			T::fields(*this, message);
+		}
+
+		void read(std::string& value)
+		{
+			mPacket >> value;
+		}
+
+		template <typename T>
+		void read(std::vector<T>& values)
+		{
+			sf::Int32 count = 0;
+			mPacket >> count;
+
+			// Never trust the count: elements are only added while there is data left for them
+			values.clear();
+			for (sf::Int32 i = 0; i < count && mPacket; ++i)
+			{
+				if (mPacket.endOfPacket())
+				{
+					mPacket >> count;	// reads past the end, which marks the packet invalid
+					break;
+				}
+
+				values.push_back(T());
+				read(values.back());
+			}
+		}
+
+	private:
+		sf::Packet&		mPacket;
+	};
+
+
+	// Appends messages to a byte buffer, in the same format as PacketWriter
+	class ByteWriter
+	{
+	public:
+		explicit ByteWriter(std::vector<char>& buffer)
+			: mBuffer(buffer)
+		{
+		}
+
+		template <typename T>
+		ByteWriter& operator& (const T& value)
+		{
+			write(value);
+			return *this;
+		}
+
+	private:
+		template <typename T>
+		typename std::enable_if<IsScalar<T>::value>::type write(const T& value)
+		{
+			std::size_t offset = mBuffer.size();
+			mBuffer.resize(offset + sizeof(T));
+			Detail::store(&mBuffer[offset], value);
+		}
+
+		template <typename T>
+		typename std::enable_if<!IsScalar<T>::value>::type write(const T& message)
+		{
+			T::fields(*this, message);
+		}
+
+		void write(const std::string& value)
+		{
+			write(static_cast<sf::Uint32>(value.size()));
+			mBuffer.insert(mBuffer.end(), value.begin(), value.end());
+		}
+
+		template <typename T>
+		void write(const std::vector<T>& values)
+		{
+			write(static_cast<sf::Int32>(values.size()));
+			FOREACH(const T& value, values)
+				write(value);
+		}
+
+	private:
+		std::vector<char>&	mBuffer;
+	};
+
+
+	// Reads messages from untrusted bytes. Every read is bounds checked and every count is checked
+	// against the bytes left before anything is allocated; the first failure makes the reader invalid.
+	class ByteReader
+	{
+	public:
+		ByteReader(const void* data, std::size_t size)
+			: mData(static_cast<const char*>(data))
+			, mSize(data ? size : 0)
+			, mPosition(0)
+			, mValid(true)
+		{
+		}
+
+		template <typename T>
+		ByteReader& operator& (T& value)
+		{
+			static_assert(!std::is_const<T>::value, "Schema: cannot decode into a const field");
+
+			if (mValid)
+				read(value);
+
+			return *this;
+		}
+
+		bool isValid() const
+		{
+			return mValid;
+		}
+
+		std::size_t getPosition() const
+		{
+			return mPosition;
+		}
+
+	private:
+		bool take(std::size_t bytes, const char*& data)
+		{
+			if (!mValid || bytes > mSize - mPosition)
+			{
+				mValid = false;
+				return false;
+			}
+
+			data = mData + mPosition;
+			mPosition += bytes;
+			return true;
+		}
+
+		template <typename T>
+		typename std::enable_if<IsScalar<T>::value>::type read(T& value)
+		{
+			const char* bytes;
+			if (take(sizeof(T), bytes))
+				Detail::load(bytes, value);
+		}
+
+		template <typename T>
+		typename std::enable_if<!IsScalar<T>::value>::type read(T& message)
+		{
+			T::fields(*this, message);
+		}
+
+		void read(std::string& value)
+		{
+			sf::Uint32 length = 0;
+			read(length);
+
+			const char* bytes;
+			if (mValid && take(length, bytes))
+				value.assign(bytes, length);
+		}
+
+		template <typename T>
+		void read(std::vector<T>& values)
+		{
+			sf::Int32 count = 0;
+			read(count);
+
+			// Every element takes at least one byte
+			values.clear();
+			if (!mValid || count < 0 || static_cast<std::size_t>(count) > mSize - mPosition)
+			{
+				mValid = false;
+				return;
+			}
+
+			values.resize(static_cast<std::size_t>(count));
+			for (std::size_t i = 0; i < values.size() && mValid; ++i)
+				read(values[i]);
+		}
+
+	private:
+		const char*		mData;
+		std::size_t		mSize;
+		std::size_t		mPosition;
+		bool			mValid;
+	};
+
+
+	// Counts the bytes a message takes on the wire
+	class SizeCounter
+	{
+	public:
+		SizeCounter()
+			: mSize(0)
+		{
+		}
+
+		template <typename T>
+		SizeCounter& operator& (const T& value)
+		{
+			count(value);
+			return *this;
+		}
+
+		std::size_t getSize() const
+		{
+			return mSize;
+		}
+
+	private:
+		template <typename T>
+		typename std::enable_if<IsScalar<T>::value>::type count(const T&)
+		{
+			mSize += sizeof(T);
+		}
+
+		template <typename T>
+		typename std::enable_if<!IsScalar<T>::value>::type count(const T& message)
+		{
+			T::fields(*this, message);
+		}
+
+		void count(const std::string& value)
+		{
+			mSize += sizeof(sf::Uint32) + value.size();
+		}
+
+		template <typename T>
+		void count(const std::vector<T>& values)
+		{
+			mSize += sizeof(sf::Int32);
+			FOREACH(const T& value, values)
+				count(value);
+		}
+
+	private:
+		std::size_t		mSize;
+	};
+
+
+	template <typename Message>
+	void encode(sf::Packet& packet, const Message& message)
+	{
+		PacketWriter writer(packet);
+		writer & message;
+	}
+
+	// False if the packet ended early; the message may then be partly filled
+	template <typename Message>
+	bool decode(sf::Packet& packet, Message& message)
+	{
+		PacketReader reader(packet);
+		reader & message;
+		return static_cast<bool>(packet);
+	}
+
+	template <typename Message>
+	void encode(std::vector<char>& buffer, const Message& message)
+	{
+		ByteWriter writer(buffer);
+		writer & message;
+	}
+
+	template <typename Message>
+	bool decode(const void* data, std::size_t size, Message& message)
+	{
+		ByteReader reader(data, size);
+		reader & message;
+		return reader.isValid();
+	}
+
+	template <typename Message>
+	std::size_t encodedSize(const Message& message)
+	{
+		SizeCounter counter;
+		counter & message;
+		return counter.getSize();
+	}
+
+	// Packet type followed by the message; the type comes from the message, so it cannot be mixed up
+	template <typename Message>
+	sf::Packet makePacket(const Message& message)
+	{
+		sf::Packet packet;
+		packet << static_cast<sf::Int32>(Message::Type);
+		encode(packet, message);
+		return packet;
+	}
+}
@@ -2,14 +2,24 @@
 #include "MusicPlayer.hpp"
 #include "Foreach.hpp"
 #include "Utility.hpp"
+#include "Statistics.hpp"
+#include "Compression.hpp"
 
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <SFML/Network/IpAddress.hpp>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
 
+namespace
+{
+	// How long a dropped client keeps trying to get back into its session; the server holds its tanks longer
+	const sf::Time ResumeTimeout = sf::seconds(8.f);
+}
+
+
 
 
 
@@ -30,13 +40,31 @@ sf::IpAddress getAddressFromFile()
 	return localAddress;
 }
 
-MultiplayerGameState::MultiplayerGameState(StateStack& stack, Context context, bool isHost)
+MultiplayerGameState::MultiplayerGameState(StateStack& stack, Context context, bool isHost, SyncMode mode)
 	: State(stack, context)
-	, mWorld(*context.window, *context.fonts, *context.sounds, true)
+	, mWorld()
 	, mWindow(*context.window)
 	, mTextureHolder(*context.textures)
+	, playerTank(nullptr)
+	, secondPlayerTank(nullptr)
+	, mInterpolator(sf::seconds(1.f / ServerTickRate))
+	, mSnapshotTrace()
+	, mNetwork()
+	, mClockSync(sf::seconds(1.f / ServerTickRate))
+	, mSyncMode(mode)
+	, mRollback()
+	, mLockstep()
+	, mLastPingTime(sf::Time::Zero)
 	, mConnected(false)
+	, mServerAddress()
+	, mSessionToken(0)
+	, mResuming(false)
 	, mGameServer(nullptr)
+	, mImages()
+	, mImagesLoaded(false)
+	, mImagesValid(false)
+	, mLoadingThread(&MultiplayerGameState::loadImages, this)
+	, mLoading(true)
 	, mActiveState(true)
 	, mHasFocus(true)
 	, mHost(isHost)
@@ -55,47 +83,60 @@ MultiplayerGameState::MultiplayerGameState(StateStack& stack, Context context, b
 
 	// We reuse this text for "Attempt to connect" and "Failed to connect" messages
 	mFailedConnectionText.setFont(context.fonts->get(Fonts::Main));
-	mFailedConnectionText.setString("Attempting to connect...");
+	mFailedConnectionText.setString("Attempting to connect... (Esc to cancel)");
 	mFailedConnectionText.setCharacterSize(35);
 	mFailedConnectionText.setFillColor(sf::Color::White);
 	centerOrigin(mFailedConnectionText);
 	mFailedConnectionText.setPosition(mWindow.getSize().x / 2.f, mWindow.getSize().y / 2.f);
 
-	// Render a "establishing connection" frame for user feedback
-	mWindow.clear(sf::Color::Black);
-	mWindow.draw(mFailedConnectionText);
-	mWindow.display();
-	mFailedConnectionText.setString("Could not connect to the remote server!");
-	centerOrigin(mFailedConnectionText);
-
-	sf::IpAddress ip;
 	if (isHost)
 	{
 		mGameServer.reset(new GameServer(sf::Vector2f(mWindow.getSize())));
-		ip = "127.0.0.1";
+		mServerAddress = "127.0.0.1";
 
 	}
 	else
 	{
-		ip = getAddressFromFile();
+		mServerAddress = getAddressFromFile();
 	}
 
-	if (mSocket.connect(ip, ServerPort, sf::seconds(5.f)) == sf::TcpSocket::Done)
-		mConnected = true;
-	else
-		mFailedConnectionClock.restart();
+	// Optional trace of the snapshots received, for replaying with --interpolation
+	std::ifstream traceSettings("interpolationtrace.txt");
+	std::string traceFile;
+	if (traceSettings >> traceFile)
+		mSnapshotTrace.open(traceFile, std::ios::trunc);
 
-	mSocket.setBlocking(false);
+	// Optional logging of every network event, while a file netverbose.txt exists
+	mNetwork.setVerbose(std::ifstream("netverbose.txt").good());
+
+	// Both run in the background; update() builds the world once they are done
+	sf::Packet joinPacket = Schema::makePacket(JoinMessage());
+	mNetwork.connect(mServerAddress, ServerPort, sf::seconds(5.f), joinPacket);
+	mLoadingThread.launch();
 
 	// Play game theme
 	context.music->play(Music::MissionTheme);
 }
 
+MultiplayerGameState::~MultiplayerGameState()
+{
+	getContext().statistics->networked = false;
+}
+
 void MultiplayerGameState::draw()
 {
-	if (mConnected)
+	if (mResuming)
+	{
+		mWorld->draw();
+		getContext().statistics->drawCalls = mWorld->getDrawCalls();
+
+		mWindow.setView(mWindow.getDefaultView());
+		mWindow.draw(mFailedConnectionText);
+	}
+	else if (mConnected)
 	{
-		mWorld.draw();
+		mWorld->draw();
+		getContext().statistics->drawCalls = mWorld->getDrawCalls();
 
 		// Broadcast messages in default view
 		mWindow.setView(mWindow.getDefaultView());
@@ -122,32 +163,95 @@ void MultiplayerGameState::onDestroy()
 	if (!mHost && mConnected)
 	{
 		// Inform server this client is dying
-		sf::Packet packet;
-		packet << static_cast<sf::Int32>(Client::Quit);
-		mSocket.send(packet);
+		sf::Packet packet = Schema::makePacket(QuitMessage());
+		mNetwork.send(packet);
+	}
+}
+
+void MultiplayerGameState::loadImages()
+{
+	try
+	{
+		World::loadImages(mImages);
+		mImagesValid = true;
+	}
+	catch (std::exception& e)
+	{
+		// The world then loads its textures itself, and reports the missing file from there
+		std::cout << "Loading: " << e.what() << std::endl;
 	}
+
+	mImagesLoaded = true;
+}
+
+void MultiplayerGameState::updateLoading()
+{
+	if (!mNetwork.isConnecting() && !mNetwork.isConnected())
+	{
+		mLoading = false;
+		showConnectionFailure("Could not connect to the remote server!");
+		return;
+	}
+
+	if (!mNetwork.isConnected() || !mImagesLoaded)
+		return;
+
+	// Only the upload of the decoded images is left, which has to happen on the thread that draws
+	Context context = getContext();
+	mWorld.reset(new World(mWindow, *context.fonts, *context.sounds, true, mImagesValid ? &mImages : nullptr, *context.graphics));
+	mRollback.reset(new RollbackSession(*mWorld, sf::seconds(1.f / ClientTickRate)));
+	mLockstep.reset(new LockstepSession(*mWorld, sf::seconds(1.f / ClientTickRate)));
+
+	mLoading = false;
+	mConnected = true;
+	mTimeSinceLastPacket = sf::Time::Zero;
+	context.statistics->networked = true;
 }
 
 bool MultiplayerGameState::update(sf::Time dt)
 {
+	if (mLoading)
+	{
+		updateLoading();
+		return true;
+	}
+
 	// Connected to server: Handle all the network logic
 	if (mConnected)
 	{
-		mWorld.update(dt);
+		// Only handle the realtime input if the window has focus and the game is unpaused
+		bool acceptsInput = mActiveState && mHasFocus;
+
+		if (mSyncMode == Rollback)
+			updateRollback(acceptsInput);
+		else if (mSyncMode == Lockstep)
+			updateLockstep(acceptsInput);
+		else
+			mWorld->update(dt);
 
 		if (playerTank != nullptr)
 		{
-			mWorld.centerWorldToPlayer(playerTank);
-			mWorld.adaptPlayerTankPosition(playerTank);
+			mWorld->centerWorldToPlayer(playerTank);
+
+			// Clamping to the local view would differ between peers
+			if (mSyncMode == ServerAuthoritative)
+				mWorld->adaptPlayerTankPosition(playerTank);
+		}
+
+		updateClockSync();
+		if (mSyncMode == ServerAuthoritative)
+		{
+			reconcileLocalTanks();
+			interpolateRemoteTanks(dt);
 		}
 
 		//Check for win
-		if (!mWorld.hasAlivePlayer())
+		if (!mWorld->hasAlivePlayer())
 		{
 			//mPlayer.setMissionStatus(Player::MissionFailure);
 			//requestStackPush(States::GameOver);
 		}
-		else if (mWorld.hasLiberationBaseBeenDestroyed())
+		else if (mWorld->hasLiberationBaseBeenDestroyed())
 		{
 			//mPlayer.setMissionStatus(Player::ResistanceSuccess);
 			//getContext().sounds->play(SoundEffect::);     //Victory message for Resistance
@@ -155,14 +259,14 @@ bool MultiplayerGameState::update(sf::Time dt)
 			std::ofstream outputFile;
 			outputFile.open("highscore.txt", std::ios_base::app);
 
-			outputFile << "Resistance success! They got " << mWorld.getResistanceKills() << " Kills \n";
+			outputFile << "Resistance success! They got " << mWorld->getResistanceKills() << " Kills \n";
 
 			
 			outputFile << "Vive Le Resistance! \n";
 
 			outputFile.close();
 		}
-		else if (mWorld.hasResistanceBaseBeenDestroyed())
+		else if (mWorld->hasResistanceBaseBeenDestroyed())
 		{
 			//mPlayer.setMissionStatus(Player::LiberatorSuccess);
 			//getContext().sounds->play(SoundEffect::);    //Victory Messagew for Liberators
@@ -170,14 +274,14 @@ bool MultiplayerGameState::update(sf::Time dt)
 			std::ofstream outputFile;
 			outputFile.open("highscore.txt", std::ios_base::app);
 
-			outputFile << "Liberation success! They got " << mWorld.getLiberationKills() << " Kills \n";
+			outputFile << "Liberation success! They got " << mWorld->getLiberationKills() << " Kills \n";
 
 
 			outputFile << "OohRah! Operation Liberation Success! \n";
 
 			outputFile.close();
 		}
-		else if (mWorld.hasBaseBeenDestroyed())
+		else if (mWorld->hasBaseBeenDestroyed())
 		{
 			//mPlayer.setMissionStatus(Player::MissionSuccess);
 			getContext().sounds->play(SoundEffect::Freedum);
@@ -194,8 +298,11 @@ bool MultiplayerGameState::update(sf::Time dt)
 				foundLocalPlane = true;
 			}
 
-			if (!mWorld.getTank(itr->first))
+			// Input sessions keep their players: a rolled back frame may bring the tank back, and lockstep bundles still name it
+			if (!mWorld->getTank(itr->first) && !isInputSession())
 			{
+				mPredictions.erase(itr->first);
+				mInterpolator.removeEntity(itr->first);
 				itr = mPlayers.erase(itr);
 
 				// No more players left: Mission failed
@@ -213,39 +320,65 @@ bool MultiplayerGameState::update(sf::Time dt)
 			//requestStackPush(States::GameOver);
 		}
 
-		// Only handle the realtime input if the window has focus and the game is unpaused
-		if (mActiveState && mHasFocus)
+		// In rollback and lockstep mode the session applies the inputs itself
+		if (acceptsInput && mSyncMode == ServerAuthoritative)
 		{
-			CommandQueue& commands = mWorld.getCommandQueue();
+			CommandQueue& commands = mWorld->getCommandQueue();
 			FOREACH(auto& pair, mPlayers)
 				pair.second->handleRealtimeInput(commands);
 		}
 
+		// Number the input each local tank will simulate next frame, so the server can acknowledge it
+		FOREACH(sf::Int32 identifier, mLocalPlayerIdentifiers)
+		{
+			auto prediction = mPredictions.find(identifier);
+			if (prediction != mPredictions.end())
+				prediction->second.pushInput(acceptsInput ? mPlayers[identifier]->getRealtimeActionMask() : 0, dt);
+		}
+
+		if (mSyncMode == ServerAuthoritative)
+			sendInputFrames();
+
 		// Always handle the network input
-		CommandQueue& commands = mWorld.getCommandQueue();
+		CommandQueue& commands = mWorld->getCommandQueue();
 		FOREACH(auto& pair, mPlayers)
 			pair.second->handleRealtimeNetworkInput(commands);
 
-		// Handle messages from server that may have arrived
-		sf::Packet packet;
-		if (mSocket.receive(packet) == sf::Socket::Done)
+		// Handle all messages the network thread has received since last frame
+		NetworkMessage message;
+		bool receivedMessage = false;
+		while (mNetwork.poll(message))
+		{
+			receivedMessage = true;
+
+			if (message.type == PongMessage::Type)
+			{
+				PongMessage pong;
+				if (Schema::decode(message.packet, pong))
+					mClockSync.onPong(sf::microseconds(pong.clientTime), sf::microseconds(pong.serverTime), pong.serverTick, message.receivedAt);
+			}
+			else
+			{
+				handlePacket(message.type, message.packet);
+			}
+		}
+
+		if (receivedMessage)
 		{
 			mTimeSinceLastPacket = sf::seconds(0.f);
-			sf::Int32 packetType;
-			packet >> packetType;
-			handlePacket(packetType, packet);
 		}
 		else
 		{
 			// Check for timeout with the server
-			if (mTimeSinceLastPacket > mClientTimeout)
+			if (mTimeSinceLastPacket > mClientTimeout || !mNetwork.isConnected())
 			{
 				mConnected = false;
 
-				mFailedConnectionText.setString("Lost connection to server");
-				centerOrigin(mFailedConnectionText);
-
-				mFailedConnectionClock.restart();
+				// Input sessions cannot skip the inputs missed meanwhile, only server driven games resume
+				if (mSessionToken != 0 && mSyncMode == ServerAuthoritative)
+					beginResume();
+				else
+					showConnectionFailure("Lost connection to server");
 			}
 		}
 
@@ -257,47 +390,63 @@ bool MultiplayerGameState::update(sf::Time dt)
 
 		// Events occurring in the game
 		GameActions::Action gameAction;
-		while (mWorld.pollGameAction(gameAction))
+		while (mWorld->pollGameAction(gameAction))
 		{
-			sf::Packet packet;
-			packet << static_cast<sf::Int32>(Client::GameEvent);
-			packet << static_cast<sf::Int32>(gameAction.type);
-			packet << gameAction.position.x;
-			packet << gameAction.position.y;
+			GameEventMessage event;
+			event.action = static_cast<sf::Int32>(gameAction.type);
+			event.x = gameAction.position.x;
+			event.y = gameAction.position.y;
+			sf::Packet packet = Schema::makePacket(event);
 
 			if(gameAction.type == GameActions::KillCount)
 			{ ///Check for kills, increment kill count for team
 				//bool isLibertor = gameAction.isLiberator;
 				//if liberator
-				//mWorld.addResistanceKill;
+				//mWorld->addResistanceKill;
 
 				//if resistance
-				//mWorld.addLiberatorKill;
+				//mWorld->addLiberatorKill;
 			}
 
-			mSocket.send(packet);
+			mNetwork.send(packet);
 		}
 
 		// Regular position updates
-		if (mTickClock.getElapsedTime() > sf::seconds(1.f / 20.f))
+		if (mSyncMode == ServerAuthoritative && mTickClock.getElapsedTime() > sf::seconds(1.f / 20.f))
 		{
-			sf::Packet positionUpdatePacket;
-			positionUpdatePacket << static_cast<sf::Int32>(Client::PositionUpdate);
-			positionUpdatePacket << static_cast<sf::Int32>(mLocalPlayerIdentifiers.size());
-
+			PositionUpdateMessage update;
 			FOREACH(sf::Int32 identifier, mLocalPlayerIdentifiers)
 			{
-				if (Tank* tank = mWorld.getTank(identifier))
-					positionUpdatePacket << identifier << tank->getPosition().x << tank->getPosition().y << tank->getRotation() << tank->getTurretRotation() << static_cast<sf::Int32>(tank->getHitpoints()) << static_cast<sf::Int32>(tank->getMissileAmmo());
+				Tank* tank = mWorld->getTank(identifier);
+				if (!tank)
+					continue;
+
+				PositionUpdateMessage::Tank state;
+				state.identifier = identifier;
+				state.inputSequence = mPredictions[identifier].getLastRecordedSequence();
+				state.x = tank->getPosition().x;
+				state.y = tank->getPosition().y;
+				state.rotation = tank->getRotation();
+				state.turretRotation = tank->getTurretRotation();
+				state.hitpoints = static_cast<sf::Int32>(tank->getHitpoints());
+				state.missileAmmo = static_cast<sf::Int32>(tank->getMissileAmmo());
+				update.tanks.push_back(state);
 			}
 
-			mSocket.send(positionUpdatePacket);
+			sf::Packet positionUpdatePacket = Schema::makePacket(update);
+			mNetwork.send(positionUpdatePacket);
 			mTickClock.restart();
 		}
 
 		mTimeSinceLastPacket += dt;
 	}
 
+	// Dropped out: trying to get back into the same session
+	else if (mResuming)
+	{
+		updateResume();
+	}
+
 	// Failed to connect and waited for more than 5 seconds: Back to menu
 	else if (mFailedConnectionClock.getElapsedTime() >= sf::seconds(5.f))
 	{
@@ -308,43 +457,279 @@ bool MultiplayerGameState::update(sf::Time dt)
 	return true;
 }
 
+void MultiplayerGameState::beginResume()
+{
+	mResuming = true;
+
+	// Tell the server which tanks we still have, it only sends what changed since
+	ResumeMessage resume;
+	resume.token = mSessionToken;
+	FOREACH(auto& pair, mPlayers)
+		resume.knownTanks.push_back(static_cast<sf::Int32>(pair.first));
+
+	sf::Packet resumePacket = Schema::makePacket(resume);
+
+	mNetwork.disconnect();
+	mNetwork.connect(mServerAddress, ServerPort, ResumeTimeout, resumePacket);
+
+	mFailedConnectionText.setString("Connection lost, reconnecting...");
+	centerOrigin(mFailedConnectionText);
+	std::cout << "Network: connection lost, resuming session" << std::endl;
+}
+
+void MultiplayerGameState::updateResume()
+{
+	// Leftovers of the old connection come first, then the catch-up and ResumeAcceptedMessage
+	NetworkMessage message;
+	while (mResuming && mNetwork.poll(message))
+	{
+		if (message.type != PongMessage::Type)
+			handlePacket(message.type, message.packet);
+	}
+
+	if (mResuming && !mNetwork.isConnecting() && !mNetwork.isConnected())
+	{
+		mResuming = false;
+		showConnectionFailure("Lost connection to server");
+	}
+}
+
+void MultiplayerGameState::showConnectionFailure(const std::string& message)
+{
+	mFailedConnectionText.setString(message);
+	centerOrigin(mFailedConnectionText);
+
+	mFailedConnectionClock.restart();
+}
+
+Tank* MultiplayerGameState::addTank(const TankSpawnInfo& spawn)
+{
+	Tank::Type type = spawn.isLiberator ? Tank::Hotchkiss : Tank::Panzer;
+
+	Tank* tank = mWorld->addTank(spawn.identifier, type);
+	tank->setPosition(spawn.x, spawn.y);
+	tank->setRotation(spawn.rotation);
+	tank->setTurretRotation(spawn.turretRotation);
+	return tank;
+}
+
+void MultiplayerGameState::reconcileLocalTanks()
+{
+	FOREACH(auto& pair, mPredictions)
+	{
+		Tank* tank = mWorld->getTank(pair.first);
+		if (!tank)
+			continue;
+
+		// Store the state produced by the input pushed last frame, then correct it if the server disagreed
+		pair.second.recordState(tank->getMovementState());
+
+		MovementState corrected;
+		float correction;
+		if (pair.second.reconcile(*tank, corrected, correction))
+			tank->setMovementState(corrected);
+	}
+}
+
+void MultiplayerGameState::sendInputFrames()
+{
+	ClientInputFramesMessage message;
+
+	// The newest frames of every local tank; the server drops the ones it already has
+	FOREACH(auto& pair, mPredictions)
+	{
+		message.tanks.push_back(TankInputFrames());
+		TankInputFrames& frames = message.tanks.back();
+		frames.identifier = pair.first;
+		frames.newestSequence = pair.second.getNewestSequence();
+
+		sf::Uint32 frameCount = std::min<sf::Uint32>(frames.newestSequence, RedundantInputFrames);
+		for (sf::Uint32 frame = 0; frame < frameCount; ++frame)
+		{
+			sf::Uint8 actions = 0;
+			pair.second.getActions(frames.newestSequence - frame, actions);
+			frames.actions.push_back(actions);
+		}
+	}
+
+	if (!message.tanks.empty())
+	{
+		sf::Packet packet = Schema::makePacket(message);
+		mNetwork.send(packet);
+	}
+}
+
+void MultiplayerGameState::updateClockSync()
+{
+	sf::Time now = mNetwork.now();
+
+	if (now - mLastPingTime >= sf::seconds(0.5f))
+	{
+		PingMessage ping;
+		ping.clientTime = now.asMicroseconds();
+
+		sf::Packet packet = Schema::makePacket(ping);
+		mNetwork.send(packet);
+
+		mLastPingTime = now;
+	}
+
+	if (mClockSync.isSynchronized())
+	{
+		// Snapshots take half a round trip to get here, so that is the newest tick we can have
+		float oneWayTicks = (mClockSync.getRoundTripTime() / 2.f) / sf::seconds(1.f / ServerTickRate);
+		mInterpolator.setServerTickEstimate(mClockSync.getServerTick(now) - oneWayTicks);
+
+		Statistics& statistics = *getContext().statistics;
+		statistics.roundTripTime = mClockSync.getRoundTripTime();
+		statistics.jitter = mClockSync.getJitter();
+	}
+}
+
+void MultiplayerGameState::updateRollback(bool acceptsInput)
+{
+	if (!mRollback->isRunning())
+	{
+		// A match starts once our tank and exactly one opponent are known; until then nobody moves
+		if (mLocalPlayerIdentifiers.size() != 1 || mPlayers.size() != 2)
+			return;
+
+		sf::Int32 localIdentifier = mLocalPlayerIdentifiers.front();
+		FOREACH(auto& pair, mPlayers)
+		{
+			if (pair.first != localIdentifier)
+				mRollback->start(localIdentifier, *mPlayers[localIdentifier], pair.first, *pair.second);
+		}
+	}
+
+	sf::Int32 localIdentifier = mLocalPlayerIdentifiers.front();
+	sf::Uint32 frame = mRollback->getCurrentFrame();
+	sf::Uint8 actions = acceptsInput ? mPlayers[localIdentifier]->getRealtimeActionMask() : 0;
+
+	// Stalls while the opponent is too far behind; the input is only sent for frames we simulated
+	if (mRollback->advance(actions))
+	{
+		ClientRollbackInputMessage input;
+		input.identifier = localIdentifier;
+		input.frame = frame;
+		input.actions = actions;
+
+		sf::Packet packet = Schema::makePacket(input);
+		mNetwork.send(packet);
+	}
+
+	// Restoring a snapshot can replace the tank nodes
+	playerTank = mWorld->getTank(localIdentifier);
+}
+
+void MultiplayerGameState::updateLockstep(bool acceptsInput)
+{
+	// Inputs start flowing once there is someone to play against; the server starts the match on the first one
+	if (mLocalPlayerIdentifiers.size() != 1 || mPlayers.size() < 2)
+		return;
+
+	sf::Int32 localIdentifier = mLocalPlayerIdentifiers.front();
+	sf::Uint8 actions = acceptsInput ? mPlayers[localIdentifier]->getRealtimeActionMask() : 0;
+
+	sf::Uint32 inputTick;
+	while (mLockstep->isInputDue(inputTick))
+	{
+		LockstepInputMessage input;
+		input.identifier = localIdentifier;
+		input.tick = inputTick;
+		input.actions = actions;
+
+		sf::Packet packet = Schema::makePacket(input);
+		mNetwork.send(packet);
+
+		mLockstep->inputSent();
+	}
+
+	// Catch up a little when bundles arrived in a burst
+	sf::Uint32 tick, checksum;
+	for (sf::Uint32 i = 0; i < LockstepSession::MaxTicksPerUpdate && mLockstep->step(tick, checksum); ++i)
+	{
+		LockstepChecksumMessage message;
+		message.tick = tick;
+		message.checksum = checksum;
+
+		sf::Packet packet = Schema::makePacket(message);
+		mNetwork.send(packet);
+	}
+}
+
+bool MultiplayerGameState::isInputSession() const
+{
+	return mRollback->isRunning() || mLockstep->isRunning();
+}
+
+void MultiplayerGameState::interpolateRemoteTanks(sf::Time dt)
+{
+	mInterpolator.update(dt);
+
+	FOREACH(auto& pair, mPlayers)
+	{
+		if (pair.second->isLocal())
+			continue;
+
+		Tank* tank = mWorld->getTank(pair.first);
+		TankSnapshot snapshot;
+		if (tank && mInterpolator.sample(pair.first, snapshot))
+		{
+			tank->setPosition(snapshot.position);
+			tank->setRotation(snapshot.rotation);
+			tank->setTurretRotation(snapshot.turretRotation);
+		}
+	}
+}
+
 void MultiplayerGameState::disableAllRealtimeActions()
 {
+	// Input frames go out empty from now on, releasing the keys on every peer
 	mActiveState = false;
-
-	FOREACH(sf::Int32 identifier, mLocalPlayerIdentifiers)
-		mPlayers[identifier]->disableAllRealtimeActions();
 }
 
 bool MultiplayerGameState::handleEvent(const sf::Event& event)
 {
+	// No world yet (or never will be): the only input is cancelling
+	if (!mWorld)
+	{
+		if (mLoading && event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape)
+		{
+			requestStackClear();
+			requestStackPush(States::Menu);
+		}
+
+		return true;
+	}
+
 	// Game input handling
-	CommandQueue& commands = mWorld.getCommandQueue();
+	CommandQueue& commands = mWorld->getCommandQueue();
 
-	// Forward event to all players
-	FOREACH(auto& pair, mPlayers)
-		pair.second->handleEvent(event, commands);
+	// Forward event to all players; rollback and lockstep matches read the keyboard state once per frame instead
+	if (mSyncMode == ServerAuthoritative)
+	{
+		FOREACH(auto& pair, mPlayers)
+			pair.second->handleEvent(event, commands);
+	}
 
 	if (event.type == sf::Event::KeyPressed)
 	{
 		// Enter pressed, add second player co-op (only if we are one player)
-		if (event.key.code == sf::Keyboard::Return && mLocalPlayerIdentifiers.size() == 1)
+		if (event.key.code == sf::Keyboard::Return && mLocalPlayerIdentifiers.size() == 1 && mSyncMode == ServerAuthoritative)
 		{
-			sf::Packet packet;
-			packet << static_cast<sf::Int32>(Client::RequestCoopPartner);
-			
-			bool isLiberator;
+			RequestCoopPartnerMessage request;
 			if (playerTank->getType() == Tank::Hotchkiss)
 			{
-				isLiberator = true;
+				request.isLiberator = true;
 			}
 			else
 			{
-				isLiberator = false;
+				request.isLiberator = false;
 			}
 
-			packet << isLiberator;
-			mSocket.send(packet);
+			sf::Packet packet = Schema::makePacket(request);
+			mNetwork.send(packet);
 		}
 
 		// Escape pressed, trigger the pause screen
@@ -416,11 +801,13 @@ void MultiplayerGameState::handlePacket(sf::Int32 packetType, sf::Packet& packet
 	switch (packetType)
 	{
 		// Send message to all clients
-	case Server::BroadcastMessage:
+	case BroadcastTextMessage::Type:
 	{
-		std::string message;
-		packet >> message;
-		mBroadcasts.push_back(message);
+		BroadcastTextMessage message;
+		if (!Schema::decode(packet, message))
+			break;
+
+		mBroadcasts.push_back(message.text);
 
 		// Just added first message, display immediatelyk
 		if (mBroadcasts.size() == 1)
@@ -431,220 +818,306 @@ void MultiplayerGameState::handlePacket(sf::Int32 packetType, sf::Packet& packet
 		}
 	} break;
 
-	// Sent by the server to order to spawn player 1 tank on connect
-	case Server::SpawnSelf:
+	case SessionTokenMessage::Type:
 	{
-		sf::Int32 tankIdentifier;
-		bool isLiberator;
-		sf::Vector2f tankPosition;// = LiberatorTank->getPosition();
-		float tankRotation, turretRotation;
+		SessionTokenMessage message;
+		if (Schema::decode(packet, message))
+			mSessionToken = message.token;
+	} break;
 
-		packet >> tankIdentifier >> isLiberator >> tankPosition.x >> tankPosition.y >> tankRotation >> turretRotation;
+	// The server has sent the tanks we missed, carry on where we left off
+	case ResumeAcceptedMessage::Type:
+	{
+		mResuming = false;
+		mConnected = true;
+		mTimeSinceLastPacket = sf::Time::Zero;
+		std::cout << "Network: session resumed" << std::endl;
+	} break;
 
-		Tank::Type type;
-		if (isLiberator)
-		{
-			type = Tank::Hotchkiss;
-		}
-		else
-		{
-			type = Tank::Panzer;
-		}
+	case ResumeRejectedMessage::Type:
+	{
+		mResuming = false;
+		mSessionToken = 0;
+		mNetwork.disconnect();
+		showConnectionFailure("Could not rejoin the game");
+	} break;
 
-		playerTank = mWorld.addTank(tankIdentifier, type);
-		playerTank->setType(type);
-		playerTank->setPosition(tankPosition);
-		playerTank->setRotation(tankRotation);
-		playerTank->setTurretRotation(turretRotation);
+	// Sent by the server to order to spawn player 1 tank on connect
+	case SpawnSelfMessage::Type:
+	{
+		SpawnSelfMessage message;
+		if (!Schema::decode(packet, message))
+			break;
 
-		mPlayers[tankIdentifier].reset(new Player(&mSocket, tankIdentifier, getContext().keys1));
+		sf::Int32 tankIdentifier = message.tank.identifier;
+		playerTank = addTank(message.tank);
+
+		mPlayers[tankIdentifier].reset(new Player(&mNetwork, tankIdentifier, getContext().keys1));
 		mLocalPlayerIdentifiers.push_back(tankIdentifier);
+		if (mSyncMode == ServerAuthoritative)
+			mPredictions[tankIdentifier] = PredictionBuffer();
 
 		mGameStarted = true;
 	} break;
 
 	// 
-	case Server::PlayerConnect:
+	case PlayerConnectMessage::Type:
 	{
-		sf::Int32 tankIdentifier;
-		bool isLiberator;
-		sf::Vector2f tankPosition;
-		float tankRotation, turretRotation;
-		Tank::Type type;
-
-		packet >> tankIdentifier >> isLiberator >> tankPosition.x >> tankPosition.y >> tankRotation >> turretRotation;
-
-		if (isLiberator)
-		{
-			type = Tank::Hotchkiss;
-		}
-		else
-		{
-			type = Tank::Panzer;
-		}
+		PlayerConnectMessage message;
+		if (!Schema::decode(packet, message))
+			break;
 
-		Tank* tank = mWorld.addTank(tankIdentifier, type);
-		tank->setPosition(tankPosition);
-		tank->setRotation(tankRotation);
-		tank->setTurretRotation(turretRotation);
-
-		mPlayers[tankIdentifier].reset(new Player(&mSocket, tankIdentifier, nullptr));
+		addTank(message.tank);
+		mPlayers[message.tank.identifier].reset(new Player(&mNetwork, message.tank.identifier, nullptr));
 	} break;
 
 	// 
-	case Server::PlayerDisconnect:
+	case PlayerDisconnectMessage::Type:
 	{
-		sf::Int32 tankIdentifier;
-		packet >> tankIdentifier;
+		PlayerDisconnectMessage message;
+		if (!Schema::decode(packet, message))
+			break;
+
+		sf::Int32 tankIdentifier = message.identifier;
 
-		mWorld.removeTank(tankIdentifier);
+		if (mRollback->isRunning() && tankIdentifier == mRollback->getRemoteIdentifier())
+			mRollback->stop();
+
+		// A lockstep tank stays in the world; the server keeps sending empty input for it
+		if (mLockstep->isRunning())
+			break;
+
+		mWorld->removeTank(tankIdentifier);
 		mPlayers.erase(tankIdentifier);
+		mPredictions.erase(tankIdentifier);
+		mInterpolator.removeEntity(tankIdentifier);
 	} break;
 
 	// 
-	case Server::InitialState:
+	case InitialStateChunkMessage::Type:
 	{
-		sf::Int32 tankCount;
+		InitialStateChunkMessage chunk;
+		if (!Schema::decode(packet, chunk))
+			break;
+
+		std::vector<char> bytes;
+		InitialStateMessage message;
+		if (!decompressBlock(reinterpret_cast<const char*>(chunk.data.data()), chunk.data.size(), chunk.uncompressedSize, bytes)
+			|| !Schema::decode(bytes.data(), bytes.size(), message))
+		{
+			std::cout << "Network: discarded a damaged world state chunk" << std::endl;
+			break;
+		}
 
-		packet >> tankCount;
-		for (sf::Int32 i = 0; i < tankCount; ++i)
+		FOREACH(const InitialStateMessage::Tank& state, message.tanks)
 		{
-			sf::Int32 tankIdentifier;
-			bool isLiberator;
-			sf::Int32 hitpoints;
-			sf::Int32 missileAmmo;
-			sf::Vector2f tankPosition;
-			float tankRotation, turretRotation;
+			// Never add a tank twice
+			if (mWorld->getTank(state.spawn.identifier))
+				continue;
 
-			packet >> tankIdentifier >> isLiberator >> tankPosition.x >> tankPosition.y >> tankRotation >> turretRotation >> hitpoints >> missileAmmo;
+			Tank* tank = addTank(state.spawn);
+			tank->setHitpoints(state.hitpoints);
+			tank->setMissileAmmo(state.missileAmmo);
 
-			Tank::Type type = Tank::Panzer;
-			if (isLiberator)
-			{
-				type = Tank::Hotchkiss;
-				
-			}
-			
-			Tank* tank = mWorld.addTank(tankIdentifier, type);
-			tank->setPosition(tankPosition);
-			tank->setHitpoints(hitpoints);
-			tank->setMissileAmmo(missileAmmo);
-			tank->setRotation(tankRotation);
-			tank->setTurretRotation(turretRotation);
-
-			mPlayers[tankIdentifier].reset(new Player(&mSocket, tankIdentifier, nullptr));
+			mPlayers[state.spawn.identifier].reset(new Player(&mNetwork, state.spawn.identifier, nullptr));
 		}
 	} break;
 
 	//
-	case Server::AcceptCoopPartner:
+	case AcceptCoopPartnerMessage::Type:
 	{
-		sf::Int32 tankIdentifier;
-		bool isLiberator;
-		Tank::Type type;
-
-		packet >> tankIdentifier;
-		packet >> isLiberator;
-
-		if (isLiberator)
-		{
-			type = Tank::T34;
-		}
-		else
-		{
-			type = Tank::Panther;
-		}
-
-		secondPlayerTank = mWorld.addTank(tankIdentifier, type);
-		mPlayers[tankIdentifier].reset(new Player(&mSocket, tankIdentifier, getContext().keys2));
+		AcceptCoopPartnerMessage message;
+		if (!Schema::decode(packet, message))
+			break;
+
+		sf::Int32 tankIdentifier = message.identifier;
+		secondPlayerTank = mWorld->addTank(tankIdentifier, message.isLiberator ? Tank::T34 : Tank::Panther);
+		secondPlayerTank->setPosition(message.x, message.y);
+		mPlayers[tankIdentifier].reset(new Player(&mNetwork, tankIdentifier, getContext().keys2));
 		mLocalPlayerIdentifiers.push_back(tankIdentifier);
+		mPredictions[tankIdentifier] = PredictionBuffer();
 	} break;
 
 	// Player event (like missile fired) occurs
-	case Server::PlayerEvent:
+	case PlayerEventMessage::Type:
 	{
-		sf::Int32 tankIdentifier;
-		sf::Int32 action;
-		packet >> tankIdentifier >> action;
+		PlayerEventMessage message;
+		if (!Schema::decode(packet, message))
+			break;
 
-		auto itr = mPlayers.find(tankIdentifier);
+		auto itr = mPlayers.find(message.identifier);
 		if (itr != mPlayers.end())
-			itr->second->handleNetworkEvent(static_cast<Player::Action>(action), mWorld.getCommandQueue());
+			itr->second->handleNetworkEvent(static_cast<Player::Action>(message.action), mWorld->getCommandQueue());
 	} break;
 
-	// Player's movement or fire keyboard state changes
-	case Server::PlayerRealtimeChange:
+	// Latest movement and fire input of every tank, oldest frame applied first
+	case InputFramesMessage::Type:
 	{
-		sf::Int32 tankIdentifier;
-		sf::Int32 action;
-		bool actionEnabled;
-		packet >> tankIdentifier >> action >> actionEnabled;
+		// Rollback and lockstep peers get remote inputs their own way
+		InputFramesMessage message;
+		if (mSyncMode != ServerAuthoritative || !Schema::decode(packet, message))
+			break;
 
-		auto itr = mPlayers.find(tankIdentifier);
-		if (itr != mPlayers.end())
-			itr->second->handleNetworkRealtimeChange(static_cast<Player::Action>(action), actionEnabled);
+		FOREACH(const TankInputFrames& frames, message.tanks)
+		{
+			// Our own tanks are simulated from the keyboard
+			auto itr = mPlayers.find(frames.identifier);
+			if (itr == mPlayers.end() || itr->second->isLocal())
+				continue;
+
+			for (std::size_t frame = frames.actions.size(); frame > 0; --frame)
+				itr->second->handleNetworkInputFrame(frames.newestSequence - static_cast<sf::Uint32>(frame - 1), frames.actions[frame - 1]);
+		}
 	} break;
 
 	// New enemy to be created
-	case Server::SpawnEnemy:
+	case SpawnEnemyMessage::Type:
 	{
-		float height;
-		sf::Int32 type;
-		float relativeX;
-		packet >> type >> height >> relativeX;
+		SpawnEnemyMessage message;
+		if (!Schema::decode(packet, message))
+			break;
 
-		//mWorld.addEnemy(static_cast<Tank::Type>(type), relativeX, height);
-		//mWorld.sortEnemies();
+		//mWorld->addEnemy(static_cast<Tank::Type>(type), relativeX, height);
+		//mWorld->sortEnemies();
 	} break;
 
 	// Mission successfully completed
-	case Server::MissionSuccess:
+	case MissionSuccessMessage::Type:
 	{
 		requestStackPush(States::MissionSuccess);
 	} break;
 
+	// Opponent's input for one rollback frame
+	case RollbackInputMessage::Type:
+	{
+		RollbackInputMessage message;
+		if (!Schema::decode(packet, message))
+			break;
+
+		if (mSyncMode == Rollback && (!mRollback->isRunning() || message.identifier == mRollback->getRemoteIdentifier()))
+			mRollback->addRemoteInput(message.frame, message.actions);
+	} break;
+
+	// Inputs of all tanks for one lockstep tick
+	case InputBundleMessage::Type:
+	{
+		InputBundleMessage message;
+		if (mSyncMode != Lockstep || !Schema::decode(packet, message))
+			break;
+
+		sf::Uint32 tick = message.tick;
+		std::vector<LockstepInput> inputs(message.inputs.size());
+		for (std::size_t i = 0; i < inputs.size(); ++i)
+		{
+			inputs[i].identifier = message.inputs[i].identifier;
+			inputs[i].actions = message.inputs[i].actions;
+		}
+
+		// Only a peer that saw the match from its first tick, with every tank in it, can simulate it
+		if (!mLockstep->isRunning() && tick == 0)
+		{
+			bool knowsAllTanks = true;
+			FOREACH(const LockstepInput& input, inputs)
+			{
+				if (mPlayers.find(input.identifier) == mPlayers.end())
+					knowsAllTanks = false;
+				else
+					mLockstep->addPlayer(input.identifier, *mPlayers[input.identifier]);
+			}
+
+			if (knowsAllTanks)
+				mLockstep->start();
+			else
+				std::cout << "Lockstep: first bundle names tanks we don't have, not joining" << std::endl;
+		}
+
+		if (mLockstep->isRunning())
+			mLockstep->addBundle(tick, inputs);
+	} break;
+
+	// Peers disagreed about the world after a lockstep tick
+	case LockstepDesyncMessage::Type:
+	{
+		LockstepDesyncMessage message;
+		if (!Schema::decode(packet, message))
+			break;
+
+		sf::Uint32 tick = message.tick;
+
+		if (mLockstep->isRunning() && !mLocalPlayerIdentifiers.empty())
+		{
+			std::string filename = "desync-" + toString(tick) + "-" + toString(mLocalPlayerIdentifiers.front()) + ".txt";
+			if (mLockstep->writeDesyncDump(tick, filename))
+				std::cout << "Lockstep: desync at tick " << tick << ", state written to " << filename << std::endl;
+			else
+				std::cout << "Lockstep: desync at tick " << tick << ", state no longer available" << std::endl;
+		}
+	} break;
+
 	// Pickup created
-	case Server::SpawnPickup:
+	case SpawnPickupMessage::Type:
 	{
-		sf::Int32 type;
-		sf::Vector2f position;
-		packet >> type >> position.x >> position.y;
+		SpawnPickupMessage message;
+		if (!Schema::decode(packet, message))
+			break;
 
-		mWorld.createPickup(position, static_cast<Pickup::Type>(type));
+		// Rollback and lockstep peers drop their own pickups, from the shared random sequence
+		if (mSyncMode == ServerAuthoritative)
+			mWorld->createPickup(sf::Vector2f(message.x, message.y), static_cast<Pickup::Type>(message.type));
 	} break;
 
 	//
-	case Server::UpdateClientState:
+	case UpdateClientStateMessage::Type:
 	{
-		float currentWorldPosition;
-		sf::Int32 tankCount;
-		packet >> currentWorldPosition >> tankCount;
+		// Rollback and lockstep peers only trust their own simulation
+		UpdateClientStateMessage message;
+		if (mSyncMode != ServerAuthoritative || !Schema::decode(packet, message))
+			break;
+
+		sf::Uint32 serverTick = message.serverTick;
 
-		float currentViewPosition = mWorld.getViewBounds().top + mWorld.getViewBounds().height;
+		mInterpolator.onSnapshotReceived(serverTick);
+
+		float currentViewPosition = mWorld->getViewBounds().top + mWorld->getViewBounds().height;
 
 		// Set the world's scroll compensation according to whether the view is behind or too advanced
-		//mWorld.setWorldScrollCompensation(currentViewPosition / currentWorldPosition);
+		//mWorld->setWorldScrollCompensation(currentViewPosition / message.battlefieldTop);
 
-		for (sf::Int32 i = 0; i < tankCount; ++i)
+		FOREACH(const UpdateClientStateMessage::Tank& state, message.tanks)
 		{
-			sf::Vector2f tankPosition;
-			sf::Int32 tankIdentifier;
-			float tankRotation, turretRotation;
-			packet >> tankIdentifier >> tankPosition.x >> tankPosition.y >> tankRotation >> turretRotation;
+			sf::Vector2f tankPosition(state.x, state.y);
+			sf::Int32 tankIdentifier = state.identifier;
+			float tankRotation = state.rotation;
+			float turretRotation = state.turretRotation;
+			sf::Uint32 lastInputSequence = state.lastInputSequence;
 
-			Tank* tank = mWorld.getTank(tankIdentifier);
+			if (mSnapshotTrace.is_open())
+			{
+				mSnapshotTrace << mNetwork.now().asMicroseconds() << ' ' << serverTick << ' ' << tankIdentifier << ' '
+					<< tankPosition.x << ' ' << tankPosition.y << ' ' << tankRotation << ' ' << turretRotation << '\n';
+			}
+
+			Tank* tank = mWorld->getTank(tankIdentifier);
 			bool isLocalPlane = std::find(mLocalPlayerIdentifiers.begin(), mLocalPlayerIdentifiers.end(), tankIdentifier) != mLocalPlayerIdentifiers.end();
 			if (tank && !isLocalPlane)
 			{
-				sf::Vector2f interpolatedPosition = tank->getPosition() + (tankPosition - tank->getPosition()) * 0.1f;
-				tank->setPosition(interpolatedPosition);
-				float interpolatedRotation = tank->getRotation() + (tankRotation - tank->getRotation()) * 0.1f;
-				tank->setRotation(interpolatedRotation);
-				float interpolatedTurretRotation = tank->getTurretRotation() + (turretRotation - tank->getTurretRotation()) * 0.1f;
-				tank->setTurretRotation(interpolatedTurretRotation);
+				// Buffered and played back with a delay by interpolateRemoteTanks()
+				TankSnapshot snapshot;
+				snapshot.tick = serverTick;
+				snapshot.position = tankPosition;
+				snapshot.rotation = tankRotation;
+				snapshot.turretRotation = turretRotation;
+				mInterpolator.pushSnapshot(tankIdentifier, snapshot);
 			}
 			else if (tank && isLocalPlane)
 			{
+				// Reconciled on the next update, against the state we predicted for that input
+				MovementState authoritative;
+				authoritative.position = tankPosition;
+				authoritative.rotation = tankRotation;
+				authoritative.turretRotation = turretRotation;
+				mPredictions[tankIdentifier].setAuthoritativeState(lastInputSequence, authoritative);
+
 				if (tank->getHitpoints() <= 0 && secondPlayerTank != nullptr)
 				{
 					playerTank = secondPlayerTank;
@@ -5,18 +5,41 @@
 #include "Player.hpp"
 #include "GameServer.hpp"
 #include "NetworkProtocol.hpp"
+#include "NetworkMessages.hpp"
+#include "PredictionBuffer.hpp"
+#include "SnapshotInterpolator.hpp"
+#include "ClientNetworkThread.hpp"
+#include "ClockSync.hpp"
+#include "RollbackSession.hpp"
+#include "LockstepSession.hpp"
 
 
 #include <SFML/System/Clock.hpp>
+#include <SFML/System/Thread.hpp>
 #include <SFML/Graphics/Text.hpp>
-#include <SFML/Network/TcpSocket.hpp>
 #include <SFML/Network/Packet.hpp>
+#include <SFML/Network/IpAddress.hpp>
+
+#include <atomic>
+#include <fstream>
 
 
 class MultiplayerGameState : public State
 {
 public:
-	MultiplayerGameState(StateStack& stack, Context context, bool isHost);
+	// How tanks are kept in sync: positions from the server, or inputs only, either with local
+	// rollback (1v1) or in lockstep with a fixed input delay (any number of tanks)
+	enum SyncMode
+	{
+		ServerAuthoritative,
+		Rollback,
+		Lockstep,
+	};
+
+
+public:
+	MultiplayerGameState(StateStack& stack, Context context, bool isHost, SyncMode mode = ServerAuthoritative);
+							~MultiplayerGameState();
 
 	virtual void				draw();
 	virtual bool				update(sf::Time dt);
@@ -30,6 +53,19 @@ public:
 private:
 	void						updateBroadcastMessage(sf::Time elapsedTime);
 	void						handlePacket(sf::Int32 packetType, sf::Packet& packet);
+	Tank*						addTank(const TankSpawnInfo& spawn);
+	void						reconcileLocalTanks();
+	void						sendInputFrames();
+	void						interpolateRemoteTanks(sf::Time dt);
+	void						updateClockSync();
+	void						updateRollback(bool acceptsInput);
+	void						updateLockstep(bool acceptsInput);
+	bool						isInputSession() const;
+	void						loadImages();
+	void						updateLoading();
+	void						beginResume();
+	void						updateResume();
+	void						showConnectionFailure(const std::string& message);
 
 
 private:
@@ -37,15 +73,26 @@ private:
 
 
 private:
-	World						mWorld;
+	std::unique_ptr<World>		mWorld;
 	sf::RenderWindow&			mWindow;
 	TextureHolder&				mTextureHolder;
 
 	Tank						*playerTank, *secondPlayerTank;
 	std::map<int, PlayerPtr>	mPlayers;
 	std::vector<sf::Int32>		mLocalPlayerIdentifiers;
-	sf::TcpSocket				mSocket;
+	std::map<sf::Int32, PredictionBuffer>	mPredictions;
+	SnapshotInterpolator		mInterpolator;
+	std::ofstream				mSnapshotTrace;
+	ClientNetworkThread			mNetwork;
+	ClockSync					mClockSync;
+	SyncMode					mSyncMode;
+	std::unique_ptr<RollbackSession>	mRollback;
+	std::unique_ptr<LockstepSession>	mLockstep;
+	sf::Time					mLastPingTime;
 	bool						mConnected;
+	sf::IpAddress				mServerAddress;
+	sf::Uint64					mSessionToken;
+	bool						mResuming;
 	std::unique_ptr<GameServer> mGameServer;
 	sf::Clock					mTickClock;
 
@@ -61,6 +108,14 @@ private:
 	sf::Text					mFailedConnectionText;
 	sf::Clock					mFailedConnectionClock;
 
+	// Texture files are decoded on mLoadingThread while connecting; the world is built from them
+	// on this thread once both are done
+	ImageHolder					mImages;
+	std::atomic<bool>			mImagesLoaded;
+	bool						mImagesValid;
+	sf::Thread					mLoadingThread;
+	bool						mLoading;
+
 	bool						mActiveState;
 	bool						mHasFocus;
 	bool						mHost;
@@ -29,7 +29,7 @@ MultiplayerMenuState::MultiplayerMenuState(StateStack& stack, Context context)
 	TitleText.setPosition(sf::Vector2f(windowSize.x / 2, 150));
 
 	auto hostButton = std::make_shared<GUI::Button>(context);
-	hostButton->setPosition(0.5f * windowSize.x, 300); \
+	hostButton->setPosition(0.5f * windowSize.x, 260);
 	hostButton->setText("Host");
 	hostButton->setCallback([this]()
 	{
@@ -39,7 +39,7 @@ MultiplayerMenuState::MultiplayerMenuState(StateStack& stack, Context context)
 	});
 
 	auto playButton = std::make_shared<GUI::Button>(context);
-	playButton->setPosition(0.5f * windowSize.x, 400);
+	playButton->setPosition(0.5f * windowSize.x, 310);
 	playButton->setText("Join");
 	playButton->setCallback([this]()
 	{
@@ -48,8 +48,50 @@ MultiplayerMenuState::MultiplayerMenuState(StateStack& stack, Context context)
 		requestStackPush(States::JoinGame);
 	});
 
+	// 1v1 matches exchange only inputs and roll back on mispredictions
+	auto hostRollbackButton = std::make_shared<GUI::Button>(context);
+	hostRollbackButton->setPosition(0.5f * windowSize.x, 360);
+	hostRollbackButton->setText("Host 1v1");
+	hostRollbackButton->setCallback([this]()
+	{
+		requestStackPop();
+		requestStackPop();
+		requestStackPush(States::HostRollbackGame);
+	});
+
+	auto joinRollbackButton = std::make_shared<GUI::Button>(context);
+	joinRollbackButton->setPosition(0.5f * windowSize.x, 410);
+	joinRollbackButton->setText("Join 1v1");
+	joinRollbackButton->setCallback([this]()
+	{
+		requestStackPop();
+		requestStackPop();
+		requestStackPush(States::JoinRollbackGame);
+	});
+
+	// Lockstep matches exchange only inputs, behind a fixed input delay
+	auto hostLockstepButton = std::make_shared<GUI::Button>(context);
+	hostLockstepButton->setPosition(0.5f * windowSize.x, 460);
+	hostLockstepButton->setText("Host Lockstep");
+	hostLockstepButton->setCallback([this]()
+	{
+		requestStackPop();
+		requestStackPop();
+		requestStackPush(States::HostLockstepGame);
+	});
+
+	auto joinLockstepButton = std::make_shared<GUI::Button>(context);
+	joinLockstepButton->setPosition(0.5f * windowSize.x, 510);
+	joinLockstepButton->setText("Join Lockstep");
+	joinLockstepButton->setCallback([this]()
+	{
+		requestStackPop();
+		requestStackPop();
+		requestStackPush(States::JoinLockstepGame);
+	});
+
 	auto backButton = std::make_shared<GUI::Button>(context);
-	backButton->setPosition(0.5f * windowSize.x, 500);
+	backButton->setPosition(0.5f * windowSize.x, 560);
 	backButton->setText("Back");
 	backButton->setCallback([this]()
 	{
@@ -59,6 +101,10 @@ MultiplayerMenuState::MultiplayerMenuState(StateStack& stack, Context context)
 
 	mGUIContainer.pack(hostButton);
 	mGUIContainer.pack(playButton);
+	mGUIContainer.pack(hostRollbackButton);
+	mGUIContainer.pack(joinRollbackButton);
+	mGUIContainer.pack(hostLockstepButton);
+	mGUIContainer.pack(joinLockstepButton);
 	mGUIContainer.pack(backButton);
 }
 
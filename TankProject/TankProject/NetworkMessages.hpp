@@ -0,0 +1,711 @@
+#pragma once
+
+#include "MessageSchema.hpp"
+#include "NetworkProtocol.hpp"
+
+#include <string>
+#include <vector>
+
+
+// Layouts of every packet, each after its Int32 packet type; see MessageSchema.hpp for how they are
+// encoded. Packets that carry nothing but their type have an empty message, so they are sent the
+// same way as the rest.
+
+
+//
+// Server to client
+//
+
+// A line of text every client shows for a while
+struct BroadcastTextMessage
+{
+	static const sf::Int32	Type = Server::BroadcastMessage;
+
+	std::string			text;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.text;
+	}
+};
+
+// A tank as every client first learns of it
+struct TankSpawnInfo
+{
+	TankSpawnInfo()
+		: identifier(0), isLiberator(false), x(0.f), y(0.f), rotation(0.f), turretRotation(0.f)
+	{
+	}
+
+	sf::Int32			identifier;
+	bool				isLiberator;
+	float				x;
+	float				y;
+	float				rotation;
+	float				turretRotation;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.identifier & self.isLiberator & self.x & self.y & self.rotation & self.turretRotation;
+	}
+};
+
+// The receiving client's own tank
+struct SpawnSelfMessage
+{
+	static const sf::Int32	Type = Server::SpawnSelf;
+
+	TankSpawnInfo		tank;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.tank;
+	}
+};
+
+// Another client's tank
+struct PlayerConnectMessage
+{
+	static const sf::Int32	Type = Server::PlayerConnect;
+
+	TankSpawnInfo		tank;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.tank;
+	}
+};
+
+// The tank of the receiving client's second local player
+struct AcceptCoopPartnerMessage
+{
+	static const sf::Int32	Type = Server::AcceptCoopPartner;
+
+	AcceptCoopPartnerMessage()
+		: identifier(0), isLiberator(false), x(0.f), y(0.f)
+	{
+	}
+
+	sf::Int32			identifier;
+	bool				isLiberator;
+	float				x;
+	float				y;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.identifier & self.isLiberator & self.x & self.y;
+	}
+};
+
+// Tanks already in the game, for a client that just joined. Not sent as is: the server streams it as
+// InitialStateChunkMessages, each carrying a compressed InitialStateMessage with some of the tanks
+struct InitialStateMessage
+{
+	struct Tank
+	{
+		Tank()
+			: spawn(), hitpoints(0), missileAmmo(0)
+		{
+		}
+
+		TankSpawnInfo	spawn;
+		sf::Int32		hitpoints;
+		sf::Int32		missileAmmo;
+
+		template <typename Archive, typename Self>
+		static void fields(Archive& archive, Self& self)
+		{
+			archive & self.spawn & self.hitpoints & self.missileAmmo;
+		}
+	};
+
+	std::vector<Tank>	tanks;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.tanks;
+	}
+};
+
+// One piece of the world state; every chunk decodes on its own, so the client applies them as they come
+struct InitialStateChunkMessage
+{
+	static const sf::Int32	Type = Server::InitialState;
+
+	InitialStateChunkMessage()
+		: uncompressedSize(0), isLast(false), data()
+	{
+	}
+
+	sf::Uint32			uncompressedSize;
+	bool				isLast;
+	std::vector<sf::Uint8>	data;	// encoded InitialStateMessage, compressed with compressBlock
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.uncompressedSize & self.isLast & self.data;
+	}
+};
+
+// A one-off action of a tank (e.g. launching a missile), relayed to every client
+struct PlayerEventMessage
+{
+	static const sf::Int32	Type = Server::PlayerEvent;
+
+	PlayerEventMessage()
+		: identifier(0), action(0)
+	{
+	}
+
+	sf::Int32			identifier;
+	sf::Int32			action;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.identifier & self.action;
+	}
+};
+
+// The newest input frames of one tank, newest first, each as (1 << PlayerAction)
+struct TankInputFrames
+{
+	TankInputFrames()
+		: identifier(0), newestSequence(0), actions()
+	{
+	}
+
+	sf::Int32			identifier;
+	sf::Uint32			newestSequence;
+	std::vector<sf::Uint8>	actions;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.identifier & self.newestSequence & self.actions;
+	}
+};
+
+// Latest input frames of every tank, once per tick
+struct InputFramesMessage
+{
+	static const sf::Int32	Type = Server::InputFrames;
+
+	InputFramesMessage()
+		: serverTick(0), tanks()
+	{
+	}
+
+	sf::Uint32			serverTick;
+	std::vector<TankInputFrames>	tanks;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.serverTick & self.tanks;
+	}
+};
+
+struct PlayerDisconnectMessage
+{
+	static const sf::Int32	Type = Server::PlayerDisconnect;
+
+	PlayerDisconnectMessage()
+		: identifier(0)
+	{
+	}
+
+	sf::Int32			identifier;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.identifier;
+	}
+};
+
+// Unused
+struct SpawnEnemyMessage
+{
+	static const sf::Int32	Type = Server::SpawnEnemy;
+
+	SpawnEnemyMessage()
+		: type(0), height(0.f), relativeX(0.f)
+	{
+	}
+
+	sf::Int32			type;
+	float				height;
+	float				relativeX;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.type & self.height & self.relativeX;
+	}
+};
+
+struct SpawnPickupMessage
+{
+	static const sf::Int32	Type = Server::SpawnPickup;
+
+	SpawnPickupMessage()
+		: type(0), x(0.f), y(0.f)
+	{
+	}
+
+	sf::Int32			type;
+	float				x;
+	float				y;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.type & self.x & self.y;
+	}
+};
+
+// Where every tank is on a server tick
+struct UpdateClientStateMessage
+{
+	static const sf::Int32	Type = Server::UpdateClientState;
+
+	struct Tank
+	{
+		Tank()
+			: identifier(0), x(0.f), y(0.f), rotation(0.f), turretRotation(0.f), lastInputSequence(0)
+		{
+		}
+
+		sf::Int32		identifier;
+		float			x;
+		float			y;
+		float			rotation;
+		float			turretRotation;
+		sf::Uint32		lastInputSequence;	// newest input of the tank's owner that the state includes
+
+		template <typename Archive, typename Self>
+		static void fields(Archive& archive, Self& self)
+		{
+			archive & self.identifier & self.x & self.y & self.rotation & self.turretRotation & self.lastInputSequence;
+		}
+	};
+
+	UpdateClientStateMessage()
+		: serverTick(0), battlefieldTop(0.f), tanks()
+	{
+	}
+
+	sf::Uint32			serverTick;
+	float				battlefieldTop;
+	std::vector<Tank>	tanks;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.serverTick & self.battlefieldTop & self.tanks;
+	}
+};
+
+struct MissionSuccessMessage
+{
+	static const sf::Int32	Type = Server::MissionSuccess;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive&, Self&)
+	{
+	}
+};
+
+// Answer to a ping, times in microseconds
+struct PongMessage
+{
+	static const sf::Int32	Type = Server::Pong;
+
+	PongMessage()
+		: clientTime(0), serverTime(0), serverTick(0)
+	{
+	}
+
+	sf::Int64			clientTime;		// as sent in the ping
+	sf::Int64			serverTime;
+	sf::Uint32			serverTick;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.clientTime & self.serverTime & self.serverTick;
+	}
+};
+
+// One rollback frame of another client's input, as it sent it
+struct RollbackInputMessage
+{
+	static const sf::Int32	Type = Server::RollbackInput;
+
+	RollbackInputMessage()
+		: identifier(0), frame(0), actions(0)
+	{
+	}
+
+	sf::Int32			identifier;
+	sf::Uint32			frame;
+	sf::Uint8			actions;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.identifier & self.frame & self.actions;
+	}
+};
+
+// The inputs of all tanks for one lockstep tick, sorted by tank
+struct InputBundleMessage
+{
+	static const sf::Int32	Type = Server::InputBundle;
+
+	struct Input
+	{
+		Input()
+			: identifier(0), actions(0)
+		{
+		}
+
+		sf::Int32		identifier;
+		sf::Uint8		actions;
+
+		template <typename Archive, typename Self>
+		static void fields(Archive& archive, Self& self)
+		{
+			archive & self.identifier & self.actions;
+		}
+	};
+
+	InputBundleMessage()
+		: tick(0), inputs()
+	{
+	}
+
+	sf::Uint32			tick;
+	std::vector<Input>	inputs;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.tick & self.inputs;
+	}
+};
+
+// First tick on which two clients reported different checksums
+struct LockstepDesyncMessage
+{
+	static const sf::Int32	Type = Server::LockstepDesync;
+
+	LockstepDesyncMessage()
+		: tick(0)
+	{
+	}
+
+	sf::Uint32			tick;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.tick;
+	}
+};
+
+// Presented in a ResumeMessage after a dropped connection
+struct SessionTokenMessage
+{
+	static const sf::Int32	Type = Server::SessionToken;
+
+	SessionTokenMessage()
+		: token(0)
+	{
+	}
+
+	sf::Uint64			token;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.token;
+	}
+};
+
+// Follows the PlayerConnect and PlayerDisconnect packets the resuming client missed
+struct ResumeAcceptedMessage
+{
+	static const sf::Int32	Type = Server::ResumeAccepted;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive&, Self&)
+	{
+	}
+};
+
+// The session has expired
+struct ResumeRejectedMessage
+{
+	static const sf::Int32	Type = Server::ResumeRejected;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive&, Self&)
+	{
+	}
+};
+
+
+//
+// Client to server
+//
+
+struct ClientPlayerEventMessage
+{
+	static const sf::Int32	Type = Client::PlayerEvent;
+
+	ClientPlayerEventMessage()
+		: identifier(0), action(0)
+	{
+	}
+
+	sf::Int32			identifier;
+	sf::Int32			action;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.identifier & self.action;
+	}
+};
+
+// The newest input frames of every local tank, sent every frame
+struct ClientInputFramesMessage
+{
+	static const sf::Int32	Type = Client::InputFrames;
+
+	std::vector<TankInputFrames>	tanks;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.tanks;
+	}
+};
+
+struct RequestCoopPartnerMessage
+{
+	static const sf::Int32	Type = Client::RequestCoopPartner;
+
+	RequestCoopPartnerMessage()
+		: isLiberator(false)
+	{
+	}
+
+	bool				isLiberator;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.isLiberator;
+	}
+};
+
+// Where the client's own tanks are
+struct PositionUpdateMessage
+{
+	static const sf::Int32	Type = Client::PositionUpdate;
+
+	struct Tank
+	{
+		Tank()
+			: identifier(0), inputSequence(0), x(0.f), y(0.f), rotation(0.f), turretRotation(0.f), hitpoints(0), missileAmmo(0)
+		{
+		}
+
+		sf::Int32		identifier;
+		sf::Uint32		inputSequence;		// newest input frame the position includes
+		float			x;
+		float			y;
+		float			rotation;
+		float			turretRotation;
+		sf::Int32		hitpoints;
+		sf::Int32		missileAmmo;
+
+		template <typename Archive, typename Self>
+		static void fields(Archive& archive, Self& self)
+		{
+			archive & self.identifier & self.inputSequence & self.x & self.y & self.rotation & self.turretRotation
+				& self.hitpoints & self.missileAmmo;
+		}
+	};
+
+	std::vector<Tank>	tanks;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.tanks;
+	}
+};
+
+// Something that happened in the client's world, a GameActions::Type
+struct GameEventMessage
+{
+	static const sf::Int32	Type = Client::GameEvent;
+
+	GameEventMessage()
+		: action(0), x(0.f), y(0.f)
+	{
+	}
+
+	sf::Int32			action;
+	float				x;
+	float				y;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.action & self.x & self.y;
+	}
+};
+
+struct QuitMessage
+{
+	static const sf::Int32	Type = Client::Quit;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive&, Self&)
+	{
+	}
+};
+
+// Client time in microseconds, echoed in the PongMessage
+struct PingMessage
+{
+	static const sf::Int32	Type = Client::Ping;
+
+	PingMessage()
+		: clientTime(0)
+	{
+	}
+
+	sf::Int64			clientTime;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.clientTime;
+	}
+};
+
+// The client's input for one rollback frame, as (1 << PlayerAction)
+struct ClientRollbackInputMessage
+{
+	static const sf::Int32	Type = Client::RollbackInput;
+
+	ClientRollbackInputMessage()
+		: identifier(0), frame(0), actions(0)
+	{
+	}
+
+	sf::Int32			identifier;
+	sf::Uint32			frame;
+	sf::Uint8			actions;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.identifier & self.frame & self.actions;
+	}
+};
+
+struct LockstepInputMessage
+{
+	static const sf::Int32	Type = Client::LockstepInput;
+
+	LockstepInputMessage()
+		: identifier(0), tick(0), actions(0)
+	{
+	}
+
+	sf::Int32			identifier;
+	sf::Uint32			tick;
+	sf::Uint8			actions;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.identifier & self.tick & self.actions;
+	}
+};
+
+// World hash after simulating a lockstep tick
+struct LockstepChecksumMessage
+{
+	static const sf::Int32	Type = Client::LockstepChecksum;
+
+	LockstepChecksumMessage()
+		: tick(0), checksum(0)
+	{
+	}
+
+	sf::Uint32			tick;
+	sf::Uint32			checksum;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.tick & self.checksum;
+	}
+};
+
+// First packet on a new connection
+struct JoinMessage
+{
+	static const sf::Int32	Type = Client::Join;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive&, Self&)
+	{
+	}
+};
+
+// First packet on a reconnection, with the tanks the client still has
+struct ResumeMessage
+{
+	static const sf::Int32	Type = Client::Resume;
+
+	ResumeMessage()
+		: token(0), knownTanks()
+	{
+	}
+
+	sf::Uint64			token;
+	std::vector<sf::Int32>	knownTanks;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.token & self.knownTanks;
+	}
+};
+
+// First packet of a read-only peer (a spectator relay)
+struct SpectateMessage
+{
+	static const sf::Int32	Type = Client::Spectate;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive&, Self&)
+	{
+	}
+};
@@ -6,37 +6,72 @@
 
 const unsigned short ServerPort = 5000;
 
+// The server sends state snapshots at this rate, numbered by tick
+const unsigned int ServerTickRate = 20;
+
+// Clients simulate and number their inputs at this rate
+const unsigned int ClientTickRate = 60;
+
+// Input frames repeat the last few frames of each tank, so that a lost packet costs nothing: clients send
+// one packet per frame with this many frames, the server one bundle per tick with BundledInputFrames
+const unsigned int RedundantInputFrames = 4;
+const unsigned int BundledInputFrames = 2 * ClientTickRate / ServerTickRate;
+
+// Fastest a tank may travel (speed pickup and collision push-back included) before the server clamps it
+const float MaxTankSpeed = 400.f;
+
+// Lockstep clients send input this many ticks ahead of the tick they simulate next; the server ignores
+// input for ticks further ahead of the bundle it sends next
+const unsigned int LockstepInputDelay = 6;
+
+// Kinds of pickup a SpawnPickupMessage may name (Pickup::TypeCount, which the server cannot include)
+const unsigned int PickupTypeCount = 4;
+
 namespace Server
 {
-	// Packets originated in the server
+	// Packets originated in the server, each followed by the message named (NetworkMessages.hpp)
 	enum PacketType
 	{
-		BroadcastMessage,	// format: [Int32:packetType] [string:message]
-		SpawnSelf,			// format: [Int32:packetType]
-		InitialState,
-		PlayerEvent,
-		PlayerRealtimeChange,
-		PlayerConnect,
-		PlayerDisconnect,
-		AcceptCoopPartner,
-		SpawnEnemy,
-		SpawnPickup,
-		UpdateClientState,
-		MissionSuccess
+		BroadcastMessage,	// BroadcastTextMessage
+		SpawnSelf,			// SpawnSelfMessage
+		InitialState,		// InitialStateChunkMessage, one or more per joining client
+		PlayerEvent,		// PlayerEventMessage
+		InputFrames,		// InputFramesMessage
+		PlayerConnect,		// PlayerConnectMessage
+		PlayerDisconnect,	// PlayerDisconnectMessage
+		AcceptCoopPartner,	// AcceptCoopPartnerMessage
+		SpawnEnemy,			// SpawnEnemyMessage, unused
+		SpawnPickup,		// SpawnPickupMessage
+		UpdateClientState,	// UpdateClientStateMessage
+		MissionSuccess,		// MissionSuccessMessage
+		Pong,				// PongMessage
+		RollbackInput,		// RollbackInputMessage, relayed from another client
+		InputBundle,		// InputBundleMessage
+		LockstepDesync,		// LockstepDesyncMessage
+		SessionToken,		// SessionTokenMessage
+		ResumeAccepted,		// ResumeAcceptedMessage
+		ResumeRejected		// ResumeRejectedMessage, the session has expired
 	};
 }
 
 namespace Client
 {
-	// Packets originated in the client
+	// Packets originated in the client, each followed by the message named (NetworkMessages.hpp)
 	enum PacketType
 	{
-		PlayerEvent,
-		PlayerRealtimeChange,
-		RequestCoopPartner,
-		PositionUpdate,
-		GameEvent,
-		Quit
+		PlayerEvent,		// ClientPlayerEventMessage
+		InputFrames,		// ClientInputFramesMessage
+		RequestCoopPartner,	// RequestCoopPartnerMessage
+		PositionUpdate,		// PositionUpdateMessage
+		GameEvent,			// GameEventMessage
+		Quit,				// QuitMessage
+		Ping,				// PingMessage
+		RollbackInput,		// ClientRollbackInputMessage
+		LockstepInput,		// LockstepInputMessage
+		LockstepChecksum,	// LockstepChecksumMessage
+		Join,				// JoinMessage
+		Resume,				// ResumeMessage
+		Spectate			// SpectateMessage; the peer gets every broadcast and may only Ping and Quit
 	};
 }
 
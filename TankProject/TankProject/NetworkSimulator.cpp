@@ -0,0 +1,246 @@
+#include "NetworkSimulator.hpp"
+#include "Foreach.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+
+namespace
+{
+	bool parseRule(const std::string& rule, LinkConditions& conditions)
+	{
+		std::size_t separator = rule.find('=');
+		if (separator == std::string::npos)
+			return false;
+
+		std::string key = rule.substr(0, separator);
+		std::istringstream valueStream(rule.substr(separator + 1));
+		float value;
+		if (!(valueStream >> value))
+			return false;
+
+		if (key == "latency")
+			conditions.latency = sf::milliseconds(static_cast<sf::Int32>(value));
+		else if (key == "jitter")
+			conditions.jitter = sf::milliseconds(static_cast<sf::Int32>(value));
+		else if (key == "loss")
+			conditions.lossRate = value;
+		else if (key == "rto")
+			conditions.retransmitTimeout = sf::milliseconds(static_cast<sf::Int32>(value));
+		else if (key == "duplicate")
+			conditions.duplicateRate = value;
+		else if (key == "reorder")
+			conditions.reorderRate = value;
+		else if (key == "reorderdelay")
+			conditions.reorderDelay = sf::milliseconds(static_cast<sf::Int32>(value));
+		else if (key == "bandwidth")
+			conditions.bandwidth = static_cast<std::size_t>(value);
+		else
+			return false;
+
+		return true;
+	}
+}
+
+const int NetworkSimulator::AnyPeer;
+
+LinkConditions::LinkConditions()
+	: latency(sf::Time::Zero)
+	, jitter(sf::Time::Zero)
+	, lossRate(0.f)
+	, retransmitTimeout(sf::milliseconds(200))
+	, duplicateRate(0.f)
+	, reorderRate(0.f)
+	, reorderDelay(sf::milliseconds(30))
+	, bandwidth(0)
+{
+}
+
+NetworkSimulator::NetworkSimulator(Side side)
+	: mSide(side)
+	, mSeed(0)
+	, mConditions()
+	, mLinks()
+{
+}
+
+bool NetworkSimulator::loadScript(const std::string& filename)
+{
+	std::ifstream inputFile(filename);
+	if (!inputFile)
+		return false;
+
+	std::string line;
+	while (std::getline(inputFile, line))
+	{
+		std::istringstream lineStream(line);
+		std::string first;
+		if (!(lineStream >> first) || first[0] == '#')
+			continue;
+
+		if (first == "seed")
+		{
+			unsigned int seed;
+			if (lineStream >> seed)
+				setSeed(seed);
+			continue;
+		}
+
+		// Rules for the other side of the connection are skipped
+		std::string peer, direction;
+		if (!(lineStream >> peer >> direction))
+		{
+			std::cout << "NetworkSimulator: malformed line in " << filename << ": " << line << std::endl;
+			continue;
+		}
+
+		if ((first == "client") != (mSide == ClientSide))
+			continue;
+
+		LinkConditions conditions;
+		std::string rule;
+		while (lineStream >> rule)
+		{
+			if (!parseRule(rule, conditions))
+				std::cout << "NetworkSimulator: unknown rule " << rule << " in " << filename << std::endl;
+		}
+
+		int peerNumber = (peer == "*") ? AnyPeer : std::atoi(peer.c_str());
+		setConditions(peerNumber, direction == "in" ? Incoming : Outgoing, conditions);
+	}
+
+	return true;
+}
+
+void NetworkSimulator::setSeed(unsigned int seed)
+{
+	mSeed = seed;
+
+	// Restart every link's generator so runs with the same seed match from here on
+	FOREACH(auto& pair, mLinks)
+		pair.second.random.seed(linkSeed(pair.first.first, pair.first.second));
+}
+
+void NetworkSimulator::setConditions(int peer, Direction direction, const LinkConditions& conditions)
+{
+	mConditions[LinkKey(peer, direction)] = conditions;
+
+	// Links that already exist pick up the new conditions for the packets they have yet to send
+	FOREACH(auto& pair, mLinks)
+	{
+		if (pair.first.second == direction && (peer == AnyPeer || pair.first.first == peer))
+		{
+			if (const LinkConditions* current = findConditions(pair.first.first, direction))
+				pair.second.conditions = *current;
+		}
+	}
+}
+
+bool NetworkSimulator::isEnabled() const
+{
+	return !mConditions.empty();
+}
+
+bool NetworkSimulator::submit(int peer, Direction direction, const sf::Packet& packet, sf::Time now)
+{
+	Link* link = findLink(peer, direction);
+	if (!link)
+		return false;
+
+	const LinkConditions& conditions = link->conditions;
+	std::uniform_real_distribution<float> chance(0.f, 1.f);
+
+	// Bandwidth cap: the packet goes out once the link has finished sending the previous ones
+	sf::Time departure = std::max(now, link->linkFreeAt);
+	if (conditions.bandwidth > 0)
+		departure += sf::seconds(static_cast<float>(packet.getDataSize()) / conditions.bandwidth);
+	link->linkFreeAt = departure;
+
+	sf::Time delivery = departure + conditions.latency;
+	if (conditions.jitter > sf::Time::Zero)
+	{
+		std::uniform_real_distribution<float> jitter(-conditions.jitter.asSeconds(), conditions.jitter.asSeconds());
+		delivery += sf::seconds(jitter(link->random));
+	}
+
+	if (chance(link->random) < conditions.lossRate)
+		delivery += conditions.retransmitTimeout;
+
+	if (chance(link->random) < conditions.reorderRate)
+	{
+		// Held back without holding up the stream: later packets overtake it
+		delivery = std::max(delivery, link->lastDelivery) + conditions.reorderDelay;
+	}
+	else
+	{
+		// A stream delivers in order, so a stalled packet stalls everything behind it
+		delivery = std::max(delivery, link->lastDelivery);
+		link->lastDelivery = delivery;
+	}
+
+	link->inFlight.insert(std::make_pair(delivery, packet));
+
+	if (chance(link->random) < conditions.duplicateRate)
+		link->inFlight.insert(std::make_pair(delivery + sf::milliseconds(1), packet));
+
+	return true;
+}
+
+bool NetworkSimulator::poll(int peer, Direction direction, sf::Packet& packet, sf::Time now)
+{
+	auto found = mLinks.find(LinkKey(peer, direction));
+	if (found == mLinks.end())
+		return false;
+
+	std::multimap<sf::Time, sf::Packet>& inFlight = found->second.inFlight;
+	if (inFlight.empty() || inFlight.begin()->first > now)
+		return false;
+
+	packet = inFlight.begin()->second;
+	inFlight.erase(inFlight.begin());
+	return true;
+}
+
+void NetworkSimulator::removePeer(int peer)
+{
+	mLinks.erase(LinkKey(peer, Incoming));
+	mLinks.erase(LinkKey(peer, Outgoing));
+}
+
+NetworkSimulator::Link* NetworkSimulator::findLink(int peer, Direction direction)
+{
+	LinkKey key(peer, direction);
+
+	auto found = mLinks.find(key);
+	if (found != mLinks.end())
+		return &found->second;
+
+	const LinkConditions* conditions = findConditions(peer, direction);
+	if (!conditions)
+		return nullptr;
+
+	Link& link = mLinks[key];
+	link.conditions = *conditions;
+	link.random.seed(linkSeed(peer, direction));
+	link.lastDelivery = sf::Time::Zero;
+	link.linkFreeAt = sf::Time::Zero;
+	return &link;
+}
+
+const LinkConditions* NetworkSimulator::findConditions(int peer, Direction direction) const
+{
+	// A rule for this exact peer wins over the wildcard
+	auto found = mConditions.find(LinkKey(peer, direction));
+	if (found == mConditions.end())
+		found = mConditions.find(LinkKey(AnyPeer, direction));
+
+	return (found != mConditions.end()) ? &found->second : nullptr;
+}
+
+unsigned int NetworkSimulator::linkSeed(int peer, Direction direction) const
+{
+	return mSeed ^ (static_cast<unsigned int>(peer + 1) * 2654435761u) ^ (direction == Incoming ? 0x9e3779b9u : 0u);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <SFML/System/Time.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/Network/Packet.hpp>
+
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+
+
+// Impairments applied to one direction of one connection
+struct LinkConditions
+{
+	LinkConditions();
+
+	sf::Time				latency;
+	sf::Time				jitter;				// uniform, +/- this much on top of latency
+	float					lossRate;			// TCP resends lost segments: a loss stalls the stream for retransmitTimeout
+	sf::Time				retransmitTimeout;
+	float					duplicateRate;
+	float					reorderRate;		// a reordered packet is held back reorderDelay and overtaken by later ones
+	sf::Time				reorderDelay;
+	std::size_t				bandwidth;			// bytes per second, 0 for unlimited
+};
+
+// Test shim that sits between the game and its sockets and delays, stalls, duplicates and reorders
+// packets according to per-peer, per-direction LinkConditions. Every link draws from its own
+// generator seeded from a common seed, so a run can be reproduced exactly.
+//
+// Conditions are set programmatically or read from a script, one rule per line:
+//   seed 1234
+//   client * out latency=80 jitter=20 loss=0.01
+//   server 2 in bandwidth=16000 reorder=0.05
+// where the side is "client" or "server", the peer is a server connection number or *, and the
+// direction is "in" or "out". Times are in milliseconds.
+class NetworkSimulator : private sf::NonCopyable
+{
+public:
+	enum Side
+	{
+		ClientSide,
+		ServerSide,
+	};
+
+	enum Direction
+	{
+		Incoming,
+		Outgoing,
+	};
+
+	static const int		AnyPeer = -1;
+
+
+public:
+	explicit				NetworkSimulator(Side side);
+
+	bool					loadScript(const std::string& filename);
+	void					setSeed(unsigned int seed);
+	void					setConditions(int peer, Direction direction, const LinkConditions& conditions);
+	bool					isEnabled() const;
+
+	// Returns false if no conditions apply to the link; the caller then sends the packet straight through
+	bool					submit(int peer, Direction direction, const sf::Packet& packet, sf::Time now);
+	bool					poll(int peer, Direction direction, sf::Packet& packet, sf::Time now);
+	void					removePeer(int peer);
+
+
+private:
+	typedef std::pair<int, Direction> LinkKey;
+
+	struct Link
+	{
+		LinkConditions						conditions;
+		std::mt19937						random;
+		std::multimap<sf::Time, sf::Packet>	inFlight;
+		sf::Time							lastDelivery;	// in-order packets may not arrive before this
+		sf::Time							linkFreeAt;		// when the bandwidth cap allows the next byte out
+	};
+
+
+private:
+	Link*					findLink(int peer, Direction direction);
+	const LinkConditions*	findConditions(int peer, Direction direction) const;
+	unsigned int			linkSeed(int peer, Direction direction) const;
+
+
+private:
+	Side								mSide;
+	unsigned int						mSeed;
+	std::map<LinkKey, LinkConditions>	mConditions;
+	std::map<LinkKey, Link>				mLinks;
+};
@@ -8,6 +8,9 @@
 #include "SoundNode.hpp"
 #include "NetworkNode.hpp"
 #include "ResourceHolder.hpp"
+#include "SpriteBatch.hpp"
+#include "TextureAtlas.hpp"
+#include "StaticGeometryNode.hpp"
 
 #include <SFML/Graphics/RenderTarget.hpp>
 #include <SFML/Graphics/RenderStates.hpp>
@@ -22,7 +25,8 @@ namespace
 
 Obstacle::Obstacle(ObType type, const TextureHolder& textures) : Entity(Table[type].hitpoints) //Constructor, inherits from entity, has hitpoints type and texture defined in datatables
 , mType(type)
-, mSprite(textures.get(Table[type].texture), Table[type].textureRect)
+, mSprite(textures.get(Table[type].texture), TextureAtlas::getRect(Table[type].texture, Table[type].textureRect))
+, mBaked(false)
 
 {
 	centerOrigin(mSprite);
@@ -38,13 +42,36 @@ sf::FloatRect Obstacle::getBoundingRect() const
 	return getWorldTransform().transformRect(mSprite.getGlobalBounds()); //returns boudning rectangle used for collision detection
 }
 
+void Obstacle::bakeInto(StaticGeometryNode& geometry)
+{
+	geometry.addSprite(mSprite, getWorldTransform());
+	mBaked = true;
+	markBoundsDirty();
+}
+
 void Obstacle::drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const
 {
-	
+	if (!mBaked)
 		target.draw(mSprite, states); //draws sprite onto target
 		//drawBoundingCirc(target, states, mObRadius);
 }
 
+void Obstacle::batchCurrent(SpriteBatch& batch, sf::RenderStates states) const
+{
+	if (!mBaked)
+		batch.draw(mSprite, states.transform);
+}
+
+sf::FloatRect Obstacle::getDrawBounds() const
+{
+	return mBaked ? sf::FloatRect() : mSprite.getGlobalBounds();
+}
+
+bool Obstacle::isStatic() const
+{
+	return true;
+}
+
 unsigned int Obstacle::getCategory() const
 {
 		return Category::Obstacle;
@@ -9,6 +9,8 @@
 
 #include <SFML/Graphics/Sprite.hpp>
 
+class StaticGeometryNode;
+
 //This class was worked on by Kieran Keegan
 
 
@@ -34,13 +36,20 @@ public:
 	~Obstacle();
 	sf::FloatRect	getBoundingRect() const;
 
+	// Hands the sprite to the static geometry, which draws it from then on
+	void			bakeInto(StaticGeometryNode& geometry);
+	virtual bool	isStatic() const;
+
 private:
 	virtual void			drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const;
+	virtual void			batchCurrent(SpriteBatch& batch, sf::RenderStates states) const;
+	virtual sf::FloatRect	getDrawBounds() const;
 
 private:
 	ObType					mType;
 	
 	float					mObRadius = 40.f;
+	bool					mBaked;
 	//int						mIdentifier;
 
 };
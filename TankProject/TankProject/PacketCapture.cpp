@@ -0,0 +1,173 @@
+#include "PacketCapture.hpp"
+
+#include <SFML/System/Sleep.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+
+namespace
+{
+	const char FileMagic[] = { 'T', 'K', 'C', 'P' };
+	// 2: input frame counts are Int32 like every other vector
+	// 3: the server's seeds follow the version
+	const sf::Uint32 FileVersion = 3;
+
+	// Larger than any packet the game sends; a bigger size means the file is damaged
+	const sf::Uint32 MaxRecordSize = 1 << 20;
+
+	void writeUint32(std::ofstream& file, sf::Uint32 value)
+	{
+		std::vector<char> bytes;
+		Schema::encode(bytes, value);
+		file.write(bytes.data(), bytes.size());
+	}
+
+	bool readUint32(std::ifstream& file, sf::Uint32& value)
+	{
+		char bytes[sizeof(sf::Uint32)];
+		if (!file.read(bytes, sizeof(bytes)))
+			return false;
+
+		Schema::ByteReader reader(bytes, sizeof(bytes));
+		reader & value;
+		return reader.isValid();
+	}
+}
+
+PacketRecorder::PacketRecorder()
+	: mThread(&PacketRecorder::writerThread, this)
+	, mFile()
+	, mWaitingThreadEnd(false)
+	, mOpen(false)
+	, mQueue()
+	, mDroppedEvents(0)
+{
+}
+
+PacketRecorder::~PacketRecorder()
+{
+	mWaitingThreadEnd = true;
+	mThread.wait();
+
+	// Counted on the server thread, which has stopped by now
+	if (mDroppedEvents > 0)
+		std::cout << "Capture: queue was full, " << mDroppedEvents << " events dropped" << std::endl;
+}
+
+bool PacketRecorder::open(const std::string& filename, const CaptureSeeds& seeds)
+{
+	mFile.open(filename, std::ios::binary | std::ios::trunc);
+	if (!mFile)
+		return false;
+
+	mFile.write(FileMagic, sizeof(FileMagic));
+	writeUint32(mFile, FileVersion);
+
+	std::vector<char> bytes;
+	Schema::encode(bytes, seeds);
+	mFile.write(bytes.data(), bytes.size());
+
+	mOpen = true;
+	mThread.launch();
+	return true;
+}
+
+bool PacketRecorder::isOpen() const
+{
+	return mOpen;
+}
+
+void PacketRecorder::recordConnection(sf::Time time, int connection)
+{
+	CapturedEvent event;
+	event.kind = CapturedEvent::Connection;
+	event.time = time.asMicroseconds();
+	event.connection = connection;
+
+	record(event);
+}
+
+void PacketRecorder::recordPacket(sf::Time time, int connection, const sf::Packet& packet)
+{
+	CapturedEvent event;
+	event.kind = CapturedEvent::Packet;
+	event.time = time.asMicroseconds();
+	event.connection = connection;
+
+	const sf::Uint8* data = static_cast<const sf::Uint8*>(packet.getData());
+	event.data.assign(data, data + packet.getDataSize());
+
+	record(event);
+}
+
+void PacketRecorder::record(const CapturedEvent& event)
+{
+	if (!mOpen)
+		return;
+
+	std::vector<char> bytes;
+	Schema::encode(bytes, static_cast<sf::Uint32>(Schema::encodedSize(event)));
+	Schema::encode(bytes, event);
+
+	// The server must not wait on the disk; a capture with a gap is still useful, and says so
+	if (!mQueue.push(bytes))
+		++mDroppedEvents;
+}
+
+void PacketRecorder::writerThread()
+{
+	while (!mWaitingThreadEnd)
+	{
+		writePending();
+		sf::sleep(sf::milliseconds(10));
+	}
+
+	writePending();
+	mFile.flush();
+}
+
+void PacketRecorder::writePending()
+{
+	std::vector<char> bytes;
+	while (mQueue.pop(bytes))
+		mFile.write(bytes.data(), bytes.size());
+}
+
+bool PacketLogReader::open(const std::string& filename)
+{
+	mFile.open(filename, std::ios::binary);
+
+	char magic[sizeof(FileMagic)];
+	sf::Uint32 version;
+	if (!mFile.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), FileMagic) || !readUint32(mFile, version))
+		return false;
+
+	if (version != FileVersion)
+		return false;
+
+	// Fixed size, unlike the events
+	std::vector<char> seeds(Schema::encodedSize(mSeeds));
+	if (!mFile.read(seeds.data(), seeds.size()))
+		return false;
+
+	return Schema::decode(seeds.data(), seeds.size(), mSeeds);
+}
+
+const CaptureSeeds& PacketLogReader::getSeeds() const
+{
+	return mSeeds;
+}
+
+bool PacketLogReader::next(CapturedEvent& event)
+{
+	sf::Uint32 size;
+	if (!readUint32(mFile, size) || size > MaxRecordSize)
+		return false;
+
+	mBuffer.resize(size);
+	if (size > 0 && !mFile.read(mBuffer.data(), size))
+		return false;
+
+	return Schema::decode(mBuffer.data(), mBuffer.size(), event);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "SpscQueue.hpp"
+#include "MessageSchema.hpp"
+
+#include <SFML/System/Thread.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/Network/Packet.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// One event of a capture: a peer connecting, or a packet from it as the server handles it,
+// after the network simulator has delayed or dropped packets. Stored as [Uint32:recordSize] followed by the encoded record.
+struct CapturedEvent
+{
+	enum Kind
+	{
+		Connection,
+		Packet,
+	};
+
+	CapturedEvent()
+		: kind(Packet), time(0), connection(0), data()
+	{
+	}
+
+	sf::Uint8				kind;
+	sf::Int64				time;			// server clock, microseconds
+	sf::Int32				connection;		// the server's connection number of the peer
+	std::vector<sf::Uint8>	data;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.kind & self.time & self.connection & self.data;
+	}
+};
+
+// The server's random seeds, stored at the start of a capture so that a replay draws the same pickups
+// and hands out the same session tokens; a client resuming with a captured token then finds its session
+struct CaptureSeeds
+{
+	CaptureSeeds()
+		: pickupSeed(0), sessionSeed(0)
+	{
+	}
+
+	sf::Uint32				pickupSeed;
+	sf::Uint32				sessionSeed;
+
+	template <typename Archive, typename Self>
+	static void fields(Archive& archive, Self& self)
+	{
+		archive & self.pickupSeed & self.sessionSeed;
+	}
+};
+
+// Appends events to a capture file. record() is called from the server thread and only
+// encodes and queues; a writer thread of its own does the file I/O.
+class PacketRecorder : private sf::NonCopyable
+{
+public:
+							PacketRecorder();
+							~PacketRecorder();
+
+	bool					open(const std::string& filename, const CaptureSeeds& seeds);
+	bool					isOpen() const;
+
+	void					recordConnection(sf::Time time, int connection);
+	void					recordPacket(sf::Time time, int connection, const sf::Packet& packet);
+
+
+private:
+	static const std::size_t	QueueCapacity = 4096;
+
+
+private:
+	void					record(const CapturedEvent& event);
+	void					writerThread();
+	void					writePending();
+
+
+private:
+	sf::Thread									mThread;
+	std::ofstream								mFile;
+	std::atomic<bool>							mWaitingThreadEnd;
+	bool										mOpen;
+
+	SpscQueue<std::vector<char>, QueueCapacity>	mQueue;
+	std::size_t									mDroppedEvents;
+};
+
+// Reads a capture file back, event by event
+class PacketLogReader : private sf::NonCopyable
+{
+public:
+	bool					open(const std::string& filename);
+	// The seeds the captured server ran with; valid once open() succeeded
+	const CaptureSeeds&		getSeeds() const;
+
+	// False at the end of the file, or at the first damaged record
+	bool					next(CapturedEvent& event);
+
+
+private:
+	std::ifstream			mFile;
+	std::vector<char>		mBuffer;
+	CaptureSeeds			mSeeds;
+};
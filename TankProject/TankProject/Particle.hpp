@@ -1,9 +1,7 @@
 #pragma once
 
-#include <SFML/System/Vector2.hpp>
-#include <SFML/System/Time.hpp>
-#include <SFML/Graphics/Color.hpp>
 
+// Particles themselves are stored by ParticleNode, attribute by attribute
 struct Particle
 {
 	enum Type
@@ -12,8 +10,4 @@ struct Particle
 		Smoke,
 		ParticleCount
 	};
-
-	sf::Vector2f position;
-	sf::Color color;
-	sf::Time lifetime;
 };
\ No newline at end of file
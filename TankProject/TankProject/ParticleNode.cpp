@@ -1,7 +1,7 @@
 #include "ParticleNode.hpp"
-#include "Foreach.hpp"
 #include "DataTables.hpp"
 #include "ResourceHolder.hpp"
+#include "SpriteBatch.hpp"
 
 #include <SFML/Graphics/RenderTarget.hpp>
 #include <SFML/Graphics/Texture.hpp>
@@ -16,21 +16,61 @@ namespace
 
 ParticleNode::ParticleNode(Particle::Type type, const TextureHolder& textures)
 	:SceneNode()
-	, mParticles()
 	, mTexture(textures.get(Textures::Particle))
 	, mType(type)
-	, mVertexArray(sf::Quads) 
-	, mNeedsVertexUpdate(true)
-{}
+	, mLifetime(Table[type].lifetime)
+	, mPositions(Table[type].capacity)
+	, mBirthTimes(Table[type].capacity)
+	, mColors(Table[type].capacity)
+	, mHead(0)
+	, mCount(0)
+	, mAge(0.f)
+	, mAlphas(Table[type].capacity)
+	, mVertices(Table[type].capacity * 4)
+	, mBounds()
+	, mNeedsVertexUpdate(false)
+{
+	//texture coordinates are the same for every quad and never change
+	sf::Vector2f size(mTexture.getSize());
+	for (std::size_t slot = 0; slot < mPositions.size(); ++slot)
+	{
+		sf::Vertex* quad = &mVertices[slot * 4];
+		quad[0].texCoords = sf::Vector2f(0.f, 0.f);
+		quad[1].texCoords = sf::Vector2f(size.x, 0.f);
+		quad[2].texCoords = sf::Vector2f(size.x, size.y);
+		quad[3].texCoords = sf::Vector2f(0.f, size.y);
+	}
+}
 
 void ParticleNode::addParticle(sf::Vector2f position)
 {
-	Particle particle;
-	particle.position = position;
-	particle.color = Table[mType].color;
-	particle.lifetime = Table[mType].lifetime;
-
-	mParticles.push_back(particle);
+	std::size_t capacity = mPositions.size();
+	if (capacity == 0)
+		return;
+
+	//make room by retiring the oldest particle
+	if (mCount == capacity)
+		retire(1);
+
+	std::size_t slot = (mHead + mCount) % capacity;
+	mPositions[slot] = position;
+	mBirthTimes[slot] = mAge;
+	mColors[slot] = Table[mType].color;
+	++mCount;
+
+	//the 4 vertices that define the particle, written once
+	sf::Vector2f half = sf::Vector2f(mTexture.getSize()) / 2.f;
+	sf::Vertex* quad = &mVertices[slot * 4];
+	quad[0].position = sf::Vector2f(position.x - half.x, position.y - half.y); //top left
+	quad[1].position = sf::Vector2f(position.x + half.x, position.y - half.y); //top right
+	quad[2].position = sf::Vector2f(position.x + half.x, position.y + half.y); //bottom right
+	quad[3].position = sf::Vector2f(position.x - half.x, position.y + half.y); //bottom left
+
+	for (std::size_t i = 0; i < 4; ++i)
+		quad[i].color = mColors[slot];
+
+	mNeedsVertexUpdate = true;
+	markBoundsDirty();
 }
 
 Particle::Type ParticleNode::getParticleType() const
@@ -45,73 +85,138 @@ unsigned int ParticleNode::getCategory() const
 
 void ParticleNode::updateCurrent(sf::Time dt, CommandQueue&)
 {
-	//Remove expired particles at the beginning
-	while (!mParticles.empty() && mParticles.front().lifetime <= sf::Time::Zero)
-	{
-		mParticles.pop_front();
-	}
+	mAge += dt.asSeconds();
 
-	//Decrease the lifetime of existing particles
-	FOREACH(Particle& particle, mParticles)
-	{
-		particle.lifetime -= dt;
-	}
+	//particles are added in order of birth, so the expired ones are all at the head
+	float lifetime = mLifetime.asSeconds();
+	std::size_t expired = 0;
+	while (expired < mCount && mAge - mBirthTimes[(mHead + expired) % mPositions.size()] >= lifetime)
+		++expired;
+
+	retire(expired);
 
-	mNeedsVertexUpdate = true; //check that something has changed before we set this?
+	mNeedsVertexUpdate = true;
+	markBoundsDirty();
 }
 
 void ParticleNode::drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const
 {
 	if (mNeedsVertexUpdate)
 	{
-		computeVertices();
+		updateVertices();
 		mNeedsVertexUpdate = false;
 	}
 
 	//apply the particle texture
 	states.texture = &mTexture;
 
-	//Draw vertices
-	target.draw(mVertexArray, states);
+	//Draw vertices, oldest first
+	std::size_t first[2], count[2];
+	std::size_t runs = getRuns(first, count);
+	for (std::size_t run = 0; run < runs; ++run)
+		target.draw(&mVertices[first[run] * 4], count[run] * 4, sf::Quads, states);
 }
 
-void ParticleNode::addVertex(float worldX, float worldY, float textureCoordX, float textureCoordY, const sf::Color& color) const
+void ParticleNode::batchCurrent(SpriteBatch& batch, sf::RenderStates states) const
 {
-	sf::Vertex vertex;
-	vertex.position = sf::Vector2f(worldX, worldY);
-	vertex.texCoords = sf::Vector2f(textureCoordX, textureCoordY);
-	vertex.color = color;
+	if (mNeedsVertexUpdate)
+	{
+		updateVertices();
+		mNeedsVertexUpdate = false;
+	}
+
+	states.texture = &mTexture;
 
-	mVertexArray.append(vertex);
+	std::size_t first[2], count[2];
+	std::size_t runs = getRuns(first, count);
+	for (std::size_t run = 0; run < runs; ++run)
+		batch.draw(&mVertices[first[run] * 4], count[run] * 4, sf::Quads, states);
 }
 
-void ParticleNode::computeVertices() const
+sf::FloatRect ParticleNode::getDrawBounds() const
 {
-	sf::Vector2f size(mTexture.getSize());
-	sf::Vector2f half = size / 2.f;
-
-	//refill vertex array
-	mVertexArray.clear();
-	FOREACH(const Particle& particle, mParticles)
+	if (mNeedsVertexUpdate)
 	{
-		sf::Vector2f position = particle.position;
-		sf::Color color = particle.color;
-
-		float ratio = particle.lifetime.asSeconds() / Table[mType].lifetime.asSeconds();
-		color.a = static_cast<sf::Uint8>(255 * std::max(ratio, 0.f));
-
-		//add the 4 vertices that define the particle
-		addVertex(position.x - half.x, position.y - half.y, 0.f, 0.f, color); //top left
-		addVertex(position.x + half.x, position.y - half.y, size.x, 0.f, color); //top right
-		addVertex(position.x + half.x, position.y + half.y, size.x, size.y, color); //bottom right
-		addVertex(position.x - half.x, position.y + half.y, 0.f, size.y, color); //bottom left
+		updateVertices();
+		mNeedsVertexUpdate = false;
 	}
+
+	return mBounds;
 }
 
+void ParticleNode::retire(std::size_t count)
+{
+	if (count == 0)
+		return;
+
+	mHead = (mHead + count) % mPositions.size();
+	mCount -= count;
+}
 
+void ParticleNode::updateVertices() const
+{
+	std::size_t first[2], count[2];
+	std::size_t runs = getRuns(first, count);
 
+	if (runs == 0)
+	{
+		mBounds = sf::FloatRect();
+		return;
+	}
 
+	//alpha falls linearly from full at birth to nothing at the end of the lifetime
+	float scale = 255.f / mLifetime.asSeconds();
+	float offset = (mLifetime.asSeconds() - mAge) * scale;
 
+	sf::Vector2f min(mPositions[mHead]);
+	sf::Vector2f max(min);
 
+	for (std::size_t run = 0; run < runs; ++run)
+	{
+		const float* births = &mBirthTimes[first[run]];
+		sf::Uint8* alphas = &mAlphas[first[run]];
+		std::size_t size = count[run];
+
+		//plain arithmetic over contiguous arrays, so the compiler can vectorise it
+		for (std::size_t i = 0; i < size; ++i)
+			alphas[i] = static_cast<sf::Uint8>(std::max(births[i] * scale + offset, 0.f));
+
+		//only the alpha of each vertex changes
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			sf::Vertex* quad = &mVertices[(first[run] + i) * 4];
+			quad[0].color.a = alphas[i];
+			quad[1].color.a = alphas[i];
+			quad[2].color.a = alphas[i];
+			quad[3].color.a = alphas[i];
+		}
+
+		const sf::Vector2f* positions = &mPositions[first[run]];
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			min.x = std::min(min.x, positions[i].x);
+			min.y = std::min(min.y, positions[i].y);
+			max.x = std::max(max.x, positions[i].x);
+			max.y = std::max(max.y, positions[i].y);
+		}
+	}
 
+	sf::Vector2f size(mTexture.getSize());
+	mBounds = sf::FloatRect(min - size / 2.f, max - min + size);
+}
 
+std::size_t ParticleNode::getRuns(std::size_t (&first)[2], std::size_t (&count)[2]) const
+{
+	if (mCount == 0)
+		return 0;
+
+	//from the head to the end of the ring, then whatever wrapped around to the start
+	first[0] = mHead;
+	count[0] = std::min(mCount, mPositions.size() - mHead);
+	if (count[0] == mCount)
+		return 1;
+
+	first[1] = 0;
+	count[1] = mCount - count[0];
+	return 2;
+}
@@ -4,10 +4,13 @@
 #include "ResourceIdentifiers.hpp"
 #include "Particle.hpp"
 
-#include <SFML/Graphics/VertexArray.hpp>
+#include <SFML/Graphics/Vertex.hpp>
 
-#include <deque>
+#include <vector>
 
+// Particles live in a ring of fixed capacity, one array per attribute, oldest at the head. Each has its
+// quad written once when it is added; afterwards only the alpha of the quads changes. Particles retire
+// in the order they were added, by moving the head, and a full ring retires its oldest to make room.
 class ParticleNode : public SceneNode
 {
 public:
@@ -19,15 +22,28 @@ public:
 private:
 	virtual void updateCurrent(sf::Time dt, CommandQueue& commands);
 	virtual void drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const;
+	virtual void batchCurrent(SpriteBatch& batch, sf::RenderStates states) const;
+	virtual sf::FloatRect getDrawBounds() const;
 
-	void addVertex(float worldX, float worldY, float texCoordX, float texCoordY, const sf::Color& color) const;
-	void computeVertices() const;
+	void retire(std::size_t count);
+	void updateVertices() const;
+	// The live quads as at most two runs of the vertex array, oldest first
+	std::size_t getRuns(std::size_t (&first)[2], std::size_t (&count)[2]) const;
 
 private:
-	std::deque<Particle> mParticles;
 	const sf::Texture& mTexture;
 	Particle::Type mType;
-
-	mutable sf::VertexArray mVertexArray;
+	sf::Time mLifetime;
+
+	std::vector<sf::Vector2f> mPositions;
+	std::vector<float> mBirthTimes;		// seconds on mAge
+	std::vector<sf::Color> mColors;
+	std::size_t mHead;
+	std::size_t mCount;
+	float mAge;							// seconds since the node was created
+
+	mutable std::vector<sf::Uint8> mAlphas;
+	mutable std::vector<sf::Vertex> mVertices;	// four per slot, preallocated
+	mutable sf::FloatRect mBounds;
 	mutable bool mNeedsVertexUpdate;
-};
\ No newline at end of file
+};
@@ -4,6 +4,9 @@
 #include "CommandQueue.hpp"
 #include "Utility.hpp"
 #include "ResourceHolder.hpp"
+#include "SpriteBatch.hpp"
+#include "TextureAtlas.hpp"
+#include "NetworkProtocol.hpp"
 
 #include <SFML/Graphics/RenderTarget.hpp>
 
@@ -11,16 +14,23 @@
 namespace
 {
 	const std::vector<PickupData> Table = initializePickupData();
+
+	static_assert(Pickup::TypeCount == PickupTypeCount, "Pickup: the server draws pickup types from PickupTypeCount");
 }
 
 Pickup::Pickup(Type type, const TextureHolder& textures)
 	: Entity(1)
 	, mType(type)
-	, mSprite(textures.get(Table[type].texture), Table[type].textureRect)
+	, mSprite(textures.get(Table[type].texture), TextureAtlas::getRect(Table[type].texture, Table[type].textureRect))
 {
 	centerOrigin(mSprite);
 }
 
+Pickup::Type Pickup::getType() const
+{
+	return mType;
+}
+
 unsigned int Pickup::getCategory() const
 {
 	return Category::Pickup;
@@ -41,3 +51,13 @@ void Pickup::drawCurrent(sf::RenderTarget& target, sf::RenderStates states) cons
 	target.draw(mSprite, states);
 }
 
+void Pickup::batchCurrent(SpriteBatch& batch, sf::RenderStates states) const
+{
+	batch.draw(mSprite, states.transform);
+}
+
+sf::FloatRect Pickup::getDrawBounds() const
+{
+	return mSprite.getGlobalBounds();
+}
+
@@ -26,12 +26,15 @@ public:
 
 	virtual unsigned int	getCategory() const;
 	virtual sf::FloatRect	getBoundingRect() const;
+	Type					getType() const;
 
 	void 					apply(Tank& player) const;
 
 
 protected:
 	virtual void			drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const;
+	virtual void			batchCurrent(SpriteBatch& batch, sf::RenderStates states) const;
+	virtual sf::FloatRect	getDrawBounds() const;
 
 
 private:
@@ -2,7 +2,8 @@
 #include "CommandQueue.hpp"
 #include "Tank.hpp"
 #include "Foreach.hpp"
-#include "NetworkProtocol.hpp"
+#include "NetworkMessages.hpp"
+#include "ClientNetworkThread.hpp"
 
 #include <SFML/Network/Packet.hpp>
 
@@ -12,6 +13,12 @@
 
 using namespace std::placeholders;
 
+namespace
+{
+	// A remote tank whose input stops arriving lets go of its keys, rather than driving on
+	const sf::Time NetworkInputTimeout = sf::seconds(0.5f);
+}
+
 enum Direction
 {
 	right,
@@ -101,11 +108,15 @@ struct TankFireTrigger
 	int tankID;
 };
 
-Player::Player(sf::TcpSocket* socket, sf::Int32 identifier, const KeyBinding* binding)
+Player::Player(ClientNetworkThread* network, sf::Int32 identifier, const KeyBinding* binding)
 	: mKeyBinding(binding)
+	, mNetworkSequence(0)
+	, mNetworkActions(0)
+	, mMissedNetworkActions(0)
+	, mNetworkInputClock()
 	, mCurrentMissionStatus(MissionRunning)
 	, mIdentifier(identifier)
-	, mSocket(socket)
+	, mNetwork(network)
 {
 	// Set initial action bindings
 	initializeActions();
@@ -123,13 +134,14 @@ void Player::handleEvent(const sf::Event& event, CommandQueue& commands)
 		if (mKeyBinding && mKeyBinding->checkAction(event.key.code, action) && !isRealtimeAction(action))
 		{
 			// Network connected -> send event over network
-			if (mSocket)
+			if (mNetwork)
 			{
-				sf::Packet packet;
-				packet << static_cast<sf::Int32>(Client::PlayerEvent);
-				packet << mIdentifier;
-				packet << static_cast<sf::Int32>(action);
-				mSocket->send(packet);
+				ClientPlayerEventMessage message;
+				message.identifier = mIdentifier;
+				message.action = static_cast<sf::Int32>(action);
+
+				sf::Packet packet = Schema::makePacket(message);
+				mNetwork->send(packet);
 			}
 
 			// Network disconnected -> local event
@@ -139,21 +151,8 @@ void Player::handleEvent(const sf::Event& event, CommandQueue& commands)
 			}
 		}
 	}
-	// Realtime change (network connected)
-	if ((event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased) && mSocket)
-	{
-		Action action;
-		if (mKeyBinding && mKeyBinding->checkAction(event.key.code, action) && isRealtimeAction(action))
-		{
-			// Send realtime change over network
-			sf::Packet packet;
-			packet << static_cast<sf::Int32>(Client::PlayerRealtimeChange);
-			packet << mIdentifier;
-			packet << static_cast<sf::Int32>(action);
-			packet << (event.type == sf::Event::KeyPressed);
-			mSocket->send(packet);
-		}
-	}
+
+	// Realtime actions go over the network as sequenced input frames, see MultiplayerGameState::sendInputFrames()
 }
 
 bool Player::isLocal() const
@@ -162,23 +161,32 @@ bool Player::isLocal() const
 	return mKeyBinding != nullptr;
 }
 
-void Player::disableAllRealtimeActions()
+sf::Uint8 Player::getRealtimeActionMask() const
 {
-	FOREACH(auto& action, mActionProxies)
+	sf::Uint8 mask = 0;
+	if (!isLocal())
+		return mask;
+
+	std::vector<Action> activeActions = mKeyBinding->getRealtimeActions();
+	FOREACH(Action action, activeActions)
+		mask |= static_cast<sf::Uint8>(1 << action);
+
+	return mask;
+}
+
+void Player::applyActionMask(sf::Uint8 actions, CommandQueue& commands)
+{
+	for (int action = 0; action < PlayerAction::Count; ++action)
 	{
-		sf::Packet packet;
-		packet << static_cast<sf::Int32>(Client::PlayerRealtimeChange);
-		packet << mIdentifier;
-		packet << static_cast<sf::Int32>(action.first);
-		packet << false;
-		mSocket->send(packet);
+		if (actions & (1 << action))
+			commands.push(mActionBinding[static_cast<Action>(action)]);
 	}
 }
 
 void Player::handleRealtimeInput(CommandQueue& commands)
 {
 	// Check if this is a networked game and local player or just a single player game
-	if ((mSocket && isLocal()) || !mSocket)
+	if ((mNetwork && isLocal()) || !mNetwork)
 	{
 		// Lookup all actions and push corresponding commands to queue
 		std::vector<Action> activeActions = mKeyBinding->getRealtimeActions();
@@ -189,14 +197,15 @@ void Player::handleRealtimeInput(CommandQueue& commands)
 
 void Player::handleRealtimeNetworkInput(CommandQueue& commands)
 {
-	if (mSocket && !isLocal())
+	if (mNetwork && !isLocal())
 	{
-		// Traverse all realtime input proxies. Because this is a networked game, the input isn't handled directly
-		FOREACH(auto pair, mActionProxies)
-		{
-			if (pair.second && isRealtimeAction(pair.first))
-				commands.push(mActionBinding[pair.first]);
-		}
+		// Held actions, plus those of frames that were superseded before we got to apply them (e.g. a quick shot)
+		sf::Uint8 actions = mMissedNetworkActions;
+		if (mNetworkInputClock.getElapsedTime() < NetworkInputTimeout)
+			actions |= mNetworkActions;
+
+		applyActionMask(actions, commands);
+		mMissedNetworkActions = 0;
 	}
 }
 
@@ -205,9 +214,16 @@ void Player::handleNetworkEvent(Action action, CommandQueue& commands)
 	commands.push(mActionBinding[action]);
 }
 
-void Player::handleNetworkRealtimeChange(Action action, bool actionEnabled)
+void Player::handleNetworkInputFrame(sf::Uint32 sequence, sf::Uint8 actions)
 {
-	mActionProxies[action] = actionEnabled;
+	// Redundant copy of a frame we already have
+	if (sequence <= mNetworkSequence)
+		return;
+
+	mMissedNetworkActions |= actions;
+	mNetworkActions = actions;
+	mNetworkSequence = sequence;
+	mNetworkInputClock.restart();
 }
 
 void Player::setMissionStatus(MissionStatus status)
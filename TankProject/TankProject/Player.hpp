@@ -4,13 +4,14 @@
 #include "KeyBinding.hpp"
 
 #include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Clock.hpp>
 #include <SFML/Window/Event.hpp>
-#include <SFML/Network/TcpSocket.hpp>
 
 #include <map>
 
 
 class CommandQueue;
+class ClientNetworkThread;
 
 class Player : private sf::NonCopyable
 {
@@ -28,22 +29,28 @@ public:
 
 
 public:
-	Player(sf::TcpSocket* socket, sf::Int32 identifier, const KeyBinding* binding);
+	Player(ClientNetworkThread* network, sf::Int32 identifier, const KeyBinding* binding);
 
 	void					handleEvent(const sf::Event& event, CommandQueue& commands);
 	void					handleRealtimeInput(CommandQueue& commands);
 	void					handleRealtimeNetworkInput(CommandQueue& commands);
 
-	// React to events or realtime state changes received over the network
+	// React to events or input frames received over the network. Frames may repeat or arrive
+	// out of order; the newest one decides which actions are held.
 	void					handleNetworkEvent(Action action, CommandQueue& commands);
-	void					handleNetworkRealtimeChange(Action action, bool actionEnabled);
+	void					handleNetworkInputFrame(sf::Uint32 sequence, sf::Uint8 actions);
 
 	void 					setMissionStatus(MissionStatus status);
 	MissionStatus 			getMissionStatus() const;
 
-	void					disableAllRealtimeActions();
 	bool					isLocal() const;
 
+	// Bitmask (1 << Action) of the realtime actions currently held on the local key binding
+	sf::Uint8				getRealtimeActionMask() const;
+
+	// Pushes the commands for a realtime action mask, e.g. one received for a rollback frame
+	void					applyActionMask(sf::Uint8 actions, CommandQueue& commands);
+
 private:
 	void					initializeActions();
 
@@ -51,8 +58,11 @@ private:
 private:
 	const KeyBinding*			mKeyBinding;
 	std::map<Action, Command>	mActionBinding;
-	std::map<Action, bool>		mActionProxies;
+	sf::Uint32					mNetworkSequence;
+	sf::Uint8					mNetworkActions;
+	sf::Uint8					mMissedNetworkActions;
+	sf::Clock					mNetworkInputClock;
 	MissionStatus 				mCurrentMissionStatus;
 	int							mIdentifier;
-	sf::TcpSocket*				mSocket;
+	ClientNetworkThread*		mNetwork;
 };
\ No newline at end of file
@@ -2,9 +2,21 @@
 
 #include <SFML/Graphics/Shader.hpp>
 #include <SFML/Graphics/RenderTarget.hpp>
-#include <SFML/Graphics/VertexArray.hpp>
+#include <SFML/Graphics/Vertex.hpp>
 
 
+namespace
+{
+	// Unit square, scaled to the output when drawn; texture coordinates are flipped for render textures
+	const sf::Vertex FullscreenQuad[] =
+	{
+		sf::Vertex(sf::Vector2f(0.f, 0.f), sf::Vector2f(0.f, 1.f)),
+		sf::Vertex(sf::Vector2f(1.f, 0.f), sf::Vector2f(1.f, 1.f)),
+		sf::Vertex(sf::Vector2f(0.f, 1.f), sf::Vector2f(0.f, 0.f)),
+		sf::Vertex(sf::Vector2f(1.f, 1.f), sf::Vector2f(1.f, 0.f)),
+	};
+}
+
 PostEffect::~PostEffect()
 {
 }
@@ -13,17 +25,12 @@ void PostEffect::applyShader(const sf::Shader& shader, sf::RenderTarget& output)
 {
 	sf::Vector2f outputSize = static_cast<sf::Vector2f>(output.getSize());
 
-	sf::VertexArray vertices(sf::TrianglesStrip, 4);
-	vertices[0] = sf::Vertex(sf::Vector2f(0, 0), sf::Vector2f(0, 1));
-	vertices[1] = sf::Vertex(sf::Vector2f(outputSize.x, 0), sf::Vector2f(1, 1));
-	vertices[2] = sf::Vertex(sf::Vector2f(0, outputSize.y), sf::Vector2f(0, 0));
-	vertices[3] = sf::Vertex(sf::Vector2f(outputSize), sf::Vector2f(1, 0));
-
 	sf::RenderStates states;
 	states.shader = &shader;
 	states.blendMode = sf::BlendNone;
+	states.transform.scale(outputSize);
 
-	output.draw(vertices, states);
+	output.draw(FullscreenQuad, 4, sf::TrianglesStrip, states);
 }
 
 bool PostEffect::isSupported()
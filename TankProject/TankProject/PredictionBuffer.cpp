@@ -0,0 +1,167 @@
+#include "PredictionBuffer.hpp"
+#include "Tank.hpp"
+#include "Utility.hpp"
+
+#include <SFML/System/Clock.hpp>
+
+#include <cmath>
+#include <iostream>
+
+
+namespace
+{
+	// Below these thresholds the prediction is considered to agree with the server
+	const float PositionTolerance = 0.5f;
+	const float AngleTolerance = 0.5f;
+
+	// Longest a tank's replay may take in one frame; inputs still left then are shifted by the error instead
+	const sf::Time MaxReplayTime = sf::milliseconds(1);
+}
+
+MovementState::MovementState()
+	: position()
+	, rotation(0.f)
+	, turretRotation(0.f)
+	, turretVelocity(0.f)
+{
+}
+
+PredictionBuffer::PredictionBuffer()
+	: mEntries()
+	, mNextSequence(1)
+	, mLastRecorded(0)
+	, mHasAuthoritativeState(false)
+	, mAuthoritativeSequence(0)
+	, mAuthoritativeState()
+{
+}
+
+sf::Uint32 PredictionBuffer::pushInput(sf::Uint8 actions, sf::Time dt)
+{
+	sf::Uint32 sequence = mNextSequence++;
+
+	Entry& input = entry(sequence);
+	input.sequence = sequence;
+	input.actions = actions;
+	input.dt = dt;
+
+	return sequence;
+}
+
+void PredictionBuffer::recordState(const MovementState& state)
+{
+	// Commands are applied on the frame after they were pushed, so the state that was just
+	// simulated belongs to the most recent input
+	sf::Uint32 sequence = mNextSequence - 1;
+	if (sequence == 0)
+		return;
+
+	entry(sequence).state = state;
+	mLastRecorded = sequence;
+}
+
+sf::Uint32 PredictionBuffer::getLastRecordedSequence() const
+{
+	return mLastRecorded;
+}
+
+sf::Uint32 PredictionBuffer::getNewestSequence() const
+{
+	return mNextSequence - 1;
+}
+
+bool PredictionBuffer::getActions(sf::Uint32 sequence, sf::Uint8& actions) const
+{
+	if (!contains(sequence))
+		return false;
+
+	actions = mEntries[sequence % Capacity].actions;
+	return true;
+}
+
+void PredictionBuffer::setAuthoritativeState(sf::Uint32 sequence, const MovementState& state)
+{
+	// Ignore acknowledgements that arrive out of order
+	if (mHasAuthoritativeState && sequence <= mAuthoritativeSequence)
+		return;
+
+	mHasAuthoritativeState = true;
+	mAuthoritativeSequence = sequence;
+	mAuthoritativeState = state;
+}
+
+bool PredictionBuffer::reconcile(const Tank& tank, MovementState& corrected, float& correction)
+{
+	correction = 0.f;
+
+	if (!mHasAuthoritativeState)
+		return false;
+
+	mHasAuthoritativeState = false;
+	sf::Uint32 acknowledged = mAuthoritativeSequence;
+
+	// Server state for an input we no longer remember (or never sent): nothing to compare against
+	if (acknowledged == 0 || acknowledged > mLastRecorded || !contains(acknowledged))
+		return false;
+
+	const MovementState& predicted = entry(acknowledged).state;
+
+	sf::Vector2f positionError = mAuthoritativeState.position - predicted.position;
+	float rotationError = angleDifference(mAuthoritativeState.rotation, predicted.rotation);
+	float turretError = angleDifference(mAuthoritativeState.turretRotation, predicted.turretRotation);
+
+	correction = length(positionError);
+	if (correction < PositionTolerance && std::abs(rotationError) < AngleTolerance && std::abs(turretError) < AngleTolerance)
+		return false;
+
+	sf::Clock replayClock;
+
+	// The server doesn't track turret momentum, keep the predicted one
+	MovementState state = mAuthoritativeState;
+	state.turretVelocity = predicted.turretVelocity;
+	MovementState replaced = predicted;
+
+	// Replay from the acknowledged input on, for as long as the time budget lasts
+	sf::Uint32 sequence = acknowledged + 1;
+	for (; sequence <= mLastRecorded && replayClock.getElapsedTime() < MaxReplayTime; ++sequence)
+	{
+		Entry& input = entry(sequence);
+		tank.predictMovement(state, input.actions, input.dt);
+		replaced = input.state;
+		input.state = state;
+	}
+
+	sf::Uint32 replayed = sequence - acknowledged - 1;
+
+	// Out of time: the newer inputs keep their prediction, moved by the error left at the last replayed one
+	sf::Vector2f remainingPosition = state.position - replaced.position;
+	float remainingRotation = angleDifference(state.rotation, replaced.rotation);
+	float remainingTurret = angleDifference(state.turretRotation, replaced.turretRotation);
+	for (; sequence <= mLastRecorded; ++sequence)
+	{
+		MovementState& shifted = entry(sequence).state;
+		shifted.position += remainingPosition;
+		shifted.rotation += remainingRotation;
+		shifted.turretRotation += remainingTurret;
+		state = shifted;
+	}
+
+	corrected = state;
+
+	std::cout << "Prediction: tank " << tank.getIdentifier() << " corrected by " << correction
+		<< "px at input " << acknowledged << ", replayed " << replayed << " of " << (mLastRecorded - acknowledged)
+		<< " inputs in " << replayClock.getElapsedTime().asMicroseconds() << "us" << std::endl;
+
+	return true;
+}
+
+PredictionBuffer::Entry& PredictionBuffer::entry(sf::Uint32 sequence)
+{
+	return mEntries[sequence % Capacity];
+}
+
+bool PredictionBuffer::contains(sf::Uint32 sequence) const
+{
+	const Entry& stored = mEntries[sequence % Capacity];
+	return stored.sequence == sequence;
+}
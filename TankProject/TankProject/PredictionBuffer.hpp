@@ -0,0 +1,68 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/Config.hpp>
+
+#include <array>
+
+
+class Tank;
+
+// Movement state of a tank, as produced by the local simulation or reported by the server
+struct MovementState
+{
+	MovementState();
+
+	sf::Vector2f			position;
+	float					rotation;
+	float					turretRotation;
+	float					turretVelocity;
+};
+
+// Ring buffer of the inputs a local player applied, and the state each of them produced.
+// When the server acknowledges an input, the predicted state is compared against the
+// authoritative one and the inputs the server hasn't seen yet are replayed on top of it.
+class PredictionBuffer
+{
+public:
+	static const std::size_t	Capacity = 128;
+
+
+public:
+							PredictionBuffer();
+
+	sf::Uint32				pushInput(sf::Uint8 actions, sf::Time dt);
+	void					recordState(const MovementState& state);
+	sf::Uint32				getLastRecordedSequence() const;
+	sf::Uint32				getNewestSequence() const;
+	bool					getActions(sf::Uint32 sequence, sf::Uint8& actions) const;
+
+	void					setAuthoritativeState(sf::Uint32 sequence, const MovementState& state);
+	bool					reconcile(const Tank& tank, MovementState& corrected, float& correction);
+
+
+private:
+	struct Entry
+	{
+		sf::Uint32			sequence;
+		sf::Uint8			actions;
+		sf::Time			dt;
+		MovementState		state;
+	};
+
+
+private:
+	Entry&					entry(sf::Uint32 sequence);
+	bool					contains(sf::Uint32 sequence) const;
+
+
+private:
+	std::array<Entry, Capacity>	mEntries;
+	sf::Uint32					mNextSequence;
+	sf::Uint32					mLastRecorded;
+
+	bool						mHasAuthoritativeState;
+	sf::Uint32					mAuthoritativeSequence;
+	MovementState				mAuthoritativeState;
+};
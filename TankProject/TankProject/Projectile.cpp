@@ -5,6 +5,8 @@
 #include "Utility.hpp"
 #include "ResourceHolder.hpp"
 #include "EmitterNode.hpp"
+#include "SpriteBatch.hpp"
+#include "TextureAtlas.hpp"
 
 #include <SFML/Graphics/RenderTarget.hpp>
 #include <SFML/Graphics/RenderStates.hpp>
@@ -23,7 +25,7 @@ namespace
 Projectile::Projectile(Type type, const TextureHolder& textures)
 	: Entity(1)
 	, mType(type)
-	, mSprite(textures.get(Table[type].texture), Table[type].textureRect)
+	, mSprite(textures.get(Table[type].texture), TextureAtlas::getRect(Table[type].texture, Table[type].textureRect))
 	, mTargetDirection()
 {
 	centerOrigin(mSprite);
@@ -77,6 +79,16 @@ void Projectile::drawCurrent(sf::RenderTarget& target, sf::RenderStates states)
 	target.draw(mSprite, states);
 }
 
+void Projectile::batchCurrent(SpriteBatch& batch, sf::RenderStates states) const
+{
+	batch.draw(mSprite, states.transform);
+}
+
+sf::FloatRect Projectile::getDrawBounds() const
+{
+	return mSprite.getGlobalBounds();
+}
+
 unsigned int Projectile::getCategory() const
 {
 	if (mType == EnemyBullet)
@@ -99,3 +111,18 @@ int Projectile::getDamage() const
 {
 	return Table[mType].damage;
 }
+
+Projectile::Type Projectile::getType() const
+{
+	return mType;
+}
+
+sf::Vector2f Projectile::getTargetDirection() const
+{
+	return mTargetDirection;
+}
+
+void Projectile::setTargetDirection(sf::Vector2f direction)
+{
+	mTargetDirection = direction;
+}
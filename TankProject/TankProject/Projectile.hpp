@@ -25,10 +25,15 @@ public:
 	virtual sf::FloatRect getBoundingRect() const;
 	float getMaxSpeed() const;
 	int getDamage() const;
+	Type getType() const;
+	sf::Vector2f getTargetDirection() const;
+	void setTargetDirection(sf::Vector2f direction);
 
 private:
 	virtual void updateCurrent(sf::Time dt, CommandQueue& commands);
 	virtual void drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const;
+	virtual void batchCurrent(SpriteBatch& batch, sf::RenderStates states) const;
+	virtual sf::FloatRect getDrawBounds() const;
 
 private:
 	Type mType;
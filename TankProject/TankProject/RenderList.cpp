@@ -0,0 +1,95 @@
+#include "RenderList.hpp"
+
+
+RenderList::RenderList()
+	: mFrame(0)
+	, mView()
+	, mStaticCached(false)
+	, mBloomEnabled(false)
+	, mScene()
+	, mStaticUpdates()
+	, mStaticUpdateCount(0)
+{
+}
+
+void RenderList::clear()
+{
+	mScene.clear();
+	mStaticUpdateCount = 0;
+}
+
+void RenderList::setFrame(std::size_t frame)
+{
+	mFrame = frame;
+}
+
+std::size_t RenderList::getFrame() const
+{
+	return mFrame;
+}
+
+void RenderList::setView(const sf::View& view)
+{
+	mView = view;
+}
+
+const sf::View& RenderList::getView() const
+{
+	return mView;
+}
+
+void RenderList::setStaticCached(bool cached)
+{
+	mStaticCached = cached;
+}
+
+bool RenderList::isStaticCached() const
+{
+	return mStaticCached;
+}
+
+void RenderList::setBloomEnabled(bool enabled)
+{
+	mBloomEnabled = enabled;
+}
+
+bool RenderList::isBloomEnabled() const
+{
+	return mBloomEnabled;
+}
+
+SpriteBatch& RenderList::getScene()
+{
+	return mScene;
+}
+
+const SpriteBatch& RenderList::getScene() const
+{
+	return mScene;
+}
+
+SpriteBatch& RenderList::addStaticUpdate(const sf::IntRect& pixels)
+{
+	if (mStaticUpdateCount == mStaticUpdates.size())
+		mStaticUpdates.push_back(std::unique_ptr<StaticUpdate>(new StaticUpdate()));
+
+	StaticUpdate& update = *mStaticUpdates[mStaticUpdateCount++];
+	update.pixels = pixels;
+	update.batch.clear();
+	return update.batch;
+}
+
+std::size_t RenderList::getStaticUpdateCount() const
+{
+	return mStaticUpdateCount;
+}
+
+const sf::IntRect& RenderList::getStaticUpdatePixels(std::size_t index) const
+{
+	return mStaticUpdates[index]->pixels;
+}
+
+const SpriteBatch& RenderList::getStaticUpdate(std::size_t index) const
+{
+	return mStaticUpdates[index]->batch;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "SpriteBatch.hpp"
+
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/View.hpp>
+
+#include <memory>
+#include <vector>
+
+
+// One frame of the world as the simulation recorded it, for the render thread to submit: the view,
+// the scene's draw batches with every transform resolved, the parts of the static layer cache to
+// render again, and which post effects to apply. It shares textures with the scene: the loaded ones,
+// which do not change while the world exists, and the page of the glyph cache's own copy of the main
+// font, whose glyphs are all loaded before the render thread starts. Nothing in it draws with a font directly.
+class RenderList : private sf::NonCopyable
+{
+public:
+							RenderList();
+
+	// Empties the list but keeps its storage for the next frame
+	void					clear();
+
+	void					setFrame(std::size_t frame);
+	std::size_t				getFrame() const;
+
+	void					setView(const sf::View& view);
+	const sf::View&			getView() const;
+
+	// When cached, the scene holds only the dynamic nodes and the static ones come from the cache
+	void					setStaticCached(bool cached);
+	bool					isStaticCached() const;
+
+	void					setBloomEnabled(bool enabled);
+	bool					isBloomEnabled() const;
+
+	SpriteBatch&			getScene();
+	const SpriteBatch&		getScene() const;
+
+	// Static nodes to render again into the given pixels of the cache
+	SpriteBatch&			addStaticUpdate(const sf::IntRect& pixels);
+	std::size_t				getStaticUpdateCount() const;
+	const sf::IntRect&		getStaticUpdatePixels(std::size_t index) const;
+	const SpriteBatch&		getStaticUpdate(std::size_t index) const;
+
+
+private:
+	struct StaticUpdate
+	{
+		sf::IntRect			pixels;
+		SpriteBatch			batch;
+	};
+
+
+private:
+	std::size_t				mFrame;
+	sf::View				mView;
+	bool					mStaticCached;
+	bool					mBloomEnabled;
+	SpriteBatch				mScene;
+	std::vector<std::unique_ptr<StaticUpdate>>	mStaticUpdates;
+	std::size_t				mStaticUpdateCount;
+};
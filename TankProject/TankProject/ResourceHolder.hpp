@@ -11,7 +11,7 @@ template <typename Resource, typename Identifier>
 class ResourceHolder
 {
 private:
-	std::map<Identifier, std::unique_ptr<Resource>> mResourceMap;
+	std::map<Identifier, std::shared_ptr<Resource>> mResourceMap;
 
 public:
 	void load(Identifier id, const std::string& filename);
@@ -19,6 +19,12 @@ public:
 	template<typename Parameter>
 	void load(Identifier id, const std::string& filename, const Parameter& secondParam);
 
+	//Takes over a resource that was created elsewhere, e.g. a texture from an image decoded on another thread
+	void insert(Identifier id, std::unique_ptr<Resource> resource);
+
+	//Makes id another name for an already held resource, e.g. several textures packed into one atlas page
+	void share(Identifier id, Identifier existing);
+
 	Resource& get(Identifier id);
 	const Resource& get(Identifier id) const;
 
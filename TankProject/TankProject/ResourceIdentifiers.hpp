@@ -3,6 +3,7 @@
 namespace sf
 {
 	class Texture;
+	class Image;
 	class Font;
 	class Shader;
 	class SoundBuffer;
@@ -26,6 +27,7 @@ namespace Textures
 		EnemyBase,
 		LiberatorsBase,
 		ResistanceBase,
+		Atlas,
 	};
 }
 
@@ -85,6 +87,7 @@ template<typename Resource, typename Identifier>
 class ResourceHolder;
 
 typedef ResourceHolder<sf::Texture, Textures::ID> TextureHolder;
+typedef ResourceHolder<sf::Image, Textures::ID> ImageHolder;
 typedef ResourceHolder<sf::Font, Fonts::ID> FontHolder;
 typedef ResourceHolder<sf::Shader, Shaders::ID>	ShaderHolder;
 typedef ResourceHolder<sf::SoundBuffer, SoundEffect::ID> SoundBufferHolder; //none for music, as music is streamed rather than loaded into RAM
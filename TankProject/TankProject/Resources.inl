@@ -25,6 +25,22 @@ void ResourceHolder<Resource, Identifier>::load(Identifier id, const std::string
 	insertResource(id, std::move(resource));
 }
 
+template<typename Resource, typename Identifier>
+void ResourceHolder<Resource, Identifier>::insert(Identifier id, std::unique_ptr<Resource> resource)
+{
+	insertResource(id, std::move(resource));
+}
+
+template<typename Resource, typename Identifier>
+void ResourceHolder<Resource, Identifier>::share(Identifier id, Identifier existing)
+{
+	auto found = mResourceMap.find(existing);
+	assert(found != mResourceMap.end());
+
+	auto inserted = mResourceMap.insert(std::make_pair(id, found->second));
+	assert(inserted.second);
+}
+
 template<typename Resource, typename Identifier>
 Resource& ResourceHolder<Resource, Identifier>::get(Identifier id)
 {
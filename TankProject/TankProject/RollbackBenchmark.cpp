@@ -0,0 +1,133 @@
+#include "RollbackBenchmark.hpp"
+#include "RollbackSession.hpp"
+#include "World.hpp"
+#include "Player.hpp"
+#include "SoundPlayer.hpp"
+#include "NetworkProtocol.hpp"
+
+#include <SFML/Graphics/RenderTexture.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+
+namespace
+{
+	const sf::Time FrameTime = sf::seconds(1.f / ClientTickRate);
+
+	// Frames played with every input on time first, so the world fills with projectiles
+	const sf::Uint32 WarmUpFrames = 120;
+
+	const sf::Int32 LocalIdentifier = 1;
+	const sf::Int32 RemoteIdentifier = 2;
+
+	sf::Uint8 mask(PlayerAction::Type action)
+	{
+		return static_cast<sf::Uint8>(1 << action);
+	}
+
+	// Keeps firing while sweeping its turret back and forth
+	sf::Uint8 getLocalActions(sf::Uint32 frame)
+	{
+		PlayerAction::Type turn = (frame / 30) % 2 == 0 ? PlayerAction::RotateTurretLeft : PlayerAction::RotateTurretRight;
+		return static_cast<sf::Uint8>(mask(PlayerAction::Fire) | mask(turn));
+	}
+}
+
+int runRollbackBenchmark(unsigned int rollbacks, unsigned int extraTanks)
+{
+	extraTanks = std::min<unsigned int>(extraTanks, WorldSnapshot::MaxTanks - 2);
+
+	// Same size as the game window; nothing is ever drawn into it
+	sf::RenderTexture target;
+	if (!target.create(1024, 768))
+	{
+		std::cout << "Rollback: cannot create a render target" << std::endl;
+		return 1;
+	}
+
+	FontHolder fonts;
+	fonts.load(Fonts::Main, "Media/WorldConflict.ttf");
+	SoundPlayer sounds;
+
+	World world(target, fonts, sounds, true);
+
+	Tank* localTank = world.addTank(LocalIdentifier, Tank::Hotchkiss);
+	localTank->setPosition(700.f, 750.f);
+	Tank* remoteTank = world.addTank(RemoteIdentifier, Tank::Panzer);
+	remoteTank->setPosition(1100.f, 750.f);
+	remoteTank->setRotation(180.f);
+
+	for (unsigned int i = 0; i < extraTanks; ++i)
+	{
+		Tank* tank = world.addTank(RemoteIdentifier + 1 + static_cast<sf::Int32>(i), i % 2 == 0 ? Tank::T34 : Tank::Panther);
+		tank->setPosition(300.f + 300.f * (i % 8), 300.f + 900.f * (i / 8));
+	}
+
+	Player localPlayer(nullptr, LocalIdentifier, nullptr);
+	Player remotePlayer(nullptr, RemoteIdentifier, nullptr);
+
+	RollbackSession session(world, FrameTime);
+	session.start(LocalIdentifier, localPlayer, RemoteIdentifier, remotePlayer);
+
+	// The remote player alternates between two inputs, each differing from the guess made from the other
+	const sf::Uint8 remoteInputs[2] =
+	{
+		static_cast<sf::Uint8>(mask(PlayerAction::Fire) | mask(PlayerAction::RotateLeft)),
+		static_cast<sf::Uint8>(mask(PlayerAction::Fire) | mask(PlayerAction::RotateRight)),
+	};
+
+	sf::Uint32 confirmed = 0;
+	for (; confirmed < WarmUpFrames; ++confirmed)
+	{
+		session.addRemoteInput(confirmed, remoteInputs[0]);
+		session.advance(getLocalActions(confirmed));
+	}
+
+	std::unique_ptr<WorldSnapshot> population(new WorldSnapshot());
+	world.saveSnapshot(*population);
+
+	std::vector<sf::Time> times;
+	times.reserve(rollbacks);
+
+	for (unsigned int i = 0; i < rollbacks; ++i)
+	{
+		// Run ahead as far as the session allows, then let the remote inputs of all those frames arrive
+		while (session.canAdvance())
+			session.advance(getLocalActions(session.getCurrentFrame()));
+
+		sf::Uint8 remoteActions = remoteInputs[(i + 1) % 2];
+		for (; confirmed < session.getCurrentFrame(); ++confirmed)
+			session.addRemoteInput(confirmed, remoteActions);
+
+		session.advance(getLocalActions(session.getCurrentFrame()));
+
+		if (session.getLastRollbackDepth() != RollbackSession::MaxRollbackFrames)
+		{
+			std::cout << "Rollback: expected a rollback of " << RollbackSession::MaxRollbackFrames << " frames, got "
+				<< session.getLastRollbackDepth() << std::endl;
+			return 1;
+		}
+
+		times.push_back(session.getLastRollbackTime());
+	}
+
+	if (times.empty())
+		return 0;
+
+	std::sort(times.begin(), times.end());
+	sf::Time total = sf::Time::Zero;
+	for (std::size_t i = 0; i < times.size(); ++i)
+		total += times[i];
+
+	std::cout << "Rollback: world of " << population->tankCount << " tanks, " << population->projectileCount << " projectiles, "
+		<< population->pickupCount << " pickups" << std::endl;
+	std::cout << "Rollback: " << times.size() << " rollbacks of " << RollbackSession::MaxRollbackFrames << " frames, mean "
+		<< (total / static_cast<float>(times.size())).asMicroseconds() << "us, median " << times[times.size() / 2].asMicroseconds()
+		<< "us, best " << times.front().asMicroseconds() << "us, worst " << times.back().asMicroseconds() << "us" << std::endl;
+	std::cout << "Rollback: frame budget " << FrameTime.asMicroseconds() << "us" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+
+// Runs a rollback match between two scripted players in a World populated with extraTanks idle
+// tanks, and makes every remote input arrive MaxRollbackFrames late and different from its guess, so
+// each one costs a full restore and resimulation. Reports how long those took against the frame
+// budget. Inputs and the random seed are fixed, so runs are comparable. Needs the game's Media folder.
+// Returns the process exit code.
+int runRollbackBenchmark(unsigned int rollbacks, unsigned int extraTanks);
@@ -0,0 +1,211 @@
+#include "RollbackSession.hpp"
+#include "World.hpp"
+#include "Player.hpp"
+#include "Utility.hpp"
+
+#include <SFML/System/Clock.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+
+RollbackSession::FrameInput::FrameInput()
+	: frame(0)
+	, localActions(0)
+	, remoteActions(0)
+	, remoteConfirmed(false)
+{
+}
+
+RollbackSession::RollbackSession(World& world, sf::Time frameTime)
+	: mWorld(world)
+	, mFrameTime(frameTime)
+	, mRunning(false)
+	, mLocalPlayer(nullptr)
+	, mRemotePlayer(nullptr)
+	, mLocalIdentifier(0)
+	, mRemoteIdentifier(0)
+	, mFrame(0)
+	, mConfirmedFrames(0)
+	, mLastRemoteActions(0)
+	, mRollbackPending(false)
+	, mRollbackFrame(0)
+	, mInputs()
+	, mSnapshots(SnapshotCount)
+	, mLastRollbackDepth(0)
+	, mLastRollbackTime(sf::Time::Zero)
+	, mWorstSaveTime(sf::Time::Zero)
+	, mWorstResimulationTimes()
+{
+	// All snapshot memory is allocated here, saving into it later only copies
+}
+
+void RollbackSession::start(sf::Int32 localIdentifier, Player& localPlayer, sf::Int32 remoteIdentifier, Player& remotePlayer)
+{
+	mLocalIdentifier = localIdentifier;
+	mLocalPlayer = &localPlayer;
+	mRemoteIdentifier = remoteIdentifier;
+	mRemotePlayer = &remotePlayer;
+
+	// Both peers derive the same seed from the same pair of tanks
+	sf::Int32 first = std::min(localIdentifier, remoteIdentifier);
+	sf::Int32 second = std::max(localIdentifier, remoteIdentifier);
+	randomEngine().seed(static_cast<unsigned int>(first * 7919 + second));
+
+	mRunning = true;
+	std::cout << "Rollback: session started between tanks " << first << " and " << second << std::endl;
+}
+
+void RollbackSession::stop()
+{
+	mRunning = false;
+	mLocalPlayer = nullptr;
+	mRemotePlayer = nullptr;
+}
+
+bool RollbackSession::isRunning() const
+{
+	return mRunning;
+}
+
+sf::Int32 RollbackSession::getRemoteIdentifier() const
+{
+	return mRemoteIdentifier;
+}
+
+void RollbackSession::addRemoteInput(sf::Uint32 frame, sf::Uint8 actions)
+{
+	// Inputs come in order over TCP; anything else is a duplicate
+	if (frame != mConfirmedFrames)
+		return;
+
+	FrameInput& remote = input(frame);
+	if (remote.frame != frame)
+	{
+		remote = FrameInput();
+		remote.frame = frame;
+	}
+
+	// Already simulated with a guess: if the guess was wrong, that frame has to be redone
+	if (frame < mFrame && remote.remoteActions != actions)
+	{
+		mRollbackFrame = mRollbackPending ? std::min(mRollbackFrame, frame) : frame;
+		mRollbackPending = true;
+	}
+
+	remote.remoteActions = actions;
+	remote.remoteConfirmed = true;
+	mLastRemoteActions = actions;
+	++mConfirmedFrames;
+}
+
+bool RollbackSession::canAdvance() const
+{
+	return mRunning && mFrame < mConfirmedFrames + MaxRollbackFrames;
+}
+
+sf::Uint32 RollbackSession::getCurrentFrame() const
+{
+	return mFrame;
+}
+
+bool RollbackSession::advance(sf::Uint8 localActions)
+{
+	if (!mRunning)
+		return false;
+
+	if (mRollbackPending)
+		rollback();
+
+	if (!canAdvance())
+		return false;
+
+	FrameInput& current = input(mFrame);
+	if (current.frame != mFrame)
+	{
+		current = FrameInput();
+		current.frame = mFrame;
+	}
+
+	current.localActions = localActions;
+	if (!current.remoteConfirmed)
+		current.remoteActions = mLastRemoteActions;
+
+	simulateFrame(mFrame);
+	++mFrame;
+	return true;
+}
+
+sf::Uint32 RollbackSession::getLastRollbackDepth() const
+{
+	return mLastRollbackDepth;
+}
+
+sf::Time RollbackSession::getLastRollbackTime() const
+{
+	return mLastRollbackTime;
+}
+
+RollbackSession::FrameInput& RollbackSession::input(sf::Uint32 frame)
+{
+	return mInputs[frame % InputCapacity];
+}
+
+void RollbackSession::simulateFrame(sf::Uint32 frame)
+{
+	sf::Clock saveClock;
+	mWorld.saveSnapshot(mSnapshots[frame % SnapshotCount]);
+	sf::Time saveTime = saveClock.getElapsedTime();
+
+	if (saveTime > mWorstSaveTime)
+	{
+		mWorstSaveTime = saveTime;
+		std::cout << "Rollback: snapshot took " << saveTime.asMicroseconds() << "us" << std::endl;
+	}
+
+	// Same order on both peers, lowest identifier first
+	const FrameInput& current = input(frame);
+	CommandQueue& commands = mWorld.getCommandQueue();
+	if (mLocalIdentifier < mRemoteIdentifier)
+	{
+		mLocalPlayer->applyActionMask(current.localActions, commands);
+		mRemotePlayer->applyActionMask(current.remoteActions, commands);
+	}
+	else
+	{
+		mRemotePlayer->applyActionMask(current.remoteActions, commands);
+		mLocalPlayer->applyActionMask(current.localActions, commands);
+	}
+
+	mWorld.update(mFrameTime);
+}
+
+void RollbackSession::rollback()
+{
+	mRollbackPending = false;
+	sf::Uint32 depth = mFrame - mRollbackFrame;
+
+	sf::Clock clock;
+	mWorld.restoreSnapshot(mSnapshots[mRollbackFrame % SnapshotCount]);
+
+	for (sf::Uint32 frame = mRollbackFrame; frame < mFrame; ++frame)
+	{
+		// Frames after the corrected one are still guesses, based on the newest real input
+		FrameInput& replayed = input(frame);
+		if (!replayed.remoteConfirmed)
+			replayed.remoteActions = mLastRemoteActions;
+
+		simulateFrame(frame);
+	}
+
+	sf::Time elapsed = clock.getElapsedTime();
+	mLastRollbackDepth = depth;
+	mLastRollbackTime = elapsed;
+
+	if (depth < mWorstResimulationTimes.size() && elapsed > mWorstResimulationTimes[depth])
+	{
+		mWorstResimulationTimes[depth] = elapsed;
+		std::cout << "Rollback: restored and resimulated " << depth << " frames in " << elapsed.asMicroseconds()
+			<< "us (frame budget " << mFrameTime.asMicroseconds() << "us)" << std::endl;
+	}
+}
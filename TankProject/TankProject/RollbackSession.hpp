@@ -0,0 +1,93 @@
+#pragma once
+
+#include "WorldSnapshot.hpp"
+
+#include <SFML/System/Time.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/Config.hpp>
+
+#include <array>
+#include <vector>
+
+
+class World;
+class Player;
+
+// Drives a two player World frame by frame, exchanging only inputs. The remote player's input is
+// predicted (it keeps doing what it last did); when the real input arrives and differs, the world
+// is restored to the snapshot of that frame and every frame since is simulated again.
+// Both peers apply inputs in identifier order, so they compute the same frames.
+class RollbackSession : private sf::NonCopyable
+{
+public:
+	static const sf::Uint32		MaxRollbackFrames = 8;
+	static const std::size_t	SnapshotCount = MaxRollbackFrames + 2;
+	static const std::size_t	InputCapacity = 32;
+
+
+public:
+	explicit					RollbackSession(World& world, sf::Time frameTime);
+
+	void						start(sf::Int32 localIdentifier, Player& localPlayer, sf::Int32 remoteIdentifier, Player& remotePlayer);
+	void						stop();
+	bool						isRunning() const;
+	sf::Int32					getRemoteIdentifier() const;
+
+	// Inputs may arrive before start(), they are kept until their frame is simulated
+	void						addRemoteInput(sf::Uint32 frame, sf::Uint8 actions);
+
+	// Simulates the next frame with the given local input. Returns false, without simulating,
+	// while the remote peer is MaxRollbackFrames behind. Call getCurrentFrame() first to number the input.
+	bool						canAdvance() const;
+	sf::Uint32					getCurrentFrame() const;
+	bool						advance(sf::Uint8 localActions);
+
+	// Depth in frames and cost (restore plus resimulation) of the newest rollback, 0 frames for none yet
+	sf::Uint32					getLastRollbackDepth() const;
+	sf::Time					getLastRollbackTime() const;
+
+
+private:
+	struct FrameInput
+	{
+		FrameInput();
+
+		sf::Uint32				frame;
+		sf::Uint8				localActions;
+		sf::Uint8				remoteActions;
+		bool					remoteConfirmed;
+	};
+
+
+private:
+	FrameInput&					input(sf::Uint32 frame);
+	void						simulateFrame(sf::Uint32 frame);
+	void						rollback();
+
+
+private:
+	World&									mWorld;
+	sf::Time								mFrameTime;
+	bool									mRunning;
+
+	Player*									mLocalPlayer;
+	Player*									mRemotePlayer;
+	sf::Int32								mLocalIdentifier;
+	sf::Int32								mRemoteIdentifier;
+
+	sf::Uint32								mFrame;
+	sf::Uint32								mConfirmedFrames;
+	sf::Uint8								mLastRemoteActions;
+	bool									mRollbackPending;
+	sf::Uint32								mRollbackFrame;
+
+	std::array<FrameInput, InputCapacity>	mInputs;
+	std::vector<WorldSnapshot>				mSnapshots;
+
+	sf::Uint32								mLastRollbackDepth;
+	sf::Time								mLastRollbackTime;
+
+	// Worst costs seen so far, logged when exceeded; index is the rollback depth in frames
+	sf::Time								mWorstSaveTime;
+	std::array<sf::Time, MaxRollbackFrames + 1>	mWorstResimulationTimes;
+};
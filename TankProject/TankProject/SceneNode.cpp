@@ -1,5 +1,6 @@
 #include "SceneNode.hpp"
 #include "Command.hpp"
+#include "SpriteBatch.hpp"
 #include "Foreach.hpp"
 #include "Utility.hpp"
 
@@ -12,11 +13,20 @@
 #include <cmath>
 
 
+namespace
+{
+	// Debug outlines of every node's bounding rectangle
+	const bool DrawBoundingRects = false;
+}
+
 SceneNode::SceneNode(Category::Type category)
 	: mChildren()
 	, mParent(nullptr)
 	, mDefaultCategory(category),
 	mRadius(mRadius)
+	, mSubtreeBounds()
+	, mBoundsDirty(true)
+	, mStaticArea()
 {
 }
 
@@ -24,6 +34,7 @@ void SceneNode::attachChild(Ptr child)
 {
 	child->mParent = this;
 	mChildren.push_back(std::move(child));
+	markBoundsDirty();
 }
 
 SceneNode::Ptr SceneNode::detachChild(const SceneNode& node)
@@ -34,6 +45,7 @@ SceneNode::Ptr SceneNode::detachChild(const SceneNode& node)
 	Ptr result = std::move(*found);
 	result->mParent = nullptr;
 	mChildren.erase(found);
+	markBoundsDirty();
 	return result;
 }
 
@@ -43,6 +55,91 @@ void SceneNode::update(sf::Time dt, CommandQueue& commands)
 	updateChildren(dt, commands);
 }
 
+void SceneNode::setPosition(float x, float y)
+{
+	sf::Transformable::setPosition(x, y);
+	markBoundsDirty();
+}
+
+void SceneNode::setPosition(const sf::Vector2f& position)
+{
+	sf::Transformable::setPosition(position);
+	markBoundsDirty();
+}
+
+void SceneNode::setRotation(float angle)
+{
+	sf::Transformable::setRotation(angle);
+	markBoundsDirty();
+}
+
+void SceneNode::setScale(float factorX, float factorY)
+{
+	sf::Transformable::setScale(factorX, factorY);
+	markBoundsDirty();
+}
+
+void SceneNode::setScale(const sf::Vector2f& factors)
+{
+	sf::Transformable::setScale(factors);
+	markBoundsDirty();
+}
+
+void SceneNode::setOrigin(float x, float y)
+{
+	sf::Transformable::setOrigin(x, y);
+	markBoundsDirty();
+}
+
+void SceneNode::setOrigin(const sf::Vector2f& origin)
+{
+	sf::Transformable::setOrigin(origin);
+	markBoundsDirty();
+}
+
+void SceneNode::move(float offsetX, float offsetY)
+{
+	// Entities move by their velocity every frame, which is often zero
+	if (offsetX == 0.f && offsetY == 0.f)
+		return;
+
+	sf::Transformable::move(offsetX, offsetY);
+	markBoundsDirty();
+}
+
+void SceneNode::move(const sf::Vector2f& offset)
+{
+	move(offset.x, offset.y);
+}
+
+void SceneNode::rotate(float angle)
+{
+	if (angle == 0.f)
+		return;
+
+	sf::Transformable::rotate(angle);
+	markBoundsDirty();
+}
+
+void SceneNode::scale(float factorX, float factorY)
+{
+	sf::Transformable::scale(factorX, factorY);
+	markBoundsDirty();
+}
+
+void SceneNode::scale(const sf::Vector2f& factor)
+{
+	sf::Transformable::scale(factor);
+	markBoundsDirty();
+}
+
+void SceneNode::markBoundsDirty() const
+{
+	// Stops at the first dirty node, whose ancestors are already dirty
+	for (const SceneNode* node = this; node != nullptr && !node->mBoundsDirty; node = node->mParent)
+		node->mBoundsDirty = true;
+}
+
 void SceneNode::updateCurrent(sf::Time, CommandQueue&)
 {
 	// Do nothing by default
@@ -56,15 +153,28 @@ void SceneNode::updateChildren(sf::Time dt, CommandQueue& commands)
 
 void SceneNode::draw(sf::RenderTarget& target, sf::RenderStates states) const
 {
+	if (!mParent)
+		updateSubtreeBounds();
+
+	// The part of the scene the view shows, rotation included
+	sf::FloatRect visibleArea = target.getView().getInverseTransform().transformRect(sf::FloatRect(-1.f, -1.f, 2.f, 2.f));
+	drawVisible(target, visibleArea, states);
+}
+
+void SceneNode::drawVisible(sf::RenderTarget& target, const sf::FloatRect& visibleArea, sf::RenderStates states) const
+{
+	if (!isSubtreeVisible(visibleArea, states.transform))
+		return;
+
 	// Apply transform of current node
 	states.transform *= getTransform();
 
 	// Draw node and children with changed transform
 	drawCurrent(target, states);
-	drawChildren(target, states);
+	drawChildren(target, visibleArea, states);
 
-	// Draw bounding rectangle - disabled by default
-	drawBoundingRect(target, states);
+	if (DrawBoundingRects)
+		drawBoundingRect(target, states);
 
 	//Draw bounding circle
 	//drawBoundingCirc(target, states);
@@ -75,10 +185,85 @@ void SceneNode::drawCurrent(sf::RenderTarget&, sf::RenderStates) const
 	// Do nothing by default
 }
 
-void SceneNode::drawChildren(sf::RenderTarget& target, sf::RenderStates states) const
+void SceneNode::drawChildren(sf::RenderTarget& target, const sf::FloatRect& visibleArea, sf::RenderStates states) const
+{
+	FOREACH(const Ptr& child, mChildren)
+		child->drawVisible(target, visibleArea, states);
+}
+
+void SceneNode::drawBatched(SpriteBatch& batch, const sf::FloatRect& visibleArea, sf::RenderStates states, NodeFilter filter) const
 {
+	if (!mParent)
+		updateSubtreeBounds();
+
+	if (!isSubtreeVisible(visibleArea, states.transform))
+		return;
+
+	states.transform *= getTransform();
+
+	if (filter == AllNodes || isStatic() == (filter == StaticNodes))
+		batchCurrent(batch, states);
+
 	FOREACH(const Ptr& child, mChildren)
-		child->draw(target, states);
+		child->drawBatched(batch, visibleArea, states, filter);
+
+	if (DrawBoundingRects)
+		batch.drawOutline(getBoundingRect(), sf::Color::Green);
+}
+
+void SceneNode::batchCurrent(SpriteBatch&, sf::RenderStates) const
+{
+	// Do nothing by default
+}
+
+sf::FloatRect SceneNode::getDrawBounds() const
+{
+	return sf::FloatRect();
+}
+
+void SceneNode::updateSubtreeBounds() const
+{
+	// Clean subtrees keep their bounds; they are in this node's coordinates, which did not change them
+	if (!mBoundsDirty)
+		return;
+
+	sf::FloatRect bounds = getDrawBounds();
+
+	FOREACH(const Ptr& child, mChildren)
+	{
+		child->updateSubtreeBounds();
+		bounds = unite(bounds, child->mSubtreeBounds);
+	}
+
+	mSubtreeBounds = getTransform().transformRect(bounds);
+	mBoundsDirty = false;
+}
+
+void SceneNode::collectStaticChanges(std::vector<sf::FloatRect>& changes) const
+{
+	collectStaticChanges(sf::Transform::Identity, changes);
+}
+
+void SceneNode::collectStaticChanges(const sf::Transform& parentTransform, std::vector<sf::FloatRect>& changes) const
+{
+	sf::Transform transform = parentTransform * getTransform();
+
+	sf::FloatRect area = isStatic() ? transform.transformRect(getDrawBounds()) : sf::FloatRect();
+	if (area != mStaticArea)
+	{
+		// Both where it was and where it is now
+		changes.push_back(unite(mStaticArea, area));
+		mStaticArea = area;
+	}
+
+	FOREACH(const Ptr& child, mChildren)
+		child->collectStaticChanges(transform, changes);
+}
+
+bool SceneNode::isSubtreeVisible(const sf::FloatRect& visibleArea, const sf::Transform& parentTransform) const
+{
+	// Subtrees that draw nothing have empty bounds, which intersect nothing
+	return parentTransform.transformRect(mSubtreeBounds).intersects(visibleArea);
 }
 
 void SceneNode::drawBoundingRect(sf::RenderTarget& target, sf::RenderStates) const
@@ -92,7 +277,7 @@ void SceneNode::drawBoundingRect(sf::RenderTarget& target, sf::RenderStates) con
 	shape.setOutlineColor(sf::Color::Green);
 	shape.setOutlineThickness(1.f);
 
-	//target.draw(shape);
+	target.draw(shape);
 }
 
 void SceneNode::drawBoundingCirc(sf::RenderTarget& target, sf::RenderStates, float mRadius) const
@@ -159,12 +344,25 @@ void SceneNode::removeWrecks()
 {
 	// Remove all children which request so
 	auto wreckfieldBegin = std::remove_if(mChildren.begin(), mChildren.end(), std::mem_fn(&SceneNode::isMarkedForRemoval));
-	mChildren.erase(wreckfieldBegin, mChildren.end());
+	if (wreckfieldBegin != mChildren.end())
+	{
+		mChildren.erase(wreckfieldBegin, mChildren.end());
+		markBoundsDirty();
+	}
 
 	// Call function recursively for all remaining children
 	std::for_each(mChildren.begin(), mChildren.end(), std::mem_fn(&SceneNode::removeWrecks));
 }
 
+void SceneNode::collectChildren(unsigned int category, std::vector<SceneNode*>& out) const
+{
+	FOREACH(const Ptr& child, mChildren)
+	{
+		if (child->getCategory() & category)
+			out.push_back(child.get());
+	}
+}
+
 sf::FloatRect SceneNode::getBoundingRect() const
 {
 	return sf::FloatRect();
@@ -176,6 +374,11 @@ bool SceneNode::isMarkedForRemoval() const
 	return isDestroyed();
 }
 
+bool SceneNode::isStatic() const
+{
+	return false;
+}
+
 bool SceneNode::isDestroyed() const
 {
 	// By default, scene node needn't be removed
@@ -15,6 +15,7 @@
 
 struct Command;
 class CommandQueue;
+class SpriteBatch;
 
 class SceneNode : public sf::Transformable, public sf::Drawable, private sf::NonCopyable
 {
@@ -22,6 +23,14 @@ public:
 	typedef std::unique_ptr<SceneNode> Ptr;
 	typedef std::pair<SceneNode*, SceneNode*> Pair;
 
+	// Which nodes a batched draw includes
+	enum NodeFilter
+	{
+		AllNodes,
+		StaticNodes,
+		DynamicNodes,
+	};
+
 
 public:
 	explicit				SceneNode(Category::Type category = Category::None);
@@ -31,6 +40,27 @@ public:
 
 	void					update(sf::Time dt, CommandQueue& commands);
 
+	// sf::Transformable's setters, hidden so that every transform change marks the cached bounds dirty
+	void					setPosition(float x, float y);
+	void					setPosition(const sf::Vector2f& position);
+	void					setRotation(float angle);
+	void					setScale(float factorX, float factorY);
+	void					setScale(const sf::Vector2f& factors);
+	void					setOrigin(float x, float y);
+	void					setOrigin(const sf::Vector2f& origin);
+	void					move(float offsetX, float offsetY);
+	void					move(const sf::Vector2f& offset);
+	void					rotate(float angle);
+	void					scale(float factorX, float factorY);
+	void					scale(const sf::Vector2f& factor);
+
+	// Same as drawing the node, but collected into a batch instead of drawn straight away. Subtrees
+	// entirely outside visibleArea (in the coordinates of states.transform) are skipped.
+	void					drawBatched(SpriteBatch& batch, const sf::FloatRect& visibleArea, sf::RenderStates states, NodeFilter filter = AllNodes) const;
+
+	// Adds the area of every static node that appeared, changed or stopped being static since the last call
+	void					collectStaticChanges(std::vector<sf::FloatRect>& changes) const;
+
 	sf::Vector2f			getWorldPosition() const;
 	sf::Transform			getWorldTransform() const;
 
@@ -40,20 +70,41 @@ public:
 	void					checkSceneCollision(SceneNode& sceneGraph, std::set<Pair>& collisionPairs);
 	void					checkNodeCollision(SceneNode& node, std::set<Pair>& collisionPairs);
 	void					removeWrecks();
+	void					collectChildren(unsigned int category, std::vector<SceneNode*>& out) const;
 	virtual sf::FloatRect	getBoundingRect() const;
 	virtual bool			isMarkedForRemoval() const;
 	virtual bool			isDestroyed() const;
+
+	// Static nodes draw the same every frame, so they can be drawn once into a cache. A node must stop
+	// being static before it is removed.
+	virtual bool			isStatic() const;
 	void					SceneNode::drawBoundingCirc(sf::RenderTarget& target, sf::RenderStates, float mRadius) const;
 
 
+protected:
+	// Nodes call this when what getDrawBounds() returns changes without their transform changing
+	void					markBoundsDirty() const;
+
+
 private:
 	virtual void			updateCurrent(sf::Time dt, CommandQueue& commands);
 	void					updateChildren(sf::Time dt, CommandQueue& commands);
 
 	virtual void			draw(sf::RenderTarget& target, sf::RenderStates states) const;
+	void					drawVisible(sf::RenderTarget& target, const sf::FloatRect& visibleArea, sf::RenderStates states) const;
 	virtual void			drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const;
-	void					drawChildren(sf::RenderTarget& target, sf::RenderStates states) const;
+	void					drawChildren(sf::RenderTarget& target, const sf::FloatRect& visibleArea, sf::RenderStates states) const;
 	void					drawBoundingRect(sf::RenderTarget& target, sf::RenderStates states) const;
+
+	// Nodes that draw something override these alongside drawCurrent. The draw bounds are the area
+	// drawCurrent covers in the node's own coordinates, and are used to cull it; empty by default.
+	virtual void			batchCurrent(SpriteBatch& batch, sf::RenderStates states) const;
+	virtual sf::FloatRect	getDrawBounds() const;
+
+	// Recomputes the cached area of every dirty subtree; the root does this before each culled draw
+	void					updateSubtreeBounds() const;
+	bool					isSubtreeVisible(const sf::FloatRect& visibleArea, const sf::Transform& parentTransform) const;
+	void					collectStaticChanges(const sf::Transform& parentTransform, std::vector<sf::FloatRect>& changes) const;
 	
 
 
@@ -62,6 +113,9 @@ private:
 	SceneNode*				mParent;
 	Category::Type			mDefaultCategory;
 	float					mRadius;
+	mutable sf::FloatRect	mSubtreeBounds;		// in the parent's coordinates
+	mutable bool			mBoundsDirty;		// a dirty node's ancestors are all dirty too
+	mutable sf::FloatRect	mStaticArea;		// in world coordinates, as last reported; empty unless static
 };
 
 bool	collision(const SceneNode& lhs, const SceneNode& rhs);
@@ -0,0 +1,306 @@
+#include "SchemaCheck.hpp"
+#include "NetworkMessages.hpp"
+#include "Compression.hpp"
+#include "Foreach.hpp"
+
+#include <SFML/Network/Packet.hpp>
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+	// Fixed, so a failure can be reproduced
+	const unsigned int RandomSeed = 20170419;
+
+	const std::size_t MutatedInputs = 2000;
+	const std::size_t RandomInputs = 2000;
+	const std::size_t MaxRandomSize = 256;
+	const int MaxMutatedBytes = 4;
+
+	struct Report
+	{
+		Report()
+			: inputs(0), failures(0)
+		{
+		}
+
+		void fail(const std::string& name, const std::string& what)
+		{
+			++failures;
+			std::cout << "Schema: " << name << ": " << what << std::endl;
+		}
+
+		std::size_t		inputs;
+		std::size_t		failures;
+	};
+
+	template <typename Message>
+	std::vector<char> encodeBytes(const Message& message)
+	{
+		std::vector<char> bytes;
+		Schema::encode(bytes, message);
+		return bytes;
+	}
+
+	sf::Packet makeRawPacket(const std::vector<char>& bytes, std::size_t size)
+	{
+		sf::Packet packet;
+		if (size > 0)
+			packet.append(bytes.data(), size);
+
+		return packet;
+	}
+
+	// Whatever the bytes, both decoders must stay inside them; what they accept re-encodes to no more
+	// than was there, so no count in it was taken on trust. Returns whether the bytes were accepted.
+	template <typename Message>
+	bool checkDecode(const std::string& name, const std::vector<char>& bytes, std::size_t size, Report& report)
+	{
+		++report.inputs;
+
+		Message message;
+		Schema::ByteReader reader(bytes.data(), size);
+		reader & message;
+
+		if (reader.getPosition() > size)
+			report.fail(name, "byte reader read past the end of " + std::to_string(size) + " bytes");
+		if (reader.isValid() && Schema::encodedSize(message) != reader.getPosition())
+			report.fail(name, "byte reader decoded more than it read from " + std::to_string(size) + " bytes");
+
+		Message fromPacket;
+		sf::Packet packet = makeRawPacket(bytes, size);
+		if (Schema::decode(packet, fromPacket) && Schema::encodedSize(fromPacket) > size)
+			report.fail(name, "packet reader decoded more than " + std::to_string(size) + " bytes");
+
+		return reader.isValid();
+	}
+
+	template <typename Message>
+	void checkMessage(const std::string& name, const Message& sample, std::mt19937& random, Report& report)
+	{
+		std::vector<char> bytes = encodeBytes(sample);
+
+		// Both decoders give back what was sent
+		Message decoded;
+		if (!Schema::decode(bytes.data(), bytes.size(), decoded))
+			report.fail(name, "byte reader rejected a valid message");
+		else if (encodeBytes(decoded) != bytes)
+			report.fail(name, "byte reader round trip changed the message");
+
+		sf::Packet packet;
+		Schema::encode(packet, sample);
+		Message fromPacket;
+		if (!Schema::decode(packet, fromPacket))
+			report.fail(name, "packet reader rejected a valid message");
+		else if (encodeBytes(fromPacket) != bytes)
+			report.fail(name, "packet round trip changed the message");
+
+		// Every field is required, so every strict prefix is short of something
+		for (std::size_t size = 0; size < bytes.size(); ++size)
+		{
+			if (checkDecode<Message>(name, bytes, size, report))
+				report.fail(name, "byte reader accepted the first " + std::to_string(size) + " of " + std::to_string(bytes.size()) + " bytes");
+
+			Message truncated;
+			sf::Packet truncatedPacket = makeRawPacket(bytes, size);
+			if (Schema::decode(truncatedPacket, truncated))
+				report.fail(name, "packet reader accepted the first " + std::to_string(size) + " of " + std::to_string(bytes.size()) + " bytes");
+		}
+
+		// A few bytes changed reach the counts and lengths deep inside the message
+		std::uniform_int_distribution<int> byteValue(0, 255);
+		std::uniform_int_distribution<int> mutatedBytes(1, MaxMutatedBytes);
+		for (std::size_t i = 0; i < MutatedInputs && !bytes.empty(); ++i)
+		{
+			std::vector<char> mutated = bytes;
+			std::uniform_int_distribution<std::size_t> position(0, mutated.size() - 1);
+			for (int count = mutatedBytes(random); count > 0; --count)
+				mutated[position(random)] = static_cast<char>(byteValue(random));
+
+			checkDecode<Message>(name, mutated, mutated.size(), report);
+		}
+
+		std::uniform_int_distribution<std::size_t> randomSize(0, MaxRandomSize);
+		for (std::size_t i = 0; i < RandomInputs; ++i)
+		{
+			std::vector<char> garbage(randomSize(random));
+			FOREACH(char& byte, garbage)
+				byte = static_cast<char>(byteValue(random));
+
+			checkDecode<Message>(name, garbage, garbage.size(), report);
+		}
+
+		std::cout << "Schema: " << name << " (" << bytes.size() << " bytes) checked" << std::endl;
+	}
+
+	void checkDecompression(std::mt19937& random, Report& report)
+	{
+		InitialStateMessage message;
+		for (sf::Int32 identifier = 1; identifier <= 24; ++identifier)
+		{
+			InitialStateMessage::Tank tank;
+			tank.spawn.identifier = identifier;
+			tank.spawn.x = 100.f + 32.f * identifier;
+			tank.spawn.y = 600.f;
+			tank.hitpoints = 100;
+			tank.missileAmmo = 20;
+			message.tanks.push_back(tank);
+		}
+
+		std::vector<char> bytes = encodeBytes(message);
+
+		std::vector<char> compressed;
+		compressBlock(bytes.data(), bytes.size(), compressed);
+
+		std::vector<char> output;
+		if (!decompressBlock(compressed.data(), compressed.size(), bytes.size(), output) || output != bytes)
+			report.fail("decompressBlock", "round trip changed the block");
+		if (decompressBlock(compressed.data(), compressed.size(), bytes.size() + 1, output))
+			report.fail("decompressBlock", "accepted the wrong uncompressed size");
+		if (decompressBlock(compressed.data(), compressed.size(), MaxBlockSize + 1, output))
+			report.fail("decompressBlock", "accepted a block larger than MaxBlockSize");
+
+		// The empty last sequence after a final match is the only byte a block can do without
+		for (std::size_t size = 0; size < compressed.size(); ++size)
+		{
+			++report.inputs;
+			if (decompressBlock(compressed.data(), size, bytes.size(), output) && output != bytes)
+				report.fail("decompressBlock", "the first " + std::to_string(size) + " of " + std::to_string(compressed.size()) + " bytes decompressed to something else");
+		}
+
+		// Damaged blocks may decompress to something, but never to anything but the size asked for
+		std::uniform_int_distribution<int> byteValue(0, 255);
+		std::uniform_int_distribution<int> mutatedBytes(1, MaxMutatedBytes);
+		std::uniform_int_distribution<std::size_t> position(0, compressed.size() - 1);
+		for (std::size_t i = 0; i < MutatedInputs; ++i)
+		{
+			++report.inputs;
+			std::vector<char> mutated = compressed;
+			for (int count = mutatedBytes(random); count > 0; --count)
+				mutated[position(random)] = static_cast<char>(byteValue(random));
+
+			if (decompressBlock(mutated.data(), mutated.size(), bytes.size(), output) && output.size() != bytes.size())
+				report.fail("decompressBlock", "damaged block decompressed to the wrong size");
+		}
+
+		std::cout << "Schema: decompressBlock (" << compressed.size() << " bytes) checked" << std::endl;
+	}
+}
+
+int runSchemaCheck()
+{
+	std::mt19937 random(RandomSeed);
+	Report report;
+
+	TankSpawnInfo spawn;
+	spawn.identifier = 3;
+	spawn.isLiberator = true;
+	spawn.x = 412.5f;
+	spawn.y = 1980.f;
+	spawn.rotation = 90.f;
+	spawn.turretRotation = 135.f;
+
+	InitialStateMessage initialState;
+	for (sf::Int32 i = 0; i < 3; ++i)
+	{
+		InitialStateMessage::Tank tank;
+		tank.spawn = spawn;
+		tank.spawn.identifier = spawn.identifier + i;
+		tank.hitpoints = 100 - 10 * i;
+		tank.missileAmmo = 20;
+		initialState.tanks.push_back(tank);
+	}
+	checkMessage("InitialState", initialState, random, report);
+
+	std::vector<char> initialStateBytes = encodeBytes(initialState);
+	std::vector<char> compressed;
+	compressBlock(initialStateBytes.data(), initialStateBytes.size(), compressed);
+
+	InitialStateChunkMessage chunk;
+	chunk.uncompressedSize = static_cast<sf::Uint32>(initialStateBytes.size());
+	chunk.isLast = true;
+	chunk.data.assign(compressed.begin(), compressed.end());
+	checkMessage("InitialStateChunk", chunk, random, report);
+
+	UpdateClientStateMessage update;
+	update.serverTick = 1234;
+	update.battlefieldTop = 1500.f;
+	for (sf::Int32 identifier = 1; identifier <= 4; ++identifier)
+	{
+		UpdateClientStateMessage::Tank tank;
+		tank.identifier = identifier;
+		tank.x = 64.f * identifier;
+		tank.y = 1800.f - identifier;
+		tank.rotation = 10.f * identifier;
+		tank.turretRotation = 45.f;
+		tank.lastInputSequence = 5000 + identifier;
+		update.tanks.push_back(tank);
+	}
+	checkMessage("UpdateClientState", update, random, report);
+
+	InputFramesMessage inputFrames;
+	inputFrames.serverTick = 1234;
+	for (sf::Int32 identifier = 1; identifier <= 2; ++identifier)
+	{
+		TankInputFrames frames;
+		frames.identifier = identifier;
+		frames.newestSequence = 700 + identifier;
+		frames.actions.assign(6, static_cast<sf::Uint8>(identifier));
+		inputFrames.tanks.push_back(frames);
+	}
+	checkMessage("InputFrames", inputFrames, random, report);
+
+	PositionUpdateMessage position;
+	PositionUpdateMessage::Tank positionTank;
+	positionTank.identifier = 2;
+	positionTank.inputSequence = 88;
+	positionTank.x = 300.f;
+	positionTank.y = 900.f;
+	positionTank.hitpoints = 60;
+	positionTank.missileAmmo = 4;
+	position.tanks.push_back(positionTank);
+	checkMessage("PositionUpdate", position, random, report);
+
+	InputBundleMessage bundle;
+	bundle.tick = 42;
+	for (sf::Int32 identifier = 1; identifier <= 3; ++identifier)
+	{
+		InputBundleMessage::Input input;
+		input.identifier = identifier;
+		input.actions = static_cast<sf::Uint8>(1 << identifier);
+		bundle.inputs.push_back(input);
+	}
+	checkMessage("InputBundle", bundle, random, report);
+
+	ResumeMessage resume;
+	resume.token = 0x0123456789ABCDEFull;
+	resume.knownTanks.push_back(1);
+	resume.knownTanks.push_back(2);
+	checkMessage("Resume", resume, random, report);
+
+	BroadcastTextMessage broadcast;
+	broadcast.text = "Player 2 has joined";
+	checkMessage("BroadcastMessage", broadcast, random, report);
+
+	AcceptCoopPartnerMessage coopPartner;
+	coopPartner.identifier = 4;
+	coopPartner.isLiberator = true;
+	coopPartner.x = 500.f;
+	coopPartner.y = 1900.f;
+	checkMessage("AcceptCoopPartner", coopPartner, random, report);
+
+	PongMessage pong;
+	pong.clientTime = 1000000;
+	pong.serverTime = 2500000;
+	pong.serverTick = 50;
+	checkMessage("Pong", pong, random, report);
+
+	checkDecompression(random, report);
+
+	std::cout << "Schema: " << report.inputs << " inputs, " << report.failures << " failures" << std::endl;
+	return report.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+
+// Feeds the message decoders truncated, mutated and random bytes: every strict prefix of a valid
+// message must be rejected, nothing may crash, read past its input or decode to more than the input
+// holds, and a valid message must come back unchanged. Does the same for decompressBlock.
+// Returns the process exit code.
+int runSchemaCheck();
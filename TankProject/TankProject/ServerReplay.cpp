@@ -0,0 +1,92 @@
+#include "ServerReplay.hpp"
+#include "GameServer.hpp"
+#include "PacketCapture.hpp"
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+
+#include <iostream>
+
+
+namespace
+{
+	// Same granularity as the server thread's loop
+	const sf::Time UpdateInterval = sf::milliseconds(5);
+
+	// Time left to run after the last event, so timeouts and the final ticks still happen
+	const sf::Time DrainTime = sf::seconds(1.f);
+
+	// Size of the window the game hosts its server for
+	const sf::Vector2f BattlefieldSize(1024.f, 768.f);
+}
+
+int runServerReplay(const std::string& filename, bool realTime)
+{
+	PacketLogReader reader;
+	if (!reader.open(filename))
+	{
+		std::cout << "Replay: cannot read capture " << filename << std::endl;
+		return 1;
+	}
+
+	// Seeded as the captured server was, so pickups and session tokens come out the same
+	GameServer::Settings settings;
+	settings.battlefieldSize = BattlefieldSize;
+	settings.mode = GameServer::Headless;
+	settings.seed = reader.getSeeds().pickupSeed;
+	settings.sessionSeed = reader.getSeeds().sessionSeed;
+
+	GameServer server(settings);
+
+	sf::Clock wallClock;
+	sf::Time serverTime = sf::Time::Zero;
+	sf::Time endTime = sf::Time::Zero;
+	std::size_t events = 0;
+
+	CapturedEvent event;
+	bool pending = reader.next(event);
+
+	while (pending || serverTime < endTime)
+	{
+		sf::Time nextTime = serverTime + UpdateInterval;
+
+		// Everything that arrived up to the next update goes in before it
+		while (pending && sf::microseconds(event.time) <= nextTime)
+		{
+			if (event.kind == CapturedEvent::Connection)
+			{
+				server.injectConnection(event.connection);
+			}
+			else
+			{
+				sf::Packet packet;
+				if (!event.data.empty())
+					packet.append(event.data.data(), event.data.size());
+
+				server.injectPacket(event.connection, packet);
+			}
+
+			++events;
+			endTime = sf::microseconds(event.time) + DrainTime;
+			pending = reader.next(event);
+		}
+
+		if (realTime && wallClock.getElapsedTime() < nextTime)
+			sf::sleep(nextTime - wallClock.getElapsedTime());
+
+		server.advance(nextTime - serverTime);
+		serverTime = nextTime;
+	}
+
+	const GameServer::Statistics& statistics = server.getStatistics();
+	sf::Time wallTime = wallClock.getElapsedTime();
+	sf::Int64 averageTick = statistics.ticks > 0 ? statistics.totalTickTime.asMicroseconds() / static_cast<sf::Int64>(statistics.ticks) : 0;
+
+	std::cout << "Replay: " << events << " events over " << serverTime.asSeconds() << "s of server time, "
+		<< wallTime.asSeconds() << "s of wall time" << (realTime ? " (1x)" : " (as fast as possible)") << std::endl;
+	std::cout << "Replay: " << statistics.ticks << " ticks, average " << averageTick << "us, worst "
+		<< statistics.worstTickTime.asMicroseconds() << "us" << std::endl;
+	std::cout << "Replay: " << statistics.outboundPackets << " packets, " << statistics.outboundBytes << " bytes sent" << std::endl;
+
+	return 0;
+}
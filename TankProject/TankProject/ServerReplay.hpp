@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+
+// Feeds a capture recorded by GameServer (see servercapture.txt) into a headless GameServer and
+// reports how long its ticks took and how much it sent. In real time mode the packets arrive with
+// their original spacing; otherwise virtual time runs as fast as the server can keep up.
+// Returns the process exit code.
+int runServerReplay(const std::string& filename, bool realTime);
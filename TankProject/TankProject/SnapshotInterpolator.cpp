@@ -0,0 +1,264 @@
+#include "SnapshotInterpolator.hpp"
+#include "Foreach.hpp"
+#include "Utility.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+	// Upper bound on buffered snapshots per tank (1.6 seconds at 20 ticks per second)
+	const std::size_t MaxSnapshots = 32;
+
+	// Extra delay added per unit of measured jitter
+	const float JitterDelayFactor = 2.f;
+
+	// The playback clock runs at most this much faster or slower than real time while catching up
+	const float MaxTimeScale = 0.1f;
+
+	// Further than this from its target (in ticks), the playback clock jumps instead of drifting
+	const float SnapThreshold = 10.f;
+
+	// Time constant of the exponential decay of extrapolation errors
+	const sf::Time ErrorDecayTime = sf::seconds(0.15f);
+}
+
+TankSnapshot::TankSnapshot()
+	: tick(0)
+	, position()
+	, rotation(0.f)
+	, turretRotation(0.f)
+{
+}
+
+SnapshotInterpolator::RemoteEntity::RemoteEntity()
+	: snapshots()
+	, positionError()
+	, rotationError(0.f)
+	, turretRotationError(0.f)
+{
+}
+
+SnapshotInterpolator::SnapshotInterpolator(sf::Time tickInterval)
+	: mTickInterval(tickInterval)
+	, mBaseDelay(tickInterval * 2.f)
+	, mJitter(sf::Time::Zero)
+	, mReceivedSnapshot(false)
+	, mNewestTick(0)
+	, mArrivalClock()
+	, mNewestArrival(sf::Time::Zero)
+	, mHasServerTickEstimate(false)
+	, mServerTickEstimate(0.f)
+	, mExtrapolationLimit(sf::seconds(0.25f))
+	, mErrorSnapThreshold(100.f)
+	, mPlaybackTick(0.f)
+	, mEntities()
+{
+}
+
+void SnapshotInterpolator::setInterpolationDelay(sf::Time delay)
+{
+	mBaseDelay = delay;
+}
+
+sf::Time SnapshotInterpolator::getInterpolationDelay() const
+{
+	return mBaseDelay + mJitter * JitterDelayFactor;
+}
+
+sf::Time SnapshotInterpolator::getJitter() const
+{
+	return mJitter;
+}
+
+void SnapshotInterpolator::setExtrapolationLimit(sf::Time limit)
+{
+	mExtrapolationLimit = limit;
+}
+
+void SnapshotInterpolator::setErrorSnapThreshold(float distance)
+{
+	mErrorSnapThreshold = distance;
+}
+
+void SnapshotInterpolator::onSnapshotReceived(sf::Uint32 serverTick)
+{
+	onSnapshotReceived(serverTick, mArrivalClock.getElapsedTime());
+}
+
+void SnapshotInterpolator::onSnapshotReceived(sf::Uint32 serverTick, sf::Time arrival)
+{
+	if (!mReceivedSnapshot)
+	{
+		mReceivedSnapshot = true;
+		mNewestTick = serverTick;
+		mNewestArrival = arrival;
+		mPlaybackTick = getTargetPlaybackTick();
+		return;
+	}
+
+	if (serverTick <= mNewestTick)
+		return;
+
+	// Jitter as in RFC 3550: smoothed deviation between the send spacing and the arrival spacing
+	sf::Time expected = mTickInterval * static_cast<float>(serverTick - mNewestTick);
+	sf::Time deviation = (arrival - mNewestArrival) - expected;
+	if (deviation < sf::Time::Zero)
+		deviation = -deviation;
+
+	mJitter += (deviation - mJitter) / 16.f;
+	mNewestTick = serverTick;
+	mNewestArrival = arrival;
+}
+
+void SnapshotInterpolator::setServerTickEstimate(float serverTick)
+{
+	mHasServerTickEstimate = true;
+	mServerTickEstimate = serverTick;
+}
+
+void SnapshotInterpolator::pushSnapshot(sf::Int32 identifier, const TankSnapshot& snapshot)
+{
+	RemoteEntity& entity = mEntities[identifier];
+	SnapshotBuffer& buffer = entity.snapshots;
+
+	// Snapshots arrive in order over TCP, but a repeated tick carries nothing new
+	if (!buffer.empty() && snapshot.tick <= buffer.back().tick)
+		return;
+
+	// If we were dead-reckoning past the newest snapshot, the new one moves the sample; remember by how much
+	bool extrapolating = !buffer.empty() && mPlaybackTick > buffer.back().tick;
+	TankSnapshot before;
+	if (extrapolating)
+		before = samplePlayback(buffer);
+
+	buffer.push_back(snapshot);
+	if (buffer.size() > MaxSnapshots)
+		buffer.pop_front();
+
+	if (extrapolating)
+	{
+		TankSnapshot after = samplePlayback(buffer);
+		entity.positionError += before.position - after.position;
+		entity.rotationError += angleDifference(before.rotation, after.rotation);
+		entity.turretRotationError += angleDifference(before.turretRotation, after.turretRotation);
+
+		// Too far off to blend believably: accept the jump
+		if (length(entity.positionError) > mErrorSnapThreshold)
+		{
+			entity.positionError = sf::Vector2f();
+			entity.rotationError = 0.f;
+			entity.turretRotationError = 0.f;
+		}
+	}
+}
+
+void SnapshotInterpolator::removeEntity(sf::Int32 identifier)
+{
+	mEntities.erase(identifier);
+}
+
+void SnapshotInterpolator::update(sf::Time dt)
+{
+	if (!mReceivedSnapshot)
+		return;
+
+	float step = dt / mTickInterval;
+	mPlaybackTick += step;
+
+	// Steer the playback clock towards its target gradually, so remote tanks never visibly speed up or stall
+	float error = getTargetPlaybackTick() - mPlaybackTick;
+	if (std::abs(error) > SnapThreshold)
+		mPlaybackTick += error;
+	else
+		mPlaybackTick += std::max(-MaxTimeScale * step, std::min(error, MaxTimeScale * step));
+
+	// Blend out extrapolation errors
+	float decay = std::exp(-dt.asSeconds() / ErrorDecayTime.asSeconds());
+	FOREACH(auto& pair, mEntities)
+	{
+		RemoteEntity& entity = pair.second;
+		entity.positionError *= decay;
+		entity.rotationError *= decay;
+		entity.turretRotationError *= decay;
+	}
+
+	pruneBuffers();
+}
+
+bool SnapshotInterpolator::sample(sf::Int32 identifier, TankSnapshot& out) const
+{
+	auto found = mEntities.find(identifier);
+	if (found == mEntities.end() || found->second.snapshots.empty())
+		return false;
+
+	const RemoteEntity& entity = found->second;
+
+	out = samplePlayback(entity.snapshots);
+	out.position += entity.positionError;
+	out.rotation += entity.rotationError;
+	out.turretRotation += entity.turretRotationError;
+	return true;
+}
+
+float SnapshotInterpolator::getTargetPlaybackTick() const
+{
+	// Prefer the synchronized server clock; otherwise extrapolate from when the newest snapshot arrived
+	if (mHasServerTickEstimate)
+		return mServerTickEstimate - getInterpolationDelay() / mTickInterval;
+
+	float sinceNewest = (mArrivalClock.getElapsedTime() - mNewestArrival) / mTickInterval;
+	return mNewestTick + sinceNewest - getInterpolationDelay() / mTickInterval;
+}
+
+TankSnapshot SnapshotInterpolator::samplePlayback(const SnapshotBuffer& buffer) const
+{
+	// Not enough history yet: hold the oldest snapshot
+	if (mPlaybackTick <= buffer.front().tick)
+		return buffer.front();
+
+	// Playback ran past the newest snapshot: dead-reckon from the last two, for a limited time
+	if (mPlaybackTick >= buffer.back().tick)
+	{
+		const TankSnapshot& newest = buffer.back();
+		if (buffer.size() < 2)
+			return newest;
+
+		const TankSnapshot& previous = buffer[buffer.size() - 2];
+		float span = static_cast<float>(newest.tick - previous.tick);
+		float ahead = std::min(mPlaybackTick - newest.tick, mExtrapolationLimit / mTickInterval);
+
+		TankSnapshot extrapolated = newest;
+		extrapolated.position += (newest.position - previous.position) / span * ahead;
+		extrapolated.rotation += angleDifference(newest.rotation, previous.rotation) / span * ahead;
+		extrapolated.turretRotation += angleDifference(newest.turretRotation, previous.turretRotation) / span * ahead;
+		return extrapolated;
+	}
+
+	std::size_t next = 1;
+	while (buffer[next].tick <= mPlaybackTick)
+		++next;
+
+	const TankSnapshot& from = buffer[next - 1];
+	const TankSnapshot& to = buffer[next];
+	float t = (mPlaybackTick - from.tick) / static_cast<float>(to.tick - from.tick);
+
+	TankSnapshot interpolated;
+	interpolated.tick = from.tick;
+	interpolated.position = from.position + (to.position - from.position) * t;
+	interpolated.rotation = from.rotation + angleDifference(to.rotation, from.rotation) * t;
+	interpolated.turretRotation = from.turretRotation + angleDifference(to.turretRotation, from.turretRotation) * t;
+	return interpolated;
+}
+
+void SnapshotInterpolator::pruneBuffers()
+{
+	// Keep the snapshot just before the playback position, it is the start of the current blend
+	FOREACH(auto& pair, mEntities)
+	{
+		SnapshotBuffer& buffer = pair.second.snapshots;
+		while (buffer.size() > 2 && buffer[1].tick <= mPlaybackTick)
+			buffer.pop_front();
+	}
+}
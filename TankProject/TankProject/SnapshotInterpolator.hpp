@@ -0,0 +1,91 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/Config.hpp>
+
+#include <deque>
+#include <map>
+
+
+// State of a remote tank as sent by the server on a given tick
+struct TankSnapshot
+{
+	TankSnapshot();
+
+	sf::Uint32				tick;
+	sf::Vector2f			position;
+	float					rotation;
+	float					turretRotation;
+};
+
+// Buffers server snapshots per remote tank and plays them back a little in the past, so there
+// are (almost) always two snapshots to blend between. The playback delay grows with the
+// measured arrival jitter of the snapshots.
+// When snapshots are late, tanks are dead-reckoned from their last known velocities for a
+// bounded time. The jump once real data arrives is kept as an error offset that decays away.
+class SnapshotInterpolator
+{
+public:
+	explicit				SnapshotInterpolator(sf::Time tickInterval);
+
+	void					setInterpolationDelay(sf::Time delay);
+	sf::Time				getInterpolationDelay() const;
+	sf::Time				getJitter() const;
+	void					setExtrapolationLimit(sf::Time limit);
+	void					setErrorSnapThreshold(float distance);
+
+	void					onSnapshotReceived(sf::Uint32 serverTick);
+	// Same, with the arrival time given instead of read from the clock, for replaying a recorded trace
+	void					onSnapshotReceived(sf::Uint32 serverTick, sf::Time arrival);
+	void					setServerTickEstimate(float serverTick);
+	void					pushSnapshot(sf::Int32 identifier, const TankSnapshot& snapshot);
+	void					removeEntity(sf::Int32 identifier);
+
+	void					update(sf::Time dt);
+	bool					sample(sf::Int32 identifier, TankSnapshot& out) const;
+
+
+private:
+	typedef std::deque<TankSnapshot> SnapshotBuffer;
+
+	struct RemoteEntity
+	{
+		RemoteEntity();
+
+		SnapshotBuffer		snapshots;
+
+		// Visual error left over from a wrong extrapolation, blended out over time
+		sf::Vector2f		positionError;
+		float				rotationError;
+		float				turretRotationError;
+	};
+
+
+private:
+	float					getTargetPlaybackTick() const;
+	TankSnapshot			samplePlayback(const SnapshotBuffer& snapshots) const;
+	void					pruneBuffers();
+
+
+private:
+	sf::Time								mTickInterval;
+	sf::Time								mBaseDelay;
+	sf::Time								mJitter;
+
+	bool									mReceivedSnapshot;
+	sf::Uint32								mNewestTick;
+	sf::Clock								mArrivalClock;
+	sf::Time								mNewestArrival;
+
+	// Newest tick that can have reached us by now, from the synchronized server clock
+	bool									mHasServerTickEstimate;
+	float									mServerTickEstimate;
+
+	sf::Time								mExtrapolationLimit;
+	float									mErrorSnapThreshold;
+
+	float									mPlaybackTick;
+	std::map<sf::Int32, RemoteEntity>		mEntities;
+};
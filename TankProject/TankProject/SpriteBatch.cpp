@@ -0,0 +1,227 @@
+#include "SpriteBatch.hpp"
+#include "Utility.hpp"
+
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+
+namespace
+{
+	sf::FloatRect getBounds(const sf::Vertex* vertices, std::size_t count)
+	{
+		sf::Vector2f min = vertices[0].position;
+		sf::Vector2f max = vertices[0].position;
+
+		for (std::size_t i = 1; i < count; ++i)
+		{
+			min.x = std::min(min.x, vertices[i].position.x);
+			min.y = std::min(min.y, vertices[i].position.y);
+			max.x = std::max(max.x, vertices[i].position.x);
+			max.y = std::max(max.y, vertices[i].position.y);
+		}
+
+		return sf::FloatRect(min, max - min);
+	}
+}
+
+SpriteBatch::SpriteBatch()
+	: mBatches()
+	, mBatchCount(0)
+	, mOverlay()
+	, mOverlayTexture(nullptr)
+	, mSpriteCount(0)
+{
+}
+
+void SpriteBatch::draw(const sf::Sprite& sprite, const sf::Transform& transform)
+{
+	const sf::Texture* texture = sprite.getTexture();
+	if (!texture)
+		return;
+
+	// Same corners and texture coordinates as sf::Sprite, moved to where the sprite would be drawn
+	sf::IntRect rect = sprite.getTextureRect();
+	float width = static_cast<float>(std::abs(rect.width));
+	float height = static_cast<float>(std::abs(rect.height));
+	float left = static_cast<float>(rect.left);
+	float right = left + rect.width;
+	float top = static_cast<float>(rect.top);
+	float bottom = top + rect.height;
+
+	sf::Transform combined = transform * sprite.getTransform();
+	sf::Color color = sprite.getColor();
+
+	sf::Vertex corners[4] =
+	{
+		sf::Vertex(combined.transformPoint(0.f, 0.f), color, sf::Vector2f(left, top)),
+		sf::Vertex(combined.transformPoint(0.f, height), color, sf::Vector2f(left, bottom)),
+		sf::Vertex(combined.transformPoint(width, 0.f), color, sf::Vector2f(right, top)),
+		sf::Vertex(combined.transformPoint(width, height), color, sf::Vector2f(right, bottom)),
+	};
+
+	sf::FloatRect bounds = combined.transformRect(sf::FloatRect(0.f, 0.f, width, height));
+
+	Batch& batch = findBatch(texture, bounds);
+
+	// The two triangles of sf::Sprite's triangle strip
+	const std::size_t order[6] = { 0, 1, 2, 2, 1, 3 };
+	for (std::size_t i = 0; i < 6; ++i)
+		batch.vertices.push_back(corners[order[i]]);
+
+	++mSpriteCount;
+}
+
+void SpriteBatch::drawOutline(const sf::FloatRect& rect, sf::Color color)
+{
+	if (rect.width <= 0.f || rect.height <= 0.f)
+		return;
+
+	Batch& batch = findBatch(nullptr, rect);
+
+	// One pixel wide quad along each edge
+	const sf::FloatRect edges[4] =
+	{
+		sf::FloatRect(rect.left, rect.top, rect.width, 1.f),
+		sf::FloatRect(rect.left, rect.top + rect.height - 1.f, rect.width, 1.f),
+		sf::FloatRect(rect.left, rect.top, 1.f, rect.height),
+		sf::FloatRect(rect.left + rect.width - 1.f, rect.top, 1.f, rect.height),
+	};
+
+	for (std::size_t i = 0; i < 4; ++i)
+	{
+		const sf::FloatRect& edge = edges[i];
+		sf::Vertex topLeft(sf::Vector2f(edge.left, edge.top), color);
+		sf::Vertex topRight(sf::Vector2f(edge.left + edge.width, edge.top), color);
+		sf::Vertex bottomLeft(sf::Vector2f(edge.left, edge.top + edge.height), color);
+		sf::Vertex bottomRight(sf::Vector2f(edge.left + edge.width, edge.top + edge.height), color);
+
+		batch.vertices.push_back(topLeft);
+		batch.vertices.push_back(bottomLeft);
+		batch.vertices.push_back(topRight);
+		batch.vertices.push_back(topRight);
+		batch.vertices.push_back(bottomLeft);
+		batch.vertices.push_back(bottomRight);
+	}
+}
+
+void SpriteBatch::draw(const sf::VertexArray& vertices, const sf::RenderStates& states)
+{
+	if (vertices.getVertexCount() > 0)
+		draw(&vertices[0], vertices.getVertexCount(), vertices.getPrimitiveType(), states);
+}
+
+void SpriteBatch::draw(const sf::Vertex* vertices, std::size_t count, sf::PrimitiveType type, const sf::RenderStates& states)
+{
+	assert(type == sf::Triangles || type == sf::Quads);
+
+	if (count == 0)
+		return;
+
+	Batch& batch = findBatch(states.texture, states.transform.transformRect(getBounds(vertices, count)));
+
+	if (type == sf::Triangles)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			sf::Vertex vertex = vertices[i];
+			vertex.position = states.transform.transformPoint(vertex.position);
+			batch.vertices.push_back(vertex);
+		}
+	}
+	else
+	{
+		// Each quad is split along its first diagonal
+		const std::size_t order[6] = { 0, 1, 2, 0, 2, 3 };
+		for (std::size_t quad = 0; quad + 3 < count; quad += 4)
+		{
+			for (std::size_t i = 0; i < 6; ++i)
+			{
+				sf::Vertex vertex = vertices[quad + order[i]];
+				vertex.position = states.transform.transformPoint(vertex.position);
+				batch.vertices.push_back(vertex);
+			}
+		}
+	}
+}
+
+void SpriteBatch::drawOverlay(const sf::Vertex* vertices, std::size_t count, const sf::Texture& texture, const sf::Transform& transform)
+{
+	assert(!mOverlayTexture || mOverlayTexture == &texture);
+	mOverlayTexture = &texture;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		sf::Vertex vertex = vertices[i];
+		vertex.position = transform.transformPoint(vertex.position);
+		mOverlay.push_back(vertex);
+	}
+}
+
+void SpriteBatch::submit(sf::RenderTarget& target) const
+{
+	for (std::size_t i = 0; i < mBatchCount; ++i)
+	{
+		const Batch& batch = mBatches[i];
+		target.draw(batch.vertices.data(), batch.vertices.size(), sf::Triangles, sf::RenderStates(batch.texture));
+	}
+
+	if (!mOverlay.empty())
+		target.draw(mOverlay.data(), mOverlay.size(), sf::Triangles, sf::RenderStates(mOverlayTexture));
+}
+
+void SpriteBatch::clear()
+{
+	mBatchCount = 0;
+	mOverlay.clear();
+	mOverlayTexture = nullptr;
+	mSpriteCount = 0;
+}
+
+std::size_t SpriteBatch::getDrawCalls() const
+{
+	return mBatchCount + (mOverlay.empty() ? 0 : 1);
+}
+
+std::size_t SpriteBatch::getSpriteCount() const
+{
+	return mSpriteCount;
+}
+
+SpriteBatch::Batch& SpriteBatch::findBatch(const sf::Texture* texture, const sf::FloatRect& bounds)
+{
+	// Walk back to the last batch these bounds overlap; any batch of the texture from there on can take them
+	for (std::size_t i = mBatchCount; i-- > 0; )
+	{
+		Batch& batch = mBatches[i];
+		if (batch.texture == texture)
+		{
+			batch.bounds = unite(batch.bounds, bounds);
+			return batch;
+		}
+
+		if (batch.bounds.intersects(bounds))
+			break;
+	}
+
+	Batch& batch = addBatch(bounds);
+	batch.texture = texture;
+	return batch;
+}
+
+SpriteBatch::Batch& SpriteBatch::addBatch(const sf::FloatRect& bounds)
+{
+	if (mBatchCount == mBatches.size())
+		mBatches.push_back(Batch());
+
+	Batch& batch = mBatches[mBatchCount++];
+	batch.texture = nullptr;
+	batch.vertices.clear();
+	batch.bounds = bounds;
+	return batch;
+}
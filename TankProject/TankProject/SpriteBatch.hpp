@@ -0,0 +1,70 @@
+#pragma once
+
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/PrimitiveType.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/RenderStates.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+
+#include <vector>
+
+
+namespace sf
+{
+	class RenderTarget;
+	class Sprite;
+	class VertexArray;
+}
+
+// Records a frame's drawing and submits it with as few draw calls as it can without changing the
+// picture. Sprites and vertex arrays become transformed triangles in per-texture vertex streams; each
+// piece goes into the most recent stream of its texture that nothing it overlaps was drawn after, so
+// overlapping things still come out in the order they were submitted. Overlay triangles go on top of
+// everything in one stream of their own. Nothing recorded points back to what was drawn, so a batch
+// can be submitted on another thread while the scene changes. There is no sf::Text: drawing one reads
+// its font's texture, which the font may grow on the simulation thread at the same time.
+class SpriteBatch : private sf::NonCopyable
+{
+public:
+							SpriteBatch();
+
+	void					draw(const sf::Sprite& sprite, const sf::Transform& transform);
+	// Triangles or quads, drawn with the texture and transform of the states
+	void					draw(const sf::VertexArray& vertices, const sf::RenderStates& states);
+	void					draw(const sf::Vertex* vertices, std::size_t count, sf::PrimitiveType type, const sf::RenderStates& states);
+	void					drawOutline(const sf::FloatRect& rect, sf::Color color);
+	// Triangles drawn above everything else, all together in one call; they must share a texture
+	void					drawOverlay(const sf::Vertex* vertices, std::size_t count, const sf::Texture& texture, const sf::Transform& transform);
+
+	// Draws everything recorded, which stays recorded until clear()
+	void					submit(sf::RenderTarget& target) const;
+	void					clear();
+
+	// Figures of what is recorded
+	std::size_t				getDrawCalls() const;
+	std::size_t				getSpriteCount() const;
+
+
+private:
+	// A run of triangles sharing a texture, none for outlines
+	struct Batch
+	{
+		const sf::Texture*		texture;
+		std::vector<sf::Vertex>	vertices;
+		sf::FloatRect			bounds;
+	};
+
+
+private:
+	Batch&					findBatch(const sf::Texture* texture, const sf::FloatRect& bounds);
+	Batch&					addBatch(const sf::FloatRect& bounds);
+
+
+private:
+	std::vector<Batch>		mBatches;		// kept between frames so the vertex storage is reused
+	std::size_t				mBatchCount;
+	std::vector<sf::Vertex>	mOverlay;
+	const sf::Texture*		mOverlayTexture;
+	std::size_t				mSpriteCount;
+};
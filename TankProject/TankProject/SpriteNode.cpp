@@ -1,4 +1,5 @@
 #include "SpriteNode.hpp"
+#include "SpriteBatch.hpp"
 
 #include <SFML/Graphics/RenderTarget.hpp>
 
@@ -18,6 +19,16 @@ void SpriteNode::drawCurrent(sf::RenderTarget& target, sf::RenderStates states)
 	target.draw(mSprite, states);
 }
 
+void SpriteNode::batchCurrent(SpriteBatch& batch, sf::RenderStates states) const
+{
+	batch.draw(mSprite, states.transform);
+}
+
+sf::FloatRect SpriteNode::getDrawBounds() const
+{
+	return mSprite.getGlobalBounds();
+}
+
 sf::FloatRect SpriteNode::getBoundingRect() const
 {
 	return getWorldTransform().transformRect(mSprite.getGlobalBounds());
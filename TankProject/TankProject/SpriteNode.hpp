@@ -13,6 +13,8 @@ public:
 
 private:
 	virtual void drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const;
+	virtual void batchCurrent(SpriteBatch& batch, sf::RenderStates states) const;
+	virtual sf::FloatRect getDrawBounds() const;
 
 public: 
 	sf::FloatRect SpriteNode::getBoundingRect() const;
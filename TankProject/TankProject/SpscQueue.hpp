@@ -0,0 +1,32 @@
+#pragma once
+
+#include <SFML/System/NonCopyable.hpp>
+
+#include <array>
+#include <atomic>
+
+
+// Fixed-capacity ring buffer shared by exactly one producer thread and one consumer thread.
+// Neither side ever blocks or locks: push() fails when the queue is full, pop() when it is empty.
+template <typename T, std::size_t Capacity>
+class SpscQueue : private sf::NonCopyable
+{
+public:
+							SpscQueue();
+
+	// Producer side
+	bool					push(const T& item);
+
+	// Consumer side
+	bool					pop(T& item);
+	bool					isEmpty() const;
+
+
+private:
+	// One slot always stays free to tell a full queue from an empty one
+	std::array<T, Capacity + 1>	mItems;
+	std::atomic<std::size_t>	mHead;	// next slot to read, only written by the consumer
+	std::atomic<std::size_t>	mTail;	// next slot to write, only written by the producer
+};
+
+#include "SpscQueue.inl"
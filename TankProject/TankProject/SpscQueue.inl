@@ -0,0 +1,45 @@
+
+template <typename T, std::size_t Capacity>
+SpscQueue<T, Capacity>::SpscQueue()
+	: mItems()
+	, mHead(0)
+	, mTail(0)
+{
+}
+
+template <typename T, std::size_t Capacity>
+bool SpscQueue<T, Capacity>::push(const T& item)
+{
+	std::size_t tail = mTail.load(std::memory_order_relaxed);
+	std::size_t next = (tail + 1) % mItems.size();
+
+	if (next == mHead.load(std::memory_order_acquire))
+		return false;
+
+	mItems[tail] = item;
+
+	// Publish the slot only once it is fully written
+	mTail.store(next, std::memory_order_release);
+	return true;
+}
+
+template <typename T, std::size_t Capacity>
+bool SpscQueue<T, Capacity>::pop(T& item)
+{
+	std::size_t head = mHead.load(std::memory_order_relaxed);
+
+	if (head == mTail.load(std::memory_order_acquire))
+		return false;
+
+	item = mItems[head];
+
+	// Hand the slot back to the producer once it has been read
+	mHead.store((head + 1) % mItems.size(), std::memory_order_release);
+	return true;
+}
+
+template <typename T, std::size_t Capacity>
+bool SpscQueue<T, Capacity>::isEmpty() const
+{
+	return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_acquire);
+}
@@ -3,7 +3,8 @@
 
 
 State::Context::Context(sf::RenderWindow& window, TextureHolder& textures, FontHolder& fonts, 
-	MusicPlayer& music, SoundPlayer& sounds, KeyBinding& keys1, KeyBinding& keys2)
+	MusicPlayer& music, SoundPlayer& sounds, KeyBinding& keys1, KeyBinding& keys2, Statistics& statistics,
+	const GraphicsSettings& graphics)
 	: window(&window)
 	, textures(&textures)
 	, fonts(&fonts)
@@ -11,6 +12,8 @@ State::Context::Context(sf::RenderWindow& window, TextureHolder& textures, FontH
 	, sounds(&sounds)
 	, keys1(&keys1)
 	, keys2(&keys2)
+	, statistics(&statistics)
+	, graphics(&graphics)
 {
 }
 
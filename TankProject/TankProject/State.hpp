@@ -18,6 +18,8 @@ class Player;
 class MusicPlayer;
 class SoundPlayer;
 class KeyBinding;
+struct Statistics;
+struct GraphicsSettings;
 
 class State
 {
@@ -27,7 +29,8 @@ public:
 	struct Context
 	{
 		Context(sf::RenderWindow& window, TextureHolder& textures,
-			FontHolder& fonts, MusicPlayer& music, SoundPlayer& sounds, KeyBinding& keys1, KeyBinding& keys2);
+			FontHolder& fonts, MusicPlayer& music, SoundPlayer& sounds, KeyBinding& keys1, KeyBinding& keys2, Statistics& statistics,
+			const GraphicsSettings& graphics);
 		sf::RenderWindow* window;
 		TextureHolder* textures;
 		FontHolder* fonts;
@@ -35,6 +38,8 @@ public:
 		SoundPlayer* sounds;
 		KeyBinding*	keys1;
 		KeyBinding*	keys2;
+		Statistics*	statistics;
+		const GraphicsSettings*	graphics;
 	};
 
 public:
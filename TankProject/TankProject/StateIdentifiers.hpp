@@ -18,6 +18,10 @@ namespace States
 		ResistanceSuccess,
 		LiberationSuccess,
 		HostGame,
-		JoinGame
+		JoinGame,
+		HostRollbackGame,
+		JoinRollbackGame,
+		HostLockstepGame,
+		JoinLockstepGame
 	};
 }
@@ -35,6 +35,8 @@ public:
 	void registerState(States::ID stateID);
 	template <typename T, typename Param1>
 	void registerState(States::ID stateID, Param1 arg1);
+	template <typename T, typename Param1, typename Param2>
+	void registerState(States::ID stateID, Param1 arg1, Param2 arg2);
 	void update(sf::Time dt);
 	void draw();
 	void handleEvent(const sf::Event& event);
@@ -83,6 +85,15 @@ void StateStack::registerState(States::ID stateID, Param1 arg1)
 	};
 }
 
+template <typename T, typename Param1, typename Param2>
+void StateStack::registerState(States::ID stateID, Param1 arg1, Param2 arg2)
+{
+	mFactories[stateID] = [this, arg1, arg2]()
+	{
+		return State::Ptr(new T(*this, mContext, arg1, arg2));
+	};
+}
+
 
 
 
@@ -0,0 +1,183 @@
+#include "StaticGeometryNode.hpp"
+#include "SpriteBatch.hpp"
+#include "Foreach.hpp"
+#include "Utility.hpp"
+
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+
+#include <cmath>
+#include <vector>
+
+
+namespace
+{
+	typedef std::vector<sf::Vertex> Polygon;
+
+	sf::Vertex interpolate(const sf::Vertex& from, const sf::Vertex& to, float ratio)
+	{
+		sf::Vertex vertex(from);
+		vertex.position = from.position + (to.position - from.position) * ratio;
+		vertex.texCoords = from.texCoords + (to.texCoords - from.texCoords) * ratio;
+		return vertex;
+	}
+
+	// Keeps the part of the polygon where sign * (coordinate - limit) >= 0, for the x or y coordinate
+	Polygon clip(const Polygon& polygon, bool horizontal, float limit, float sign)
+	{
+		Polygon result;
+
+		for (std::size_t i = 0; i < polygon.size(); ++i)
+		{
+			const sf::Vertex& current = polygon[i];
+			const sf::Vertex& next = polygon[(i + 1) % polygon.size()];
+
+			float currentDistance = sign * ((horizontal ? current.position.x : current.position.y) - limit);
+			float nextDistance = sign * ((horizontal ? next.position.x : next.position.y) - limit);
+
+			if (currentDistance >= 0.f)
+				result.push_back(current);
+
+			if ((currentDistance >= 0.f) != (nextDistance >= 0.f))
+				result.push_back(interpolate(current, next, currentDistance / (currentDistance - nextDistance)));
+		}
+
+		return result;
+	}
+}
+
+// One cell of the grid: the pieces of every sprite that fall inside it, in the order they were added
+class StaticGeometryNode::Chunk : public SceneNode
+{
+public:
+	void addPolygon(const sf::Texture* texture, const Polygon& polygon)
+	{
+		// Consecutive pieces of the same texture share a vertex array
+		if (mLayers.empty() || mLayers.back().texture != texture)
+		{
+			Layer layer;
+			layer.texture = texture;
+			layer.vertices.setPrimitiveType(sf::Triangles);
+			mLayers.push_back(layer);
+		}
+
+		Layer& layer = mLayers.back();
+		for (std::size_t i = 1; i + 1 < polygon.size(); ++i)
+		{
+			layer.vertices.append(polygon[0]);
+			layer.vertices.append(polygon[i]);
+			layer.vertices.append(polygon[i + 1]);
+		}
+
+		mBounds = unite(mBounds, layer.vertices.getBounds());
+		markBoundsDirty();
+	}
+
+private:
+	struct Layer
+	{
+		const sf::Texture*	texture;
+		sf::VertexArray		vertices;
+	};
+
+	virtual void drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const
+	{
+		FOREACH(const Layer& layer, mLayers)
+		{
+			states.texture = layer.texture;
+			target.draw(layer.vertices, states);
+		}
+	}
+
+	virtual void batchCurrent(SpriteBatch& batch, sf::RenderStates states) const
+	{
+		FOREACH(const Layer& layer, mLayers)
+		{
+			states.texture = layer.texture;
+			batch.draw(layer.vertices, states);
+		}
+	}
+
+	virtual sf::FloatRect getDrawBounds() const
+	{
+		return mBounds;
+	}
+
+	virtual bool isStatic() const
+	{
+		return true;
+	}
+
+private:
+	std::vector<Layer>	mLayers;
+	sf::FloatRect		mBounds;
+};
+
+StaticGeometryNode::StaticGeometryNode(float chunkSize)
+	: mChunkSize(chunkSize)
+	, mChunks()
+{
+}
+
+void StaticGeometryNode::addSprite(const sf::Sprite& sprite, const sf::Transform& transform)
+{
+	// The sprite's quad, corners in order around it
+	sf::IntRect rect = sprite.getTextureRect();
+	sf::FloatRect local = sprite.getLocalBounds();
+	sf::Transform combined = transform * sprite.getTransform();
+
+	float left = static_cast<float>(rect.left);
+	float right = left + rect.width;
+	float top = static_cast<float>(rect.top);
+	float bottom = top + rect.height;
+
+	Polygon quad;
+	quad.push_back(sf::Vertex(combined.transformPoint(0.f, 0.f), sprite.getColor(), sf::Vector2f(left, top)));
+	quad.push_back(sf::Vertex(combined.transformPoint(local.width, 0.f), sprite.getColor(), sf::Vector2f(right, top)));
+	quad.push_back(sf::Vertex(combined.transformPoint(local.width, local.height), sprite.getColor(), sf::Vector2f(right, bottom)));
+	quad.push_back(sf::Vertex(combined.transformPoint(0.f, local.height), sprite.getColor(), sf::Vector2f(left, bottom)));
+
+	// Cut it at every chunk border it crosses
+	sf::FloatRect bounds = combined.transformRect(local);
+	int firstColumn = static_cast<int>(std::floor(bounds.left / mChunkSize));
+	int lastColumn = static_cast<int>(std::ceil((bounds.left + bounds.width) / mChunkSize));
+	int firstRow = static_cast<int>(std::floor(bounds.top / mChunkSize));
+	int lastRow = static_cast<int>(std::ceil((bounds.top + bounds.height) / mChunkSize));
+
+	for (int row = firstRow; row < lastRow; ++row)
+	{
+		for (int column = firstColumn; column < lastColumn; ++column)
+		{
+			float chunkLeft = column * mChunkSize;
+			float chunkTop = row * mChunkSize;
+
+			Polygon piece = clip(quad, true, chunkLeft, 1.f);
+			piece = clip(piece, true, chunkLeft + mChunkSize, -1.f);
+			piece = clip(piece, false, chunkTop, 1.f);
+			piece = clip(piece, false, chunkTop + mChunkSize, -1.f);
+
+			if (piece.size() >= 3)
+				getChunk(ChunkIndex(column, row)).addPolygon(sprite.getTexture(), piece);
+		}
+	}
+}
+
+std::size_t StaticGeometryNode::getChunkCount() const
+{
+	return mChunks.size();
+}
+
+StaticGeometryNode::Chunk& StaticGeometryNode::getChunk(ChunkIndex index)
+{
+	auto found = mChunks.find(index);
+	if (found != mChunks.end())
+		return *found->second;
+
+	std::unique_ptr<Chunk> chunk(new Chunk());
+	Chunk& result = *chunk;
+	mChunks.insert(std::make_pair(index, chunk.get()));
+	attachChild(std::move(chunk));
+
+	return result;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "SceneNode.hpp"
+
+#include <SFML/Graphics/Sprite.hpp>
+
+#include <map>
+#include <utility>
+
+
+// Geometry that never moves, baked once into vertex arrays split over a grid of square chunks. Every
+// chunk is a child node with its own bounds, so the scene graph culls the chunks outside the view and
+// nothing is transformed again after baking. Sprites are cut at chunk borders, which keeps the drawing
+// order between overlapping sprites exactly as they were added.
+class StaticGeometryNode : public SceneNode
+{
+public:
+	explicit				StaticGeometryNode(float chunkSize);
+
+	// Bakes the sprite as drawn with the given transform, in this node's coordinates
+	void					addSprite(const sf::Sprite& sprite, const sf::Transform& transform);
+
+	std::size_t				getChunkCount() const;
+
+
+private:
+	class Chunk;
+	typedef std::pair<int, int> ChunkIndex;
+
+
+private:
+	Chunk&					getChunk(ChunkIndex index);
+
+
+private:
+	float					mChunkSize;
+	std::map<ChunkIndex, Chunk*>	mChunks;	// owned as children
+};
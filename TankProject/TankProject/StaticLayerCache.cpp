@@ -0,0 +1,115 @@
+#include "StaticLayerCache.hpp"
+#include "RenderList.hpp"
+#include "SpriteBatch.hpp"
+
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+	sf::Vector2i getTextureSize(const sf::FloatRect& area)
+	{
+		return sf::Vector2i(static_cast<int>(std::ceil(area.width)), static_cast<int>(std::ceil(area.height)));
+	}
+}
+
+StaticLayerCache::StaticLayerCache(const sf::FloatRect& area)
+	: mArea(area)
+	, mTexture()
+	, mAvailable(false)
+	, mRenderedPixels(0)
+	, mDrawCalls(0)
+{
+	sf::Vector2i size = getTextureSize(area);
+	mAvailable = mTexture.create(size.x, size.y);
+}
+
+bool StaticLayerCache::isAvailable() const
+{
+	return mAvailable;
+}
+
+sf::IntRect StaticLayerCache::getPixels(const sf::FloatRect& area, const sf::FloatRect& rect)
+{
+	if (rect.width <= 0.f || rect.height <= 0.f)
+		return sf::IntRect();
+
+	sf::Vector2i size = getTextureSize(area);
+	int left = std::max(static_cast<int>(std::floor(rect.left - area.left)) - 1, 0);
+	int top = std::max(static_cast<int>(std::floor(rect.top - area.top)) - 1, 0);
+	int right = std::min(static_cast<int>(std::ceil(rect.left + rect.width - area.left)) + 1, size.x);
+	int bottom = std::min(static_cast<int>(std::ceil(rect.top + rect.height - area.top)) + 1, size.y);
+
+	if (left >= right || top >= bottom)
+		return sf::IntRect();
+
+	return sf::IntRect(left, top, right - left, bottom - top);
+}
+
+sf::FloatRect StaticLayerCache::getArea(const sf::FloatRect& area, const sf::IntRect& pixels)
+{
+	return sf::FloatRect(area.left + pixels.left, area.top + pixels.top, static_cast<float>(pixels.width), static_cast<float>(pixels.height));
+}
+
+void StaticLayerCache::draw(sf::RenderTarget& target, const RenderList& list)
+{
+	mRenderedPixels = 0;
+	mDrawCalls = 0;
+
+	if (list.getStaticUpdateCount() > 0)
+	{
+		for (std::size_t i = 0; i < list.getStaticUpdateCount(); ++i)
+			render(list.getStaticUpdate(i), list.getStaticUpdatePixels(i));
+
+		mTexture.display();
+	}
+
+	// Only the part the view shows, rotation included, is drawn
+	sf::FloatRect visibleArea = target.getView().getInverseTransform().transformRect(sf::FloatRect(-1.f, -1.f, 2.f, 2.f));
+	sf::IntRect pixels = getPixels(mArea, visibleArea);
+	if (pixels.width <= 0 || pixels.height <= 0)
+		return;
+
+	// The cache is opaque, it replaces whatever was below
+	sf::FloatRect area = getArea(mArea, pixels);
+	sf::Sprite cache(mTexture.getTexture(), pixels);
+	cache.setPosition(area.left, area.top);
+	target.draw(cache, sf::BlendNone);
+	mDrawCalls++;
+}
+
+std::size_t StaticLayerCache::getRenderedPixels() const
+{
+	return mRenderedPixels;
+}
+
+std::size_t StaticLayerCache::getDrawCalls() const
+{
+	return mDrawCalls;
+}
+
+void StaticLayerCache::render(const SpriteBatch& batch, const sf::IntRect& pixels)
+{
+	sf::Vector2f size(mTexture.getSize());
+	sf::FloatRect area = getArea(mArea, pixels);
+
+	// Only this rectangle of the texture is drawn to
+	sf::View view(area);
+	view.setViewport(sf::FloatRect(pixels.left / size.x, pixels.top / size.y, pixels.width / size.x, pixels.height / size.y));
+	mTexture.setView(view);
+
+	// Cleared like the whole scene is every frame
+	sf::RectangleShape background(sf::Vector2f(area.width, area.height));
+	background.setPosition(area.left, area.top);
+	background.setFillColor(sf::Color::Black);
+	mTexture.draw(background, sf::BlendNone);
+
+	batch.submit(mTexture);
+
+	mRenderedPixels += pixels.width * pixels.height;
+	mDrawCalls += batch.getDrawCalls() + 1;
+}
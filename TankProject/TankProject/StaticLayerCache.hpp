@@ -0,0 +1,45 @@
+#pragma once
+
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/RenderTexture.hpp>
+
+
+class RenderList;
+class SpriteBatch;
+
+// The static nodes of a scene, rendered into a texture covering a fixed area at one pixel per unit.
+// Only the pixels a render list asks for are rendered again; every frame the cache itself is a single
+// draw. Dynamic nodes are then drawn on top of it.
+class StaticLayerCache : private sf::NonCopyable
+{
+public:
+	explicit				StaticLayerCache(const sf::FloatRect& area);
+
+	// False if the graphics card cannot hold a texture of that size; the scene must then be drawn directly
+	bool					isAvailable() const;
+
+	// The cache pixels a rectangle of the area touches, with one to spare on each side for rounding
+	static sf::IntRect		getPixels(const sf::FloatRect& area, const sf::FloatRect& rect);
+	// The rectangle of the area a block of cache pixels covers
+	static sf::FloatRect	getArea(const sf::FloatRect& area, const sf::IntRect& pixels);
+
+	// Renders the list's static updates, then draws the cache
+	void					draw(sf::RenderTarget& target, const RenderList& list);
+
+	// Pixels rendered again by the last draw
+	std::size_t				getRenderedPixels() const;
+	std::size_t				getDrawCalls() const;
+
+
+private:
+	void					render(const SpriteBatch& batch, const sf::IntRect& pixels);
+
+
+private:
+	sf::FloatRect			mArea;
+	sf::RenderTexture		mTexture;
+	bool					mAvailable;
+	std::size_t				mRenderedPixels;
+	std::size_t				mDrawCalls;
+};
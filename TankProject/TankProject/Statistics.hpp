@@ -0,0 +1,23 @@
+#pragma once
+
+#include <SFML/System/Time.hpp>
+
+#include <cstddef>
+
+
+// Runtime figures the states report for the on-screen statistics overlay (owned by Application)
+struct Statistics
+{
+	Statistics()
+		: networked(false)
+		, roundTripTime(sf::Time::Zero)
+		, jitter(sf::Time::Zero)
+		, drawCalls(0)
+	{
+	}
+
+	bool					networked;
+	sf::Time				roundTripTime;
+	sf::Time				jitter;
+	std::size_t				drawCalls;		// world draw calls of the last frame, 0 when no world is drawn
+};
@@ -9,6 +9,10 @@
 #include "NetworkNode.hpp"
 #include "ResourceHolder.hpp"
 #include "ParticleNode.hpp"
+#include "KeyBinding.hpp"
+#include "WorldSnapshot.hpp"
+#include "SpriteBatch.hpp"
+#include "TextureAtlas.hpp"
 
 #include <SFML/Graphics/RenderTarget.hpp>
 #include <SFML/Graphics/RenderStates.hpp>
@@ -28,7 +32,7 @@ namespace
 Tank::Tank(Type type, const TextureHolder& textures, const FontHolder& fonts)
 	: Entity(Table[type].hitpoints)
 	, mType(type)
-	, mSprite(textures.get(Table[type].texture), Table[type].textureRect)
+	, mSprite(textures.get(Table[type].texture), TextureAtlas::getRect(Table[type].texture, Table[type].textureRect))
 	, mExplosion(textures.get(Textures::Explosion))
 	, mFireCommand()
 	, mMissileCommand()
@@ -78,12 +82,12 @@ Tank::Tank(Type type, const TextureHolder& textures, const FontHolder& fonts)
 		createPickup(node, textures);
 	};
 
-	std::unique_ptr<TextNode> healthDisplay(new TextNode(fonts, ""));
+	std::unique_ptr<LabelNode> healthDisplay(new LabelNode(fonts));
 	mHealthDisplay = healthDisplay.get();
 	mHealthDisplay->setOrigin(0, -50);
 	attachChild(std::move(healthDisplay));
 
-	std::unique_ptr<TextNode> missileDisplay(new TextNode(fonts, ""));
+	std::unique_ptr<LabelNode> missileDisplay(new LabelNode(fonts));
 	missileDisplay->setOrigin(0, -70);
 	ammoDisplay = missileDisplay.get();
 	attachChild(std::move(missileDisplay));
@@ -113,7 +117,7 @@ Tank::Tank(Type type, const TextureHolder& textures, const FontHolder& fonts)
 	}
 
 	turretRotationVelocity = 0.0f;
-	turretSprite = sf::Sprite(textures.get(TableTurrets[turretType].texture), TableTurrets[turretType].textureRect);
+	turretSprite = sf::Sprite(textures.get(TableTurrets[turretType].texture), TextureAtlas::getRect(TableTurrets[turretType].texture, TableTurrets[turretType].textureRect));
 	centerOrigin(turretSprite);
 
 	//playLocalSound(SoundEffect::TankIdle, true); 
@@ -143,6 +147,25 @@ void Tank::drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const
 	}
 }
 
+void Tank::batchCurrent(SpriteBatch& batch, sf::RenderStates states) const
+{
+	if (isDestroyed() && mShowExplosion)
+		batch.draw(mExplosion.getSprite(), states.transform * mExplosion.getTransform());
+	else
+	{
+		batch.draw(mSprite, states.transform);
+		batch.draw(turretSprite, states.transform);
+	}
+}
+
+sf::FloatRect Tank::getDrawBounds() const
+{
+	if (isDestroyed() && mShowExplosion)
+		return mExplosion.getGlobalBounds();
+	else
+		return unite(mSprite.getGlobalBounds(), turretSprite.getGlobalBounds());
+}
+
 void Tank::disablePickups()
 {
 	mPickupsEnabled = false;
@@ -281,6 +304,7 @@ void Tank::remove()
 {
 	Entity::remove();
 	mShowExplosion = false;
+	markBoundsDirty();
 }
 
 bool Tank::isAllied() const
@@ -313,7 +337,7 @@ float Tank::getSpeedBoost() const
 	return speedBoostMultiplier;
 }
 
-int	Tank::getIdentifier()
+int	Tank::getIdentifier() const
 {
 	return mIdentifier;
 }
@@ -331,6 +355,7 @@ float Tank::getTurretRotation()
 void Tank::setTurretRotation(float rotation)
 {
 	turretSprite.setRotation(rotation);
+	markBoundsDirty();
 }
 
 Tank::Type Tank::getType()
@@ -611,6 +636,8 @@ void Tank::checkSpeedBoost(sf::Time dt)
 void Tank::updateTurret(sf::Time dt)
 {
 	turretSprite.rotate(turretRotationVelocity * dt.asSeconds());
+	if (turretRotationVelocity != 0.f)
+		markBoundsDirty();
 
 	if (isRotating)
 	{
@@ -640,6 +667,125 @@ void Tank::setTurretRotationVelocity(float rotationVelocity)
 	turretRotationVelocity = rotationVelocity;
 }
 
+float Tank::getTurretRotationVelocity() const
+{
+	return turretRotationVelocity;
+}
+
+MovementState Tank::getMovementState() const
+{
+	MovementState state;
+	state.position = getPosition();
+	state.rotation = getRotation();
+	state.turretRotation = turretSprite.getRotation();
+	state.turretVelocity = turretRotationVelocity;
+	return state;
+}
+
+void Tank::setMovementState(const MovementState& state)
+{
+	setPosition(state.position);
+	setRotation(state.rotation);
+	turretSprite.setRotation(state.turretRotation);
+	turretRotationVelocity = state.turretVelocity;
+}
+
+void Tank::saveState(TankState& state) const
+{
+	state.identifier = mIdentifier;
+	state.type = mType;
+	state.position = getPosition();
+	state.rotation = getRotation();
+	state.velocity = getVelocity();
+	state.turretRotation = turretSprite.getRotation();
+	state.turretRotationVelocity = turretRotationVelocity;
+	state.turretRotating = isRotating;
+	state.hitpoints = getHitpoints();
+	state.ammoCount = ammoCount;
+	state.missileAmmo = mMissileAmmo;
+	state.fireCountdown = mFireCountdown;
+	state.isFiring = mIsFiring;
+	state.fireRateLevel = mFireRateLevel;
+	state.hasSpeedBoost = hasSpeedBoost;
+	state.speedBoostCountdown = speedBoostCountdown;
+	state.speedBoostMultiplier = speedBoostMultiplier;
+	state.spawnedPickup = mSpawnedPickup;
+	state.explosionBegan = mExplosionBegan;
+}
+
+void Tank::restoreState(const TankState& state)
+{
+	setPosition(state.position);
+	setRotation(state.rotation);
+	setVelocity(state.velocity);
+	turretSprite.setRotation(state.turretRotation);
+	turretRotationVelocity = state.turretRotationVelocity;
+	isRotating = state.turretRotating;
+	restoreHitpoints(state.hitpoints);
+	ammoCount = state.ammoCount;
+	mMissileAmmo = state.missileAmmo;
+	mFireCountdown = state.fireCountdown;
+	mIsFiring = state.isFiring;
+	mFireRateLevel = state.fireRateLevel;
+	hasSpeedBoost = state.hasSpeedBoost;
+	speedBoostCountdown = state.speedBoostCountdown;
+	speedBoostMultiplier = state.speedBoostMultiplier;
+	mSpawnedPickup = state.spawnedPickup;
+
+	// A tank brought back to life must be able to explode again
+	if (!state.explosionBegan && mExplosionBegan)
+		mExplosion.restart();
+	mExplosionBegan = state.explosionBegan;
+
+	updateTexts();
+}
+
+// Mirrors one World::update for a player tank: the movement commands (see Player.cpp), the diagonal
+// velocity correction, then updateTurret() and Entity::updateCurrent(). Collisions are not replayed.
+void Tank::predictMovement(MovementState& state, sf::Uint8 actions, sf::Time dt) const
+{
+	auto isActive = [actions](PlayerAction::Type action)
+	{
+		return (actions & (1 << action)) != 0;
+	};
+
+	sf::Vector2f velocity;
+	if (isActive(PlayerAction::MoveUp))
+		velocity += sf::Vector2f(-0.6f, -0.6f) * getSpeedBoost() * getMaxSpeed();
+	if (isActive(PlayerAction::MoveDown))
+		velocity += sf::Vector2f(+0.25f, +0.25f) * getSpeedBoost() * getMaxSpeed();
+
+	if (isActive(PlayerAction::RotateLeft))
+		state.rotation -= getMaxSpeed() / 100;
+	if (isActive(PlayerAction::RotateRight))
+		state.rotation += getMaxSpeed() / 100;
+
+	bool turretRotating = false;
+	if (isActive(PlayerAction::RotateTurretLeft))
+	{
+		if (std::abs(state.turretVelocity) < getMaxTurretRotationSpeed())
+			state.turretVelocity -= getTurretRotationSpeed();
+		turretRotating = true;
+	}
+	if (isActive(PlayerAction::RotateTurretRight))
+	{
+		if (std::abs(state.turretVelocity) < getMaxTurretRotationSpeed())
+			state.turretVelocity += getTurretRotationSpeed();
+		turretRotating = true;
+	}
+
+	if (velocity.x != 0.f && velocity.y != 0.f)
+		velocity /= std::sqrt(2.f);
+
+	state.turretRotation += state.turretVelocity * dt.asSeconds();
+	if (!turretRotating)
+		state.turretVelocity *= 0.9f;
+
+	float radians = toRadian(state.rotation + 90.f);
+	state.position.x += std::cos(radians) * dt.asSeconds() * velocity.x;
+	state.position.y += std::sin(radians) * dt.asSeconds() * velocity.y;
+}
+
 float Tank::getTotalTurretRotation() const
 {
 	return turretSprite.getRotation() + getRotation();
@@ -674,6 +820,7 @@ void Tank::updateEnemyTurretRotation(sf::Time dt)
 	float differenceAngle = turretSprite.getRotation() - angle;
 
 	turretSprite.setRotation(angle);		// - 90 to have it face the player.. forward is to the right on a sprite
+	markBoundsDirty();
 
 	fire();
 }
\ No newline at end of file
@@ -3,8 +3,9 @@
 #include "Command.hpp"
 #include "ResourceIdentifiers.hpp"
 #include "Projectile.hpp"
-#include "TextNode.hpp"
+#include "LabelNode.hpp"
 #include "Animation.hpp"
+#include "PredictionBuffer.hpp"
 
 
 #include <SFML/Graphics.hpp>
@@ -12,6 +13,8 @@
 
 //This class was worked on by Ciaran Mooney
 
+struct TankState;
+
 
 class Tank : public Entity
 {
@@ -51,11 +54,14 @@ public:
 	void					setType(Tank::Type type);
 	Tank::Type				getAllyType();
 	float					getTankRadius();
-	int						getIdentifier();
+	int						getIdentifier() const;
 	void					setIdentifier(int identifier);
 	int						getMissileAmmo() const;
 	void					setMissileAmmo(int ammo);
 	int						getAmmoCount() const;
+	float					getTurretRotationVelocity() const;
+	MovementState			getMovementState() const;
+	void					setMovementState(const MovementState& state);
 	// -- end getters and setters --
 
 	void					increaseFireRate();
@@ -70,6 +76,13 @@ public:
 	void					setTurretRotationVelocity(float rotationVelocity);
 	void					guideTurretTowards(sf::Vector2f position);
 
+	// Copies all simulation state in or out, for rollback (see WorldSnapshot.hpp)
+	void					saveState(TankState& state) const;
+	void					restoreState(const TankState& state);
+
+	// Runs one frame of the player movement model on a copy of the state, used to replay inputs
+	void					predictMovement(MovementState& state, sf::Uint8 actions, sf::Time dt) const;
+
 	void					playRotateSound();
 	bool					mEngineIdleLooping;
 	bool					mEngineDriveLoop;
@@ -82,6 +95,8 @@ public:
 
 private:
 	virtual void			drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const;
+	virtual void			batchCurrent(SpriteBatch& batch, sf::RenderStates states) const;
+	virtual sf::FloatRect	getDrawBounds() const;
 	virtual void 			updateCurrent(sf::Time dt, CommandQueue& commands);
 	void					updateMovementPattern(sf::Time dt);
 	void					checkPickupDrop(CommandQueue& commands);
@@ -133,8 +148,8 @@ private:
 	Command 				mDropPickupCommand;
 	float					mTravelledDistance;
 	std::size_t				mDirectionIndex;
-	TextNode*				mHealthDisplay;
-	TextNode*				ammoDisplay;
+	LabelNode*				mHealthDisplay;
+	LabelNode*				ammoDisplay;
 
 	int						mIdentifier;
 
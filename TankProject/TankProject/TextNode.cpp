@@ -1,23 +1,38 @@
 #include "TextNode.hpp"
-#include "Utility.hpp"
+#include "SpriteBatch.hpp"
+#include "LabelNode.hpp"
+#include "GlyphCache.hpp"
 
 #include <SFML/Graphics/RenderTarget.hpp>
 
 
 TextNode::TextNode(const FontHolder& fonts, const std::string& text)
+	: mVertices()
+	, mBounds()
 {
-	mText.setFont(fonts.get(Fonts::Main));
-	mText.setCharacterSize(20);
+	LabelNode::loadGlyphs(fonts);
 	setString(text);
 }
 
 void TextNode::drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const
 {
-	target.draw(mText, states);
+	states.texture = &LabelNode::getGlyphs().getTexture();
+	target.draw(mVertices.data(), mVertices.size(), sf::Triangles, states);
+}
+
+void TextNode::batchCurrent(SpriteBatch& batch, sf::RenderStates states) const
+{
+	batch.drawOverlay(mVertices.data(), mVertices.size(), LabelNode::getGlyphs().getTexture(), states.transform);
+}
+
+sf::FloatRect TextNode::getDrawBounds() const
+{
+	return mBounds;
 }
 
 void TextNode::setString(const std::string& text)
 {
-	mText.setString(text);
-	centerOrigin(mText);
-}
\ No newline at end of file
+	mVertices.clear();
+	mBounds = LabelNode::getGlyphs().layout(text, sf::Color::White, mVertices);
+	markBoundsDirty();
+}
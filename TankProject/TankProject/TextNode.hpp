@@ -3,10 +3,14 @@
 #include "ResourceIdentifiers.hpp"
 #include "SceneNode.hpp"
 
-#include <SFML/Graphics/Text.hpp>
-#include <SFML/Graphics/Font.hpp>
+#include <SFML/Graphics/Vertex.hpp>
 
+#include <vector>
 
+
+// Text in the world, laid out from the labels' glyph cache rather than held as an sf::Text: measuring
+// or drawing an sf::Text loads glyphs into the font's texture, which the render thread may be drawing.
+// The cache holds printable ASCII only; any other character shows as '?'.
 class TextNode : public SceneNode
 {
 public:
@@ -17,8 +21,11 @@ public:
 
 private:
 	virtual void		drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const;
+	virtual void		batchCurrent(SpriteBatch& batch, sf::RenderStates states) const;
+	virtual sf::FloatRect	getDrawBounds() const;
 
 
 private:
-	sf::Text			mText;
+	std::vector<sf::Vertex>	mVertices;
+	sf::FloatRect			mBounds;
 };
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "TextureAtlas.hpp"
+#include "ResourceHolder.hpp"
+#include "Foreach.hpp"
+
+#include <SFML/Graphics/Image.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+
+namespace
+{
+	const char* const AtlasImageFile = "Media/Textures/Atlas.png";
+	const char* const AtlasLayoutFile = "Media/Textures/Atlas.txt";
+	const int LayoutVersion = 1;
+
+	// Transparent border around every image, so neighbours never bleed into each other
+	const unsigned int Padding = 2;
+
+	// Fits the guaranteed texture size of older graphics cards
+	const unsigned int MaxPageSize = 2048;
+
+	// Positions of the packed textures in the page. Written by loadImages() before any world is built from
+	// its images, and only read afterwards.
+	std::map<Textures::ID, sf::Vector2i> placements;
+
+	struct SourceFile
+	{
+		std::vector<char>	bytes;
+		sf::Uint32			hash;
+	};
+
+	sf::Uint32 hashBytes(const std::vector<char>& bytes)
+	{
+		// FNV-1a
+		sf::Uint32 hash = 2166136261u;
+		FOREACH(char byte, bytes)
+		{
+			hash ^= static_cast<sf::Uint8>(byte);
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
+
+	SourceFile readSource(const TextureAtlas::Source& source)
+	{
+		std::ifstream file(source.filename, std::ios::binary);
+		if (!file)
+			throw std::runtime_error("TextureAtlas::loadImages - Failed to load " + std::string(source.filename));
+
+		SourceFile result;
+		result.bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		result.hash = hashBytes(result.bytes);
+		return result;
+	}
+
+	std::unique_ptr<sf::Image> decodeSource(const TextureAtlas::Source& source, const SourceFile& file)
+	{
+		std::unique_ptr<sf::Image> image(new sf::Image());
+		if (file.bytes.empty() || !image->loadFromMemory(file.bytes.data(), file.bytes.size()))
+			throw std::runtime_error("TextureAtlas::loadImages - Failed to load " + std::string(source.filename));
+
+		return image;
+	}
+
+	// Shelf packing, tallest first. Images that do not fit keep a position of -1; returns the page height.
+	unsigned int packShelves(const std::vector<sf::Vector2u>& sizes, unsigned int width, std::vector<sf::Vector2i>& positions)
+	{
+		std::vector<std::size_t> order(sizes.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs)
+		{
+			return sizes[lhs].y > sizes[rhs].y;
+		});
+
+		positions.assign(sizes.size(), sf::Vector2i(-1, -1));
+
+		unsigned int x = Padding;
+		unsigned int y = Padding;
+		unsigned int shelfHeight = 0;
+		unsigned int height = 0;
+
+		FOREACH(std::size_t index, order)
+		{
+			sf::Vector2u size = sizes[index];
+			if (size.x + 2 * Padding > width)
+				continue;
+
+			// Start a new shelf below the current one
+			if (x + size.x + Padding > width)
+			{
+				y += shelfHeight + Padding;
+				x = Padding;
+				shelfHeight = 0;
+			}
+
+			if (y + size.y + Padding > MaxPageSize)
+				continue;
+
+			positions[index] = sf::Vector2i(static_cast<int>(x), static_cast<int>(y));
+			x += size.x + Padding;
+			shelfHeight = std::max(shelfHeight, size.y);
+			height = std::max(height, y + size.y + Padding);
+		}
+
+		return height;
+	}
+
+	// Reads a layout written for exactly these source files; fails if any of them changed
+	bool readLayout(const std::vector<TextureAtlas::Source>& sources, const std::vector<SourceFile>& files, std::vector<sf::Vector2i>& positions)
+	{
+		std::ifstream layout(AtlasLayoutFile);
+
+		std::string magic;
+		int version = 0;
+		std::size_t count = 0;
+		if (!(layout >> magic >> version >> count) || magic != "atlas" || version != LayoutVersion || count != sources.size())
+			return false;
+
+		positions.clear();
+		for (std::size_t i = 0; i < sources.size(); ++i)
+		{
+			int texture = 0;
+			std::string filename;
+			std::size_t size = 0;
+			sf::Uint32 hash = 0;
+			sf::Vector2i position;
+
+			if (!(layout >> texture >> filename >> size >> hash >> position.x >> position.y))
+				return false;
+
+			if (texture != sources[i].texture || filename != sources[i].filename || size != files[i].bytes.size() || hash != files[i].hash)
+				return false;
+
+			positions.push_back(position);
+		}
+
+		return true;
+	}
+
+	void writeLayout(const std::vector<TextureAtlas::Source>& sources, const std::vector<SourceFile>& files, const std::vector<sf::Vector2i>& positions)
+	{
+		std::ofstream layout(AtlasLayoutFile);
+		layout << "atlas " << LayoutVersion << " " << sources.size() << "\n";
+
+		for (std::size_t i = 0; i < sources.size(); ++i)
+		{
+			layout << sources[i].texture << " " << sources[i].filename << " " << files[i].bytes.size() << " " << files[i].hash
+				<< " " << positions[i].x << " " << positions[i].y << "\n";
+		}
+	}
+}
+
+void TextureAtlas::loadImages(ImageHolder& images, const std::vector<Source>& sources)
+{
+	std::vector<SourceFile> files;
+	FOREACH(const Source& source, sources)
+		files.push_back(readSource(source));
+
+	std::vector<sf::Vector2i> positions;
+	std::vector<std::unique_ptr<sf::Image>> decoded(sources.size());
+	std::unique_ptr<sf::Image> page(new sf::Image());
+
+	bool cached = readLayout(sources, files, positions) && page->loadFromFile(AtlasImageFile);
+	if (!cached)
+	{
+		std::vector<sf::Vector2u> sizes;
+		for (std::size_t i = 0; i < sources.size(); ++i)
+		{
+			decoded[i] = decodeSource(sources[i], files[i]);
+			sizes.push_back(decoded[i]->getSize());
+		}
+
+		// Narrowest power of two width that packs the most images
+		std::size_t bestPacked = 0;
+		unsigned int pageWidth = 0;
+		unsigned int pageHeight = 0;
+		for (unsigned int width = 256; width <= MaxPageSize; width *= 2)
+		{
+			std::vector<sf::Vector2i> candidate;
+			unsigned int height = packShelves(sizes, width, candidate);
+			std::size_t packed = std::count_if(candidate.begin(), candidate.end(), [](const sf::Vector2i& p) { return p.x >= 0; });
+
+			if (packed > bestPacked || (packed == bestPacked && packed > 0 && width * height < pageWidth * pageHeight))
+			{
+				bestPacked = packed;
+				pageWidth = width;
+				pageHeight = height;
+				positions = candidate;
+			}
+		}
+
+		if (bestPacked == 0)
+			positions.assign(sources.size(), sf::Vector2i(-1, -1));
+
+		page->create(std::max(pageWidth, 1u), std::max(pageHeight, 1u), sf::Color::Transparent);
+		for (std::size_t i = 0; i < sources.size(); ++i)
+		{
+			if (positions[i].x >= 0)
+				page->copy(*decoded[i], positions[i].x, positions[i].y);
+		}
+
+		// Cache failures only cost the packing again next time
+		if (page->saveToFile(AtlasImageFile))
+			writeLayout(sources, files, positions);
+
+		std::cout << "Textures: packed " << bestPacked << " of " << sources.size() << " images into a "
+			<< pageWidth << "x" << pageHeight << " atlas" << std::endl;
+	}
+
+	placements.clear();
+	for (std::size_t i = 0; i < sources.size(); ++i)
+	{
+		if (positions[i].x >= 0)
+			placements[sources[i].texture] = positions[i];
+		else
+			images.insert(sources[i].texture, decoded[i] ? std::move(decoded[i]) : decodeSource(sources[i], files[i]));
+	}
+
+	images.insert(Textures::Atlas, std::move(page));
+}
+
+bool TextureAtlas::contains(Textures::ID texture)
+{
+	return placements.find(texture) != placements.end();
+}
+
+sf::IntRect TextureAtlas::getRect(Textures::ID texture, const sf::IntRect& rect)
+{
+	auto found = placements.find(texture);
+	if (found == placements.end())
+		return rect;
+
+	return sf::IntRect(rect.left + found->second.x, rect.top + found->second.y, rect.width, rect.height);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ResourceIdentifiers.hpp"
+
+#include <SFML/Graphics/Rect.hpp>
+
+#include <vector>
+
+
+// Packs the images that entities draw sub-rectangles from into one texture, Textures::Atlas, so the
+// sprite batch can draw them together. The packed page and its layout are cached next to the
+// textures and reused while the source files are unchanged.
+namespace TextureAtlas
+{
+	struct Source
+	{
+		Textures::ID	texture;
+		const char*		filename;
+	};
+
+	// Decodes the sources, or the cached page, into images: Textures::Atlas holds the page, and any source
+	// too large to pack keeps its own image. Touches no graphics state, so it may run on any thread.
+	void				loadImages(ImageHolder& images, const std::vector<Source>& sources);
+
+	// Whether the texture was packed by the last loadImages()
+	bool				contains(Textures::ID texture);
+
+	// Where a rectangle of the texture lies in the atlas page; unchanged for textures that were not packed
+	sf::IntRect			getRect(Textures::ID texture, const sf::IntRect& rect);
+}
@@ -0,0 +1,40 @@
+#include "TripleBuffer.hpp"
+
+
+namespace
+{
+	const std::size_t IndexMask = 3;
+	const std::size_t Fresh = 4;
+}
+
+TripleBuffer::TripleBuffer()
+	: mWrite(0)
+	, mReady(1)
+	, mRead(2)
+{
+}
+
+std::size_t TripleBuffer::getWriteIndex() const
+{
+	return mWrite;
+}
+
+void TripleBuffer::publish()
+{
+	// Whatever was waiting comes back to be written again, read or not
+	mWrite = mReady.exchange(mWrite | Fresh, std::memory_order_acq_rel) & IndexMask;
+}
+
+bool TripleBuffer::acquire()
+{
+	if (!(mReady.load(std::memory_order_relaxed) & Fresh))
+		return false;
+
+	mRead = mReady.exchange(mRead, std::memory_order_acq_rel) & IndexMask;
+	return true;
+}
+
+std::size_t TripleBuffer::getReadIndex() const
+{
+	return mRead;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <SFML/System/NonCopyable.hpp>
+
+#include <atomic>
+#include <cstddef>
+
+
+// Hands buffers from exactly one producer thread to exactly one consumer thread without locks. The
+// caller owns an array of three buffers; this only tracks which index each side may use. The producer
+// always has a buffer to write, the consumer keeps reading its buffer until it acquires a newer one,
+// and a buffer published while another is still waiting replaces it.
+class TripleBuffer : private sf::NonCopyable
+{
+public:
+							TripleBuffer();
+
+	// Producer side
+	std::size_t				getWriteIndex() const;
+	void					publish();
+
+	// Consumer side; acquire() is false when nothing was published since the last call
+	bool					acquire();
+	std::size_t				getReadIndex() const;
+
+
+private:
+	std::size_t					mWrite;		// only touched by the producer
+	std::atomic<std::size_t>	mReady;		// index waiting to be read, with the Fresh bit set when published
+	std::size_t					mRead;		// only touched by the consumer
+};
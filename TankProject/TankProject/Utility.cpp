@@ -5,6 +5,7 @@
 #include <SFML/Graphics/Sprite.hpp>
 #include <SFML/Graphics/Text.hpp>
 
+#include <algorithm>
 #include <random>
 #include <cmath>
 #include <ctime>
@@ -164,12 +165,26 @@ float toRadian(float degree)
 	return 3.141592653589793238462643383f / 180.f * degree;
 }
 
+float angleDifference(float to, float from)
+{
+	float difference = std::fmod(to - from + 180.f, 360.f);
+	if (difference < 0.f)
+		difference += 360.f;
+
+	return difference - 180.f;
+}
+
 int randomInt(int exclusiveMax)
 {
 	std::uniform_int_distribution<> distr(0, exclusiveMax - 1);
 	return distr(RandomEngine);
 }
 
+std::default_random_engine& randomEngine()
+{
+	return RandomEngine;
+}
+
 float length(sf::Vector2f vector)
 {
 	return std::sqrt(vector.x * vector.x + vector.y * vector.y);
@@ -179,4 +194,19 @@ sf::Vector2f unitVector(sf::Vector2f vector)
 {
 	assert(vector != sf::Vector2f(0.f, 0.f));
 	return vector / length(vector);
-}
\ No newline at end of file
+}
+
+sf::FloatRect unite(const sf::FloatRect& lhs, const sf::FloatRect& rhs)
+{
+	if (lhs.width <= 0.f || lhs.height <= 0.f)
+		return rhs;
+	if (rhs.width <= 0.f || rhs.height <= 0.f)
+		return lhs;
+
+	float left = std::min(lhs.left, rhs.left);
+	float top = std::min(lhs.top, rhs.top);
+	float right = std::max(lhs.left + lhs.width, rhs.left + rhs.width);
+	float bottom = std::max(lhs.top + lhs.height, rhs.top + rhs.height);
+
+	return sf::FloatRect(left, top, right - left, bottom - top);
+}
@@ -1,7 +1,9 @@
 #pragma once
 #include <SFML/Window/Keyboard.hpp>
 #include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
 #include <sstream>
+#include <random>
 
 namespace sf
 {
@@ -28,12 +30,21 @@ void			centerOrigin(Animation& animation);
 float			toDegree(float radian);
 float			toRadian(float degree);
 
+// Signed shortest difference between two angles in degrees, in range [-180, 180)
+float			angleDifference(float to, float from);
+
 // Random number generation
 int				randomInt(int exclusiveMax);
 
+// The engine behind randomInt(), exposed so simulation state can be saved, restored and seeded
+std::default_random_engine&	randomEngine();
+
 // Vector operations
 float			length(sf::Vector2f vector);
 sf::Vector2f	unitVector(sf::Vector2f vector);
 
+// Smallest rectangle containing both; a rectangle without area contributes nothing
+sf::FloatRect	unite(const sf::FloatRect& lhs, const sf::FloatRect& rhs);
+
 
 #include "Utility.inl"
\ No newline at end of file
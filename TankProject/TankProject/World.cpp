@@ -11,8 +11,11 @@
 #include "SceneNode.hpp"
 #include "Base.hpp"
 #include "Collision.h"
+#include "WorldSnapshot.hpp"
+#include "TextureAtlas.hpp"
 
 #include <algorithm>
+#include <cassert>
 #include <cmath>
 
 #define _USE_MATH_DEFINES
@@ -25,10 +28,54 @@
 #define CLAMP(x, upper, lower) (fmin(upper, fmax(x, lower)))
 
 
+namespace
+{
+	// Side of the square cells the static geometry is split into for culling
+	const float StaticChunkSize = 512.f;
+
+	struct TextureFile
+	{
+		Textures::ID	id;
+		const char*		filename;
+	};
+
+	const std::vector<TextureFile> TextureFiles =
+	{
+		{ Textures::Desert, "Media/Textures/Desert.png" },
+		{ Textures::Explosion, "Media/Textures/Explosion.png" },
+		{ Textures::Particle, "Media/Textures/Particle.png" },
+		{ Textures::FinishLine, "Media/Textures/FinishLine.png" },
+	};
+
+	// Only ever drawn through data table sub-rectangles, so these share one atlas page. The textures above
+	// are repeated, animated or used whole and keep their own.
+	const std::vector<TextureAtlas::Source> AtlasFiles =
+	{
+		{ Textures::Entities, "Media/Textures/Entities.png" },
+		{ Textures::TankChassisEntities, "Media/Textures/EntitiesTankChassis.png" },
+		{ Textures::TankTurretEntities, "Media/Textures/EntitiesTankTurret.png" },
+		{ Textures::Obstacles, "Media/Textures/obstacles.png" },
+		{ Textures::Walls, "Media/Textures/hescoTexture.png" },
+		{ Textures::EnemyBase, "Media/Textures/base.png" },
+		{ Textures::LiberatorsBase, "Media/Textures/baseLiberator.png" },
+		{ Textures::ResistanceBase, "Media/Textures/baseResistance.png" },
+	};
+
+	std::unique_ptr<sf::Texture> createTexture(const ImageHolder& images, Textures::ID id, const char* filename)
+	{
+		std::unique_ptr<sf::Texture> texture(new sf::Texture());
+		if (!texture->loadFromImage(images.get(id)))
+			throw std::runtime_error("World::loadTextures - Failed to create texture from " + std::string(filename));
+
+		return texture;
+	}
+}
+
+
 
-World::World(sf::RenderTarget& outputTarget, FontHolder& fonts, SoundPlayer& sounds, bool networked)
+World::World(sf::RenderTarget& outputTarget, FontHolder& fonts, SoundPlayer& sounds, bool networked, const ImageHolder* images,
+	const GraphicsSettings& graphics)
 	: mTarget(outputTarget)
-	, mSceneTexture()
 	, mWorldView(outputTarget.getDefaultView())
 	, mTextures()
 	, mFonts(fonts)
@@ -45,22 +92,36 @@ World::World(sf::RenderTarget& outputTarget, FontHolder& fonts, SoundPlayer& sou
 	, mNetworkedWorld(networked)
 	, mNetworkNode(nullptr)
 	, mFinishSprite(nullptr)
+	, mStaticGeometry(nullptr)
+	, mRenderer()
 	, isBaseDestroyed(false)
+	, isResistanceBaseDestroyed(false)
+	, isLiberationBaseDestroyed(false)
+	, mSnapshotNodes()
 {
-	mSceneTexture.create(mTarget.getSize().x, mTarget.getSize().y);
+	mSnapshotNodes.reserve(WorldSnapshot::MaxProjectiles);
+
 
 	LiberatorKills = 0;
 	ResistanceKills = 0;
 
-	loadTextures();
+	loadTextures(images);
+	// Before the render thread starts drawing with the cache's texture
+	LabelNode::loadGlyphs(mFonts);
 	buildScene();
 	SpawnObstacles();
+	bakeObstacles();
 
 	//bool collisionSoundPlaying = false;
 	
 	//SpawnEnemyBase();
 	SpawnBase();
 
+	// Everything static lies within the background, which reaches a view height above the world
+	float viewHeight = mWorldView.getSize().y;
+	sf::FloatRect staticArea(mWorldBounds.left, mWorldBounds.top - viewHeight, mWorldBounds.width, mWorldBounds.height + viewHeight);
+	mRenderer.reset(new WorldRenderer(mTarget.getSize(), staticArea, graphics));
+
 	// Prepare the view
 	mWorldView.setCenter(mSpawnPosition);
 
@@ -132,19 +193,13 @@ void World::update(sf::Time dt)
 
 void World::draw()
 {
-	if (PostEffect::isSupported())
-	{
-		mSceneTexture.clear();
-		mSceneTexture.setView(mWorldView);
-		mSceneTexture.draw(mSceneGraph);
-		mSceneTexture.display();
-		mBloomEffect.apply(mSceneTexture, mTarget);
-	}
-	else
-	{
-		mTarget.setView(mWorldView);
-		mTarget.draw(mSceneGraph);
-	}
+	mRenderer->submit(mSceneGraph, mWorldView);
+	mRenderer->draw(mTarget);
+}
+
+std::size_t World::getDrawCalls() const
+{
+	return mRenderer->getDrawCalls();
 }
 
 CommandQueue& World::getCommandQueue()
@@ -206,6 +261,182 @@ bool World::pollGameAction(GameActions::Action& out)
 	return mNetworkNode->pollGameAction(out);
 }
 
+void World::saveSnapshot(WorldSnapshot& snapshot)
+{
+	snapshot.tankCount = 0;
+	FOREACH(Tank* tank, mPlayerTanks)
+	{
+		assert(snapshot.tankCount < WorldSnapshot::MaxTanks);
+		if (snapshot.tankCount < WorldSnapshot::MaxTanks)
+			tank->saveState(snapshot.tanks[snapshot.tankCount++]);
+	}
+
+	mSnapshotNodes.clear();
+	mSceneLayers[LowerAir]->collectChildren(Category::Projectile, mSnapshotNodes);
+	snapshot.projectileCount = 0;
+	FOREACH(SceneNode* node, mSnapshotNodes)
+	{
+		auto& projectile = static_cast<Projectile&>(*node);
+		if (projectile.isDestroyed())
+			continue;
+
+		assert(snapshot.projectileCount < WorldSnapshot::MaxProjectiles);
+		if (snapshot.projectileCount == WorldSnapshot::MaxProjectiles)
+			break;
+
+		ProjectileState& state = snapshot.projectiles[snapshot.projectileCount++];
+		state.type = projectile.getType();
+		state.position = projectile.getPosition();
+		state.rotation = projectile.getRotation();
+		state.velocity = projectile.getVelocity();
+		state.targetDirection = projectile.getTargetDirection();
+		state.hitpoints = projectile.getHitpoints();
+	}
+
+	// Pickups dropped by tanks go to the air layer, the ones the server spawns above the tanks
+	snapshot.pickupCount = 0;
+	const Layer pickupLayers[] = { LowerAir, UpperAir };
+	for (Layer layer : pickupLayers)
+	{
+		mSnapshotNodes.clear();
+		mSceneLayers[layer]->collectChildren(Category::Pickup, mSnapshotNodes);
+		FOREACH(SceneNode* node, mSnapshotNodes)
+		{
+			auto& pickup = static_cast<Pickup&>(*node);
+			if (pickup.isDestroyed())
+				continue;
+
+			assert(snapshot.pickupCount < WorldSnapshot::MaxPickups);
+			if (snapshot.pickupCount == WorldSnapshot::MaxPickups)
+				break;
+
+			PickupState& state = snapshot.pickups[snapshot.pickupCount++];
+			state.type = pickup.getType();
+			state.layer = layer;
+			state.position = pickup.getPosition();
+			state.velocity = pickup.getVelocity();
+		}
+	}
+
+	mSnapshotNodes.clear();
+	mSceneLayers[Background]->collectChildren(Category::Base, mSnapshotNodes);
+	snapshot.baseCount = 0;
+	FOREACH(SceneNode* node, mSnapshotNodes)
+	{
+		auto& base = static_cast<Base&>(*node);
+		assert(snapshot.baseCount < WorldSnapshot::MaxBases);
+		if (snapshot.baseCount == WorldSnapshot::MaxBases)
+			break;
+
+		snapshot.baseTypes[snapshot.baseCount] = base.mType;
+		snapshot.baseHitpoints[snapshot.baseCount++] = base.getHitpoints();
+	}
+
+	snapshot.commandCount = mCommandQueue.copyTo(snapshot.commands.data(), WorldSnapshot::MaxPendingCommands);
+	snapshot.random = randomEngine();
+	snapshot.liberatorKills = LiberatorKills;
+	snapshot.resistanceKills = ResistanceKills;
+	snapshot.baseDestroyed = isBaseDestroyed;
+	snapshot.resistanceBaseDestroyed = isResistanceBaseDestroyed;
+	snapshot.liberationBaseDestroyed = isLiberationBaseDestroyed;
+}
+
+void World::restoreSnapshot(const WorldSnapshot& snapshot)
+{
+	// Tanks keep their scene nodes where possible, since pending commands refer to them
+	bool recreatedTank = false;
+	for (std::size_t i = 0; i < snapshot.tankCount; ++i)
+	{
+		const TankState& state = snapshot.tanks[i];
+
+		Tank* tank = getTank(state.identifier);
+		if (!tank)
+		{
+			tank = addTank(state.identifier, static_cast<Tank::Type>(state.type));
+			recreatedTank = true;
+		}
+
+		tank->restoreState(state);
+	}
+
+	// Tanks that did not exist yet at the snapshot are taken out without an explosion
+	auto firstToRemove = std::remove_if(mPlayerTanks.begin(), mPlayerTanks.end(), [&snapshot] (Tank* tank)
+	{
+		for (std::size_t i = 0; i < snapshot.tankCount; ++i)
+		{
+			if (snapshot.tanks[i].identifier == tank->getIdentifier())
+				return false;
+		}
+
+		tank->remove();
+		return true;
+	});
+	mPlayerTanks.erase(firstToRemove, mPlayerTanks.end());
+
+	// Projectiles and pickups carry no references, replace them all
+	mSnapshotNodes.clear();
+	mSceneLayers[LowerAir]->collectChildren(Category::Projectile | Category::Pickup, mSnapshotNodes);
+	mSceneLayers[UpperAir]->collectChildren(Category::Pickup, mSnapshotNodes);
+	FOREACH(SceneNode* node, mSnapshotNodes)
+		static_cast<Entity&>(*node).remove();
+	mSceneGraph.removeWrecks();
+
+	for (std::size_t i = 0; i < snapshot.projectileCount; ++i)
+	{
+		const ProjectileState& state = snapshot.projectiles[i];
+
+		std::unique_ptr<Projectile> projectile(new Projectile(static_cast<Projectile::Type>(state.type), mTextures));
+		projectile->setPosition(state.position);
+		projectile->setRotation(state.rotation);
+		projectile->setVelocity(state.velocity);
+		projectile->setTargetDirection(state.targetDirection);
+		projectile->restoreHitpoints(state.hitpoints);
+		mSceneLayers[LowerAir]->attachChild(std::move(projectile));
+	}
+
+	for (std::size_t i = 0; i < snapshot.pickupCount; ++i)
+	{
+		const PickupState& state = snapshot.pickups[i];
+
+		std::unique_ptr<Pickup> pickup(new Pickup(static_cast<Pickup::Type>(state.type), mTextures));
+		pickup->setPosition(state.position);
+		pickup->setVelocity(state.velocity);
+		mSceneLayers[state.layer]->attachChild(std::move(pickup));
+	}
+
+	// Bases are never recreated, a destroyed one ends the match
+	mSnapshotNodes.clear();
+	mSceneLayers[Background]->collectChildren(Category::Base, mSnapshotNodes);
+	FOREACH(SceneNode* node, mSnapshotNodes)
+	{
+		auto& base = static_cast<Base&>(*node);
+		for (std::size_t i = 0; i < snapshot.baseCount; ++i)
+		{
+			if (snapshot.baseTypes[i] == base.mType)
+				base.restoreHitpoints(snapshot.baseHitpoints[i]);
+		}
+	}
+
+	// Pending commands may capture tanks that were just recreated; they are dropped in that case
+	mCommandQueue.clear();
+	if (recreatedTank)
+	{
+		std::cout << "Rollback: discarded " << snapshot.commandCount << " pending commands of a removed tank" << std::endl;
+	}
+	else
+	{
+		for (std::size_t i = 0; i < snapshot.commandCount; ++i)
+			mCommandQueue.push(snapshot.commands[i]);
+	}
+
+	randomEngine() = snapshot.random;
+	LiberatorKills = snapshot.liberatorKills;
+	ResistanceKills = snapshot.resistanceKills;
+	isBaseDestroyed = snapshot.baseDestroyed;
+	isResistanceBaseDestroyed = snapshot.resistanceBaseDestroyed;
+	isLiberationBaseDestroyed = snapshot.liberationBaseDestroyed;
+}
+
 void World::setCurrentBattleFieldPosition(float lineY)
 {
 	mWorldView.setCenter(mWorldView.getCenter().x, lineY - mWorldView.getSize().y / 2);
@@ -237,20 +468,35 @@ bool World::hasLiberationBaseBeenDestroyed() const
 	return isLiberationBaseDestroyed;
 }
 
-void World::loadTextures()
+void World::loadImages(ImageHolder& images)
+{
+	FOREACH(const TextureFile& file, TextureFiles)
+		images.load(file.id, file.filename);
+
+	TextureAtlas::loadImages(images, AtlasFiles);
+}
+
+void World::loadTextures(const ImageHolder* images)
 {
-	mTextures.load(Textures::Entities, "Media/Textures/Entities.png");
-	mTextures.load(Textures::TankChassisEntities, "Media/Textures/EntitiesTankChassis.png");
-	mTextures.load(Textures::TankTurretEntities, "Media/Textures/EntitiesTankTurret.png");
-	mTextures.load(Textures::Desert, "Media/Textures/Desert.png");
-	mTextures.load(Textures::Explosion, "Media/Textures/Explosion.png");
-	mTextures.load(Textures::Particle, "Media/Textures/Particle.png");
-	mTextures.load(Textures::FinishLine, "Media/Textures/FinishLine.png");
-	mTextures.load(Textures::Obstacles, "Media/Textures/obstacles.png"); 
-	mTextures.load(Textures::Walls, "Media/Textures/hescoTexture.png");
-	mTextures.load(Textures::EnemyBase, "Media/Textures/base.png");
-	mTextures.load(Textures::LiberatorsBase, "Media/Textures/baseLiberator.png");
-	mTextures.load(Textures::ResistanceBase, "Media/Textures/baseResistance.png");
+	// Not decoded ahead of time: do it now
+	ImageHolder decoded;
+	if (!images)
+	{
+		loadImages(decoded);
+		images = &decoded;
+	}
+
+	FOREACH(const TextureFile& file, TextureFiles)
+		mTextures.insert(file.id, createTexture(*images, file.id, file.filename));
+
+	mTextures.insert(Textures::Atlas, createTexture(*images, Textures::Atlas, "Media/Textures/Atlas.png"));
+	FOREACH(const TextureAtlas::Source& source, AtlasFiles)
+	{
+		if (TextureAtlas::contains(source.texture))
+			mTextures.share(source.texture, Textures::Atlas);
+		else
+			mTextures.insert(source.texture, createTexture(*images, source.texture, source.filename));
+	}
 }
 
 void World::adaptTankPositions()
@@ -585,6 +831,11 @@ void World::buildScene()
 		mSceneGraph.attachChild(std::move(layer));
 	}
 
+	// Static geometry goes first, beneath everything else on the background layer
+	std::unique_ptr<StaticGeometryNode> staticGeometry(new StaticGeometryNode(StaticChunkSize));
+	mStaticGeometry = staticGeometry.get();
+	mSceneLayers[Background]->attachChild(std::move(staticGeometry));
+
 	// Prepare the tiled background
 	sf::Texture& desertTexture = mTextures.get(Textures::Desert);
 	desertTexture.setRepeated(true);
@@ -593,10 +844,10 @@ void World::buildScene()
 	sf::IntRect textureRect(mWorldBounds);
 	textureRect.height += static_cast<int>(viewHeight);
 
-	// Add the background sprite to the scene
-	std::unique_ptr<SpriteNode> desertBackground(new SpriteNode(desertTexture, textureRect));
-	desertBackground->setPosition(mWorldBounds.left, mWorldBounds.top - viewHeight);
-	mSceneLayers[Background]->attachChild(std::move(desertBackground));
+	// Bake the background sprite into the static geometry
+	sf::Sprite desertBackground(desertTexture, textureRect);
+	desertBackground.setPosition(mWorldBounds.left, mWorldBounds.top - viewHeight);
+	mStaticGeometry->addSprite(desertBackground, sf::Transform::Identity);
 
 	// Add the finish line to the scene
 	//sf::Texture& finishTexture = mTextures.get(Textures::FinishLine);
@@ -779,6 +1030,16 @@ void World::SpawnObstacles()
 
 }
 
+void World::bakeObstacles()
+{
+	// Obstacles never move or change, so the static geometry draws them from now on
+	std::vector<SceneNode*> obstacles;
+	mSceneLayers[Background]->collectChildren(Category::Obstacle, obstacles);
+
+	FOREACH(SceneNode* node, obstacles)
+		static_cast<Obstacle*>(node)->bakeInto(*mStaticGeometry);
+}
+
 void World::PlaceObstacle(Obstacle::ObType obstacleType, sf::Vector2f obstaclePosition)
 {
 	std::unique_ptr<Obstacle> ob1(new Obstacle(obstacleType, mTextures)); //creates a pointer to an Obstacle object with a random texture
@@ -3,20 +3,24 @@
 #include "ResourceIdentifiers.hpp"
 #include "SceneNode.hpp"
 #include "SpriteNode.hpp"
+#include "TextNode.hpp"
+#include "StaticGeometryNode.hpp"
+#include "WorldRenderer.hpp"
 #include "Tank.hpp"
 #include "Tank.hpp"
 #include "Obstacle.hpp"
 #include "CommandQueue.hpp"
 #include "Command.hpp"
 #include "Pickup.hpp"
-#include "BloomEffect.hpp"
 #include "SoundPlayer.hpp"
 #include "NetworkProtocol.hpp"
 #include "Base.hpp"
+#include "GraphicsSettings.hpp"
 
 #include <SFML/System/NonCopyable.hpp>
 #include <SFML/Graphics/View.hpp>
 #include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Image.hpp>
 
 #include <array>
 #include <queue>
@@ -29,13 +33,20 @@ namespace sf
 
 class NetworkNode;
 class Base;
+struct WorldSnapshot;
 
 class World : private sf::NonCopyable
 {
 public:
-	explicit World(sf::RenderTarget& window, FontHolder& font, SoundPlayer& sounds, bool networked = false);
+	explicit World(sf::RenderTarget& window, FontHolder& font, SoundPlayer& sounds, bool networked = false, const ImageHolder* images = nullptr,
+		const GraphicsSettings& graphics = GraphicsSettings());
+
+	// Decodes the world's texture files; touches no graphics state, so it may run on any thread
+	static void loadImages(ImageHolder& images);
 	void update(sf::Time dt);
 	void draw();
+	// Draw calls the last draw() took
+	std::size_t getDrawCalls() const;
 
 	float LiberatorKills;
 	float ResistanceKills;
@@ -70,8 +81,12 @@ public:
 	void createPickup(sf::Vector2f position, Pickup::Type type);
 	bool pollGameAction(GameActions::Action& out);
 
+	// Save or restore the complete simulation state, used by rollback netcode. Saving does not allocate.
+	void saveSnapshot(WorldSnapshot& snapshot);
+	void restoreSnapshot(const WorldSnapshot& snapshot);
+
 private:
-	void loadTextures();
+	void loadTextures(const ImageHolder* images);
 	void adaptTankPositions();
 	void adaptPlayerVelocity();
 	void handleCollisions();
@@ -84,6 +99,7 @@ private:
 	void SpawnBaseWalls(); //spawns walls
 	Obstacle::ObType getRandomObstacle();
 	void PlaceObstacle(Obstacle::ObType obstacleType, sf::Vector2f obstaclePosition);
+	void bakeObstacles(); //moves obstacles into the static geometry
 	void SpawnEnemyBase();
 	void buildScene();
 	void addEnemies(int enemyCount);
@@ -128,7 +144,6 @@ private:
 
 private:
 	sf::RenderTarget&					mTarget;
-	sf::RenderTexture					mSceneTexture;
 	sf::View							mWorldView;
 	TextureHolder						mTextures;
 	FontHolder&							mFonts;
@@ -153,14 +168,17 @@ private:
 	//sf::Vertex							line[100];
 	//bool								circleSetUp = false;
 
-	BloomEffect							mBloomEffect;
-
 	bool								mNetworkedWorld;
 	NetworkNode*						mNetworkNode;
 	SpriteNode*							mFinishSprite;
+	StaticGeometryNode*					mStaticGeometry;
+	std::unique_ptr<WorldRenderer>		mRenderer;
 
 	bool								isBaseDestroyed;
 	bool								isResistanceBaseDestroyed;
 	bool								isLiberationBaseDestroyed;
+
+	// Scratch list for gathering scene nodes while saving or restoring snapshots
+	std::vector<SceneNode*>				mSnapshotNodes;
 };
 
@@ -0,0 +1,191 @@
+#include "WorldRenderer.hpp"
+#include "SceneNode.hpp"
+#include "BloomEffect.hpp"
+#include "StaticLayerCache.hpp"
+#include "Foreach.hpp"
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+#include <SFML/OpenGL.hpp>
+
+#include <algorithm>
+
+
+namespace
+{
+	// How long the render thread rests when no new list is waiting
+	const sf::Time IdleTime = sf::milliseconds(1);
+}
+
+WorldRenderer::WorldRenderer(sf::Vector2u frameSize, const sf::FloatRect& staticArea, const GraphicsSettings& graphics)
+	: mFrameSize(frameSize)
+	, mStaticArea(staticArea)
+	, mGraphics(graphics)
+	, mLists()
+	, mListBuffer()
+	, mFrame(0)
+	, mCollectedChanges()
+	, mStaticChanges()
+	, mFrames()
+	, mFrameBuffer()
+	, mHasFrame(false)
+	, mRunning(true)
+	, mStaticCacheAvailable(true)
+	, mRenderedFrame(0)
+	, mDrawCalls(0)
+	, mThread(&WorldRenderer::run, this)
+{
+	// The first frame renders the whole static layer
+	StaticChange change;
+	change.pixels = StaticLayerCache::getPixels(staticArea, staticArea);
+	change.frame = 1;
+	mStaticChanges.push_back(change);
+
+	mThread.launch();
+}
+
+WorldRenderer::~WorldRenderer()
+{
+	mRunning = false;
+	mThread.wait();
+}
+
+void WorldRenderer::submit(const SceneNode& scene, const sf::View& view)
+{
+	++mFrame;
+
+	// Changes carried by a frame that was rendered are in the cache now
+	std::size_t renderedFrame = mRenderedFrame.load(std::memory_order_acquire);
+	mStaticChanges.erase(std::remove_if(mStaticChanges.begin(), mStaticChanges.end(),
+		[renderedFrame](const StaticChange& change) { return change.frame <= renderedFrame; }), mStaticChanges.end());
+
+	mCollectedChanges.clear();
+	scene.collectStaticChanges(mCollectedChanges);
+	FOREACH(const sf::FloatRect& rect, mCollectedChanges)
+	{
+		StaticChange change;
+		change.pixels = StaticLayerCache::getPixels(mStaticArea, rect);
+		change.frame = mFrame;
+
+		if (change.pixels.width > 0 && change.pixels.height > 0)
+			mStaticChanges.push_back(change);
+	}
+
+	RenderList& list = mLists[mListBuffer.getWriteIndex()];
+	list.clear();
+	list.setFrame(mFrame);
+	list.setView(view);
+	list.setBloomEnabled(PostEffect::isSupported());
+
+	sf::FloatRect viewBounds(view.getCenter() - view.getSize() / 2.f, view.getSize());
+	bool cached = mStaticCacheAvailable.load(std::memory_order_relaxed);
+	list.setStaticCached(cached);
+
+	if (cached)
+	{
+		// Every change not known to be rendered yet goes in, as lists can be replaced before they are read
+		FOREACH(const StaticChange& change, mStaticChanges)
+		{
+			SpriteBatch& batch = list.addStaticUpdate(change.pixels);
+			scene.drawBatched(batch, StaticLayerCache::getArea(mStaticArea, change.pixels), sf::RenderStates::Default, SceneNode::StaticNodes);
+		}
+
+		scene.drawBatched(list.getScene(), viewBounds, sf::RenderStates::Default, SceneNode::DynamicNodes);
+	}
+	else
+	{
+		scene.drawBatched(list.getScene(), viewBounds, sf::RenderStates::Default);
+	}
+
+	mListBuffer.publish();
+}
+
+void WorldRenderer::draw(sf::RenderTarget& target)
+{
+	if (mFrameBuffer.acquire())
+		mHasFrame = true;
+
+	if (!mHasFrame)
+		return;
+
+	// Frames are the size of the target and cover all of it
+	target.setView(target.getDefaultView());
+	target.draw(sf::Sprite(mFrames[mFrameBuffer.getReadIndex()].getTexture()), sf::BlendNone);
+}
+
+std::size_t WorldRenderer::getDrawCalls() const
+{
+	return mDrawCalls.load(std::memory_order_relaxed);
+}
+
+void WorldRenderer::run()
+{
+	sf::RenderTexture sceneTexture;
+	sceneTexture.create(mFrameSize.x, mFrameSize.y);
+
+	BloomEffect bloom;
+	bloom.setQuality(mGraphics.bloomQuality);
+	bloom.setAdaptive(mGraphics.bloomAdaptive);
+	StaticLayerCache cache(mStaticArea);
+	mStaticCacheAvailable.store(cache.isAvailable(), std::memory_order_relaxed);
+
+	for (std::size_t i = 0; i < mFrames.size(); ++i)
+		mFrames[i].create(mFrameSize.x, mFrameSize.y);
+
+	sf::Clock renderClock;
+
+	while (mRunning)
+	{
+		if (!mListBuffer.acquire())
+		{
+			sf::sleep(IdleTime);
+			continue;
+		}
+
+		const RenderList& list = mLists[mListBuffer.getReadIndex()];
+		sf::RenderTexture& frame = mFrames[mFrameBuffer.getWriteIndex()];
+
+		renderClock.restart();
+		render(list, frame, sceneTexture, bloom, cache);
+		frame.display();
+
+		// The simulation thread draws the frame from its own context, so it has to be complete first
+		glFinish();
+		bloom.reportFrameTime(renderClock.getElapsedTime());
+
+		mFrameBuffer.publish();
+		mRenderedFrame.store(list.getFrame(), std::memory_order_release);
+	}
+
+	// The frames outlive this thread, their contexts must not stay active on it
+	for (std::size_t i = 0; i < mFrames.size(); ++i)
+		mFrames[i].setActive(false);
+}
+
+void WorldRenderer::render(const RenderList& list, sf::RenderTarget& frame, sf::RenderTexture& sceneTexture, BloomEffect& bloom, StaticLayerCache& cache)
+{
+	bool bloomed = list.isBloomEnabled() && bloom.getQuality() != BloomEffect::Off;
+	sf::RenderTarget& target = bloomed ? static_cast<sf::RenderTarget&>(sceneTexture) : frame;
+
+	target.clear();
+	target.setView(list.getView());
+
+	std::size_t drawCalls = list.getScene().getDrawCalls();
+	if (list.isStaticCached() && cache.isAvailable())
+	{
+		cache.draw(target, list);
+		drawCalls += cache.getDrawCalls();
+	}
+
+	list.getScene().submit(target);
+
+	if (bloomed)
+	{
+		sceneTexture.display();
+		frame.setView(frame.getDefaultView());
+		bloom.apply(sceneTexture, frame);
+	}
+
+	mDrawCalls.store(drawCalls, std::memory_order_relaxed);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "RenderList.hpp"
+#include "TripleBuffer.hpp"
+#include "GraphicsSettings.hpp"
+
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Thread.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/RenderTexture.hpp>
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+
+class SceneNode;
+class BloomEffect;
+class StaticLayerCache;
+
+// Draws the world on its own thread. The simulation records each frame into a render list and goes on
+// with the next tick; the render thread submits the newest list into an off-screen frame, with the
+// static layer cache and bloom, and the simulation thread shows the newest finished frame. Lists and
+// frames change hands through triple buffers, so neither thread waits for the other. Every graphics
+// object the render thread draws with is created on that thread.
+class WorldRenderer : private sf::NonCopyable
+{
+public:
+							WorldRenderer(sf::Vector2u frameSize, const sf::FloatRect& staticArea, const GraphicsSettings& graphics);
+							~WorldRenderer();
+
+	// Simulation side: records the scene as seen through the view and hands it over
+	void					submit(const SceneNode& scene, const sf::View& view);
+	// Simulation side: draws the newest finished frame, nothing until the first one is done
+	void					draw(sf::RenderTarget& target);
+
+	// Draw calls the render thread took for its last frame
+	std::size_t				getDrawCalls() const;
+
+
+private:
+	// Part of the static layer changed in a frame, recorded again until a frame at least as new is rendered
+	struct StaticChange
+	{
+		sf::IntRect			pixels;
+		std::size_t			frame;
+	};
+
+
+private:
+	void					run();
+	void					render(const RenderList& list, sf::RenderTarget& frame, sf::RenderTexture& sceneTexture, BloomEffect& bloom, StaticLayerCache& cache);
+
+
+private:
+	sf::Vector2u				mFrameSize;
+	sf::FloatRect				mStaticArea;
+	GraphicsSettings			mGraphics;
+
+	std::array<RenderList, 3>	mLists;
+	TripleBuffer				mListBuffer;
+	std::size_t					mFrame;
+	std::vector<sf::FloatRect>	mCollectedChanges;
+	std::vector<StaticChange>	mStaticChanges;
+
+	std::array<sf::RenderTexture, 3>	mFrames;
+	TripleBuffer				mFrameBuffer;
+	bool						mHasFrame;
+
+	std::atomic<bool>			mRunning;
+	std::atomic<bool>			mStaticCacheAvailable;
+	std::atomic<std::size_t>	mRenderedFrame;
+	std::atomic<std::size_t>	mDrawCalls;
+	sf::Thread					mThread;
+};
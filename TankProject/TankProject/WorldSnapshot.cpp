@@ -0,0 +1,131 @@
+#include "WorldSnapshot.hpp"
+
+#include <iomanip>
+
+
+namespace
+{
+	// FNV-1a, 32 bit
+	const sf::Uint32 FnvOffsetBasis = 2166136261u;
+	const sf::Uint32 FnvPrime = 16777619u;
+
+	void hashBytes(sf::Uint32& hash, const void* data, std::size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= FnvPrime;
+		}
+	}
+
+	// Fields are hashed one by one, so struct padding never ends up in the checksum
+	template <typename T>
+	void hash(sf::Uint32& value, const T& field)
+	{
+		hashBytes(value, &field, sizeof(field));
+	}
+
+	void hash(sf::Uint32& value, sf::Vector2f vector)
+	{
+		hash(value, vector.x);
+		hash(value, vector.y);
+	}
+
+	void hash(sf::Uint32& value, sf::Time time)
+	{
+		hash(value, time.asMicroseconds());
+	}
+}
+
+sf::Uint32 computeChecksum(const WorldSnapshot& snapshot)
+{
+	sf::Uint32 value = FnvOffsetBasis;
+
+	hash(value, static_cast<sf::Uint32>(snapshot.tankCount));
+	for (std::size_t i = 0; i < snapshot.tankCount; ++i)
+	{
+		const TankState& tank = snapshot.tanks[i];
+		hash(value, tank.identifier);
+		hash(value, tank.type);
+		hash(value, tank.position);
+		hash(value, tank.rotation);
+		hash(value, tank.velocity);
+		hash(value, tank.turretRotation);
+		hash(value, tank.turretRotationVelocity);
+		hash(value, tank.hitpoints);
+		hash(value, tank.ammoCount);
+		hash(value, tank.missileAmmo);
+		hash(value, tank.fireCountdown);
+		hash(value, tank.fireRateLevel);
+		hash(value, tank.speedBoostCountdown);
+		hash(value, tank.speedBoostMultiplier);
+	}
+
+	hash(value, static_cast<sf::Uint32>(snapshot.projectileCount));
+	for (std::size_t i = 0; i < snapshot.projectileCount; ++i)
+	{
+		const ProjectileState& projectile = snapshot.projectiles[i];
+		hash(value, projectile.type);
+		hash(value, projectile.position);
+		hash(value, projectile.rotation);
+		hash(value, projectile.velocity);
+	}
+
+	hash(value, static_cast<sf::Uint32>(snapshot.pickupCount));
+	for (std::size_t i = 0; i < snapshot.pickupCount; ++i)
+	{
+		const PickupState& pickup = snapshot.pickups[i];
+		hash(value, pickup.type);
+		hash(value, pickup.layer);
+		hash(value, pickup.position);
+	}
+
+	for (std::size_t i = 0; i < snapshot.baseCount; ++i)
+		hash(value, snapshot.baseHitpoints[i]);
+
+	// Random engines hold only their state words, which are copied along with the snapshot
+	hash(value, snapshot.random);
+
+	hash(value, snapshot.liberatorKills);
+	hash(value, snapshot.resistanceKills);
+
+	return value;
+}
+
+void writeSnapshot(std::ostream& out, const WorldSnapshot& snapshot)
+{
+	out << std::setprecision(9);
+	out << "checksum " << computeChecksum(snapshot) << "\n";
+	out << "random " << snapshot.random << "\n";
+	out << "kills " << snapshot.liberatorKills << " " << snapshot.resistanceKills << "\n";
+
+	for (std::size_t i = 0; i < snapshot.tankCount; ++i)
+	{
+		const TankState& tank = snapshot.tanks[i];
+		out << "tank " << tank.identifier << " type " << tank.type
+			<< " pos " << tank.position.x << " " << tank.position.y << " rot " << tank.rotation
+			<< " vel " << tank.velocity.x << " " << tank.velocity.y
+			<< " turret " << tank.turretRotation << " " << tank.turretRotationVelocity
+			<< " hp " << tank.hitpoints << " ammo " << tank.ammoCount << " missiles " << tank.missileAmmo
+			<< " fire " << tank.fireCountdown.asMicroseconds() << " " << tank.fireRateLevel
+			<< " boost " << tank.speedBoostCountdown.asMicroseconds() << " " << tank.speedBoostMultiplier << "\n";
+	}
+
+	for (std::size_t i = 0; i < snapshot.projectileCount; ++i)
+	{
+		const ProjectileState& projectile = snapshot.projectiles[i];
+		out << "projectile type " << projectile.type
+			<< " pos " << projectile.position.x << " " << projectile.position.y << " rot " << projectile.rotation
+			<< " vel " << projectile.velocity.x << " " << projectile.velocity.y << "\n";
+	}
+
+	for (std::size_t i = 0; i < snapshot.pickupCount; ++i)
+	{
+		const PickupState& pickup = snapshot.pickups[i];
+		out << "pickup type " << pickup.type << " layer " << pickup.layer << " pos " << pickup.position.x << " " << pickup.position.y << "\n";
+	}
+
+	for (std::size_t i = 0; i < snapshot.baseCount; ++i)
+		out << "base " << snapshot.baseTypes[i] << " hp " << snapshot.baseHitpoints[i] << "\n";
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Command.hpp"
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/Config.hpp>
+
+#include <array>
+#include <random>
+#include <ostream>
+
+
+// Everything Tank::restoreState() needs to put a tank back exactly as it was
+struct TankState
+{
+	sf::Int32				identifier;
+	int						type;
+	sf::Vector2f			position;
+	float					rotation;
+	sf::Vector2f			velocity;
+	float					turretRotation;
+	float					turretRotationVelocity;
+	bool					turretRotating;
+	sf::Int32				hitpoints;
+	sf::Int32				ammoCount;
+	sf::Int32				missileAmmo;
+	sf::Time				fireCountdown;
+	bool					isFiring;
+	sf::Int32				fireRateLevel;
+	bool					hasSpeedBoost;
+	sf::Time				speedBoostCountdown;
+	float					speedBoostMultiplier;
+	bool					spawnedPickup;
+	bool					explosionBegan;
+};
+
+struct ProjectileState
+{
+	int						type;
+	sf::Vector2f			position;
+	float					rotation;
+	sf::Vector2f			velocity;
+	sf::Vector2f			targetDirection;
+	sf::Int32				hitpoints;
+};
+
+struct PickupState
+{
+	int						type;
+	int						layer;			// World::Layer the pickup is attached to
+	sf::Vector2f			position;
+	sf::Vector2f			velocity;
+};
+
+// Full simulation state of a World at a frame boundary, stored in fixed-size arrays so that taking
+// a snapshot into an existing object never allocates. The sizes are meant never to be reached; a world
+// with more asserts when it is saved. Visual-only state (particles, explosion
+// animations, sounds) is not part of it.
+struct WorldSnapshot
+{
+	static const std::size_t	MaxTanks = 16;
+	static const std::size_t	MaxProjectiles = 256;
+	static const std::size_t	MaxPickups = 32;
+	static const std::size_t	MaxBases = 4;
+	static const std::size_t	MaxPendingCommands = 64;
+
+	std::size_t										tankCount;
+	std::array<TankState, MaxTanks>					tanks;
+
+	std::size_t										projectileCount;
+	std::array<ProjectileState, MaxProjectiles>		projectiles;
+
+	std::size_t										pickupCount;
+	std::array<PickupState, MaxPickups>				pickups;
+
+	std::size_t										baseCount;
+	std::array<int, MaxBases>						baseTypes;
+	std::array<sf::Int32, MaxBases>					baseHitpoints;
+
+	// Commands queued by the last update, e.g. projectile launches, that run at the start of the next
+	std::size_t										commandCount;
+	std::array<Command, MaxPendingCommands>			commands;
+
+	std::default_random_engine						random;
+	float											liberatorKills;
+	float											resistanceKills;
+	bool											baseDestroyed;
+	bool											resistanceBaseDestroyed;
+	bool											liberationBaseDestroyed;
+};
+
+// Hash of everything in the snapshot that the simulation depends on (pending commands excluded),
+// for peers to compare their worlds cheaply
+sf::Uint32		computeChecksum(const WorldSnapshot& snapshot);
+
+// Human-readable listing of a snapshot, for comparing the dumps of two peers after a desync
+void			writeSnapshot(std::ostream& out, const WorldSnapshot& snapshot);
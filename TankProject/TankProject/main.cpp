@@ -1,12 +1,58 @@
 #include "Application.hpp"
+#include "ServerReplay.hpp"
+#include "InterpolationReplay.hpp"
+#include "RollbackBenchmark.hpp"
+#include "SchemaCheck.hpp"
 
 #include <stdexcept>
 #include <iostream>
+#include <string>
 
-int main()
+int main(int argc, char* argv[])
 {
 	try {
-		Application app;
+		// Tool mode: TankProject --replay capture.bin [--fast]
+		if (argc >= 3 && std::string(argv[1]) == "--replay")
+			return runServerReplay(argv[2], !(argc >= 4 && std::string(argv[3]) == "--fast"));
+
+		// Tool mode: TankProject --interpolation trace.txt [stallTicks stallInterval]
+		if (argc >= 3 && std::string(argv[1]) == "--interpolation")
+		{
+			unsigned int stallTicks = argc >= 5 ? std::stoul(argv[3]) : 0;
+			unsigned int stallInterval = argc >= 5 ? std::stoul(argv[4]) : 0;
+			return runInterpolationReplay(argv[2], stallTicks, stallInterval);
+		}
+
+		// Tool mode: TankProject --rollback-benchmark [rollbacks [extraTanks]]
+		if (argc >= 2 && std::string(argv[1]) == "--rollback-benchmark")
+		{
+			unsigned int rollbacks = argc >= 3 ? std::stoul(argv[2]) : 200;
+			unsigned int extraTanks = argc >= 4 ? std::stoul(argv[3]) : 6;
+			return runRollbackBenchmark(rollbacks, extraTanks);
+		}
+
+		// Tool mode: TankProject --schema-check
+		if (argc >= 2 && std::string(argv[1]) == "--schema-check")
+			return runSchemaCheck();
+
+		// TankProject --bloom off|low|high: bloom at a fixed quality instead of adapting to the frame time
+		GraphicsSettings graphics;
+		if (argc >= 3 && std::string(argv[1]) == "--bloom")
+		{
+			std::string quality = argv[2];
+			if (quality == "off")
+				graphics.bloomQuality = BloomEffect::Off;
+			else if (quality == "low")
+				graphics.bloomQuality = BloomEffect::Low;
+			else if (quality == "high")
+				graphics.bloomQuality = BloomEffect::High;
+			else
+				throw std::runtime_error("Unknown bloom quality " + quality);
+
+			graphics.bloomAdaptive = false;
+		}
+
+		Application app(graphics);
 		app.run();
 	}
 	catch (std::exception& e)
@@ -14,4 +60,4 @@ int main()
 		std::cout << "Exception: " << e.what() << std::endl;
 		std::cin.ignore();
 	}
-}
\ No newline at end of file
+}
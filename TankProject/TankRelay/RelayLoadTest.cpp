@@ -0,0 +1,215 @@
+#include "RelayLoadTest.hpp"
+#include "SpectatorRelay.hpp"
+#include "GameServer.hpp"
+#include "NetworkMessages.hpp"
+#include "Foreach.hpp"
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+#include <SFML/Network/Packet.hpp>
+#include <SFML/Network/TcpSocket.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+
+namespace
+{
+	// Away from the default ports, so a test can run next to a real server
+	const unsigned short LoadTestServerPort = ServerPort + 100;
+	const unsigned short LoadTestRelayPort = ServerPort + 101;
+
+	const sf::Time ConnectTimeout = sf::seconds(5.f);
+	const sf::Time PingInterval = sf::seconds(1.f);
+
+	struct SimulatedClient
+	{
+		SimulatedClient()
+			: socket(), packets(0), bytes(0), delaySamples(0), totalDelay(sf::Time::Zero), worstDelay(sf::Time::Zero), disconnected(false)
+		{
+		}
+
+		sf::TcpSocket			socket;
+		sf::Uint64				packets;
+		sf::Uint64				bytes;
+		std::size_t				delaySamples;
+		sf::Time				totalDelay;
+		sf::Time				worstDelay;
+		bool					disconnected;
+	};
+
+	typedef std::unique_ptr<SimulatedClient> ClientPtr;
+
+	bool connectClient(SimulatedClient& client, unsigned short port)
+	{
+		if (client.socket.connect(sf::IpAddress::LocalHost, port, ConnectTimeout) != sf::Socket::Done)
+			return false;
+
+		sf::Packet packet = Schema::makePacket(JoinMessage());
+		client.socket.send(packet);
+		client.socket.setBlocking(false);
+		return true;
+	}
+
+	// Calls onSnapshot(serverTick) for each UpdateClientState received
+	template <typename Function>
+	void pollClient(SimulatedClient& client, Function onSnapshot)
+	{
+		sf::Packet packet;
+		sf::Socket::Status status;
+
+		while ((status = client.socket.receive(packet)) == sf::Socket::Done)
+		{
+			client.packets++;
+			client.bytes += packet.getDataSize();
+
+			sf::Int32 packetType;
+			UpdateClientStateMessage snapshot;
+			if (packet >> packetType && packetType == UpdateClientStateMessage::Type && Schema::decode(packet, snapshot))
+				onSnapshot(snapshot.serverTick);
+
+			packet.clear();
+		}
+
+		if (status == sf::Socket::Disconnected || status == sf::Socket::Error)
+			client.disconnected = true;
+	}
+}
+
+int runRelayLoadTest(std::size_t spectatorCount, std::size_t playerCount, sf::Time duration, sf::Time delay)
+{
+	std::cout << "Load test: " << spectatorCount << " spectators, " << playerCount << " players, "
+		<< duration.asSeconds() << "s with " << delay.asSeconds() << "s delay" << std::endl;
+
+	GameServer::Settings serverSettings;
+	serverSettings.port = LoadTestServerPort;
+	serverSettings.maxPlayers = playerCount + 1;
+	GameServer server(serverSettings);
+
+	SpectatorRelay::Settings relaySettings;
+	relaySettings.serverPort = LoadTestServerPort;
+	relaySettings.port = LoadTestRelayPort;
+	relaySettings.delay = delay;
+	relaySettings.maxSpectators = spectatorCount;
+	SpectatorRelay relay(relaySettings);
+
+	sf::Clock clock;
+	while (!relay.isConnected() && !relay.hasFailed() && clock.getElapsedTime() < ConnectTimeout)
+		sf::sleep(sf::milliseconds(10));
+
+	if (!relay.isConnected())
+	{
+		std::cout << "Load test: the relay did not connect" << std::endl;
+		return 1;
+	}
+
+	std::vector<ClientPtr> players;
+	std::vector<ClientPtr> spectators;
+
+	for (std::size_t i = 0; i < playerCount; ++i)
+	{
+		players.push_back(ClientPtr(new SimulatedClient()));
+		if (!connectClient(*players.back(), LoadTestServerPort))
+		{
+			std::cout << "Load test: player " << i << " could not connect" << std::endl;
+			return 1;
+		}
+	}
+
+	for (std::size_t i = 0; i < spectatorCount; ++i)
+	{
+		spectators.push_back(ClientPtr(new SimulatedClient()));
+		if (!connectClient(*spectators.back(), LoadTestRelayPort))
+		{
+			std::cout << "Load test: spectator " << i << " could not connect" << std::endl;
+			return 1;
+		}
+	}
+
+	// When the first player saw each snapshot; spectators are measured against it
+	std::map<sf::Uint32, sf::Time> snapshotTimes;
+	sf::Time lastPingTime = sf::Time::Zero;
+	clock.restart();
+
+	while (clock.getElapsedTime() < duration)
+	{
+		sf::Time now = clock.getElapsedTime();
+
+		FOREACH(ClientPtr& player, players)
+		{
+			pollClient(*player, [&](sf::Uint32 serverTick)
+			{
+				snapshotTimes.insert(std::make_pair(serverTick, now));
+			});
+		}
+
+		FOREACH(ClientPtr& spectator, spectators)
+		{
+			SimulatedClient& client = *spectator;
+			pollClient(client, [&](sf::Uint32 serverTick)
+			{
+				auto seen = snapshotTimes.find(serverTick);
+				if (seen == snapshotTimes.end())
+					return;
+
+				sf::Time lag = now - seen->second;
+				client.delaySamples++;
+				client.totalDelay += lag;
+				client.worstDelay = std::max(client.worstDelay, lag);
+			});
+		}
+
+		// Keeps the players from timing out
+		if (now >= lastPingTime + PingInterval)
+		{
+			FOREACH(ClientPtr& player, players)
+			{
+				PingMessage ping;
+				ping.clientTime = now.asMicroseconds();
+
+				sf::Packet packet = Schema::makePacket(ping);
+				player->socket.send(packet);
+			}
+
+			lastPingTime = now;
+		}
+
+		sf::sleep(sf::milliseconds(1));
+	}
+
+	sf::Uint64 fewestPackets = spectators.empty() ? 0 : spectators.front()->packets;
+	sf::Uint64 totalPackets = 0, totalBytes = 0;
+	std::size_t delaySamples = 0, disconnected = 0;
+	sf::Time totalDelay = sf::Time::Zero, worstDelay = sf::Time::Zero;
+
+	FOREACH(ClientPtr& spectator, spectators)
+	{
+		fewestPackets = std::min(fewestPackets, spectator->packets);
+		totalPackets += spectator->packets;
+		totalBytes += spectator->bytes;
+		delaySamples += spectator->delaySamples;
+		totalDelay += spectator->totalDelay;
+		worstDelay = std::max(worstDelay, spectator->worstDelay);
+
+		if (spectator->disconnected)
+			disconnected++;
+	}
+
+	SpectatorRelay::Statistics statistics = relay.getStatistics();
+	std::size_t count = std::max<std::size_t>(spectators.size(), 1);
+	sf::Time averageDelay = delaySamples > 0 ? totalDelay / static_cast<float>(delaySamples) : sf::Time::Zero;
+
+	std::cout << "Load test: each spectator received " << totalPackets / count << " packets on average ("
+		<< totalBytes / count << " bytes), fewest " << fewestPackets << std::endl;
+	std::cout << "Load test: spectators behind the players by " << averageDelay.asMilliseconds() << "ms on average, worst "
+		<< worstDelay.asMilliseconds() << "ms (" << delaySamples << " snapshots)" << std::endl;
+	std::cout << "Load test: relay took " << statistics.upstreamPackets << " packets (" << statistics.upstreamBytes
+		<< " bytes) from the server and sent " << statistics.framesSent << " (" << statistics.bytesSent << " bytes)" << std::endl;
+	std::cout << "Load test: " << disconnected << " spectators disconnected, " << statistics.droppedSpectators << " dropped by the relay" << std::endl;
+
+	bool passed = disconnected == 0 && statistics.droppedSpectators == 0 && (spectatorCount == 0 || fewestPackets > 0);
+	return passed ? 0 : 1;
+}
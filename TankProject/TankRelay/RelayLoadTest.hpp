@@ -0,0 +1,12 @@
+#pragma once
+
+#include <SFML/System/Time.hpp>
+
+#include <cstddef>
+
+
+// Runs a GameServer and a SpectatorRelay on loopback, joins a few idle players to the server and
+// the given number of simulated spectators to the relay, then reports what the spectators received
+// and how far behind the players they were. Each spectator takes two sockets in this process, so
+// large counts may need a higher open file limit. Returns the process exit code.
+int runRelayLoadTest(std::size_t spectatorCount, std::size_t playerCount, sf::Time duration, sf::Time delay);
@@ -0,0 +1,489 @@
+#include "SpectatorRelay.hpp"
+#include "Compression.hpp"
+#include "Foreach.hpp"
+
+#include <SFML/System/Lock.hpp>
+#include <SFML/System/Sleep.hpp>
+#include <SFML/Network/Packet.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+
+namespace
+{
+	const sf::Time ConnectTimeout = sf::seconds(5.f);
+
+	// The server drops peers that stay silent for 3 seconds
+	const sf::Time PingInterval = sf::seconds(1.f);
+
+	// A spectator this far behind is not keeping up with the stream and is dropped
+	const std::size_t MaxBacklogBytes = 256 * 1024;
+
+	// Same chunking as GameServer uses for joining clients
+	const std::size_t WorldStateChunkSize = 1024;
+
+	// What GameServer::joinPeer gives a new tank; PlayerConnect does not carry them
+	const sf::Int32 SpawnHitpoints = 100;
+	const sf::Int32 SpawnMissileAmmo = 20;
+
+	const sf::Time ServerTickInterval = sf::seconds(1.f / ServerTickRate);
+}
+
+SpectatorRelay::Settings::Settings()
+	: serverAddress(sf::IpAddress::LocalHost)
+	, serverPort(ServerPort)
+	, port(ServerPort + 1)
+	, delay(sf::seconds(10.f))
+	, maxSpectators(500)
+{
+}
+
+SpectatorRelay::Statistics::Statistics()
+	: spectators(0)
+	, droppedSpectators(0)
+	, upstreamPackets(0)
+	, upstreamBytes(0)
+	, framesSent(0)
+	, bytesSent(0)
+{
+}
+
+SpectatorRelay::Spectator::Spectator()
+	: socket()
+	, backlog()
+	, backlogBytes(0)
+	, sentBytes(0)
+	, failed(false)
+{
+	socket.setBlocking(false);
+}
+
+SpectatorRelay::SpectatorRelay(const Settings& settings)
+	: mSettings(settings)
+	, mThread(&SpectatorRelay::executionThread, this)
+	, mWaitingThreadEnd(false)
+	, mConnected(false)
+	, mFailed(false)
+	, mClock()
+	, mUpstream()
+	, mLastPingTime(sf::Time::Zero)
+	, mServerClock(ServerTickInterval)
+	, mDelayedFrames()
+	, mTanks()
+	, mListener()
+	, mPendingSpectator()
+	, mSpectators()
+	, mCounters()
+	, mStatisticsMutex()
+	, mStatistics()
+{
+	mThread.launch();
+}
+
+SpectatorRelay::~SpectatorRelay()
+{
+	mWaitingThreadEnd = true;
+	mThread.wait();
+}
+
+bool SpectatorRelay::isConnected() const
+{
+	return mConnected;
+}
+
+bool SpectatorRelay::hasFailed() const
+{
+	return mFailed;
+}
+
+SpectatorRelay::Statistics SpectatorRelay::getStatistics() const
+{
+	sf::Lock lock(mStatisticsMutex);
+	return mStatistics;
+}
+
+void SpectatorRelay::executionThread()
+{
+	mListener.setBlocking(false);
+	if (mListener.listen(mSettings.port) != sf::TcpListener::Done)
+	{
+		std::cout << "Relay: cannot listen on port " << mSettings.port << std::endl;
+		mFailed = true;
+		return;
+	}
+
+	if (!connectUpstream())
+	{
+		mFailed = true;
+		return;
+	}
+
+	while (!mWaitingThreadEnd && mConnected)
+	{
+		receiveUpstream();
+		pingUpstream();
+		releaseFrames();
+		acceptSpectators();
+
+		FOREACH(SpectatorPtr& spectator, mSpectators)
+			handleSpectatorPackets(*spectator);
+
+		flushSpectators();
+		removeFailedSpectators();
+		publishStatistics();
+
+		sf::sleep(sf::milliseconds(5));
+	}
+
+	mListener.close();
+	mUpstream.disconnect();
+}
+
+bool SpectatorRelay::connectUpstream()
+{
+	if (mUpstream.connect(mSettings.serverAddress, mSettings.serverPort, ConnectTimeout) != sf::Socket::Done)
+	{
+		std::cout << "Relay: cannot reach the server at " << mSettings.serverAddress << ":" << mSettings.serverPort << std::endl;
+		return false;
+	}
+
+	sf::Packet packet = Schema::makePacket(SpectateMessage());
+	mUpstream.send(packet);
+	mUpstream.setBlocking(false);
+
+	std::cout << "Relay: watching " << mSettings.serverAddress << ":" << mSettings.serverPort << ", spectators on port "
+		<< mSettings.port << " with " << mSettings.delay.asSeconds() << "s delay" << std::endl;
+
+	mConnected = true;
+	return true;
+}
+
+void SpectatorRelay::receiveUpstream()
+{
+	sf::Packet packet;
+	sf::Socket::Status status;
+
+	while ((status = mUpstream.receive(packet)) == sf::Socket::Done)
+	{
+		mCounters.upstreamPackets++;
+		mCounters.upstreamBytes += packet.getDataSize();
+
+		sf::Int32 packetType;
+		if (packet >> packetType)
+		{
+			switch (packetType)
+			{
+			case PongMessage::Type:
+				handlePong(packet);
+				break;
+
+			// Addressed to the relay's own connection
+			case SpawnSelfMessage::Type:
+			case AcceptCoopPartnerMessage::Type:
+			case SessionTokenMessage::Type:
+			case ResumeAcceptedMessage::Type:
+			case ResumeRejectedMessage::Type:
+				break;
+
+			default:
+			{
+				DelayedFrame delayed;
+				delayed.releaseTime = now() + mSettings.delay;
+				delayed.packetType = packetType;
+				delayed.frame = makeFrame(packet);
+				mDelayedFrames.push_back(delayed);
+			} break;
+			}
+		}
+
+		packet.clear();
+	}
+
+	if (status == sf::Socket::Disconnected || status == sf::Socket::Error)
+	{
+		std::cout << "Relay: lost the connection to the server" << std::endl;
+		mConnected = false;
+		mFailed = true;
+	}
+}
+
+void SpectatorRelay::pingUpstream()
+{
+	if (now() < mLastPingTime + PingInterval)
+		return;
+
+	PingMessage ping;
+	ping.clientTime = now().asMicroseconds();
+
+	sf::Packet packet = Schema::makePacket(ping);
+	mUpstream.send(packet);
+
+	mLastPingTime = now();
+}
+
+void SpectatorRelay::handlePong(sf::Packet& packet)
+{
+	PongMessage pong;
+	if (Schema::decode(packet, pong))
+		mServerClock.onPong(sf::microseconds(pong.clientTime), sf::microseconds(pong.serverTime), pong.serverTick, now());
+}
+
+void SpectatorRelay::releaseFrames()
+{
+	while (!mDelayedFrames.empty() && mDelayedFrames.front().releaseTime <= now())
+	{
+		const DelayedFrame& delayed = mDelayedFrames.front();
+		trackWorld(delayed.packetType, delayed.frame);
+
+		FOREACH(SpectatorPtr& spectator, mSpectators)
+			queueFrame(*spectator, delayed.frame);
+
+		mDelayedFrames.pop_front();
+	}
+}
+
+void SpectatorRelay::trackWorld(sf::Int32 packetType, const Frame& frame)
+{
+	if (packetType != InitialStateChunkMessage::Type && packetType != PlayerConnectMessage::Type
+		&& packetType != PlayerDisconnectMessage::Type && packetType != UpdateClientStateMessage::Type)
+		return;
+
+	sf::Packet packet;
+	packet.append(frame->data() + sizeof(sf::Uint32), frame->size() - sizeof(sf::Uint32));
+	packet >> packetType;
+
+	switch (packetType)
+	{
+	case InitialStateChunkMessage::Type:
+	{
+		InitialStateChunkMessage chunk;
+		std::vector<char> bytes;
+		InitialStateMessage message;
+		if (!Schema::decode(packet, chunk)
+			|| !decompressBlock(reinterpret_cast<const char*>(chunk.data.data()), chunk.data.size(), chunk.uncompressedSize, bytes)
+			|| !Schema::decode(bytes.data(), bytes.size(), message))
+			break;
+
+		FOREACH(const InitialStateMessage::Tank& tank, message.tanks)
+			mTanks[tank.spawn.identifier] = tank;
+	} break;
+
+	case PlayerConnectMessage::Type:
+	{
+		PlayerConnectMessage message;
+		if (!Schema::decode(packet, message))
+			break;
+
+		InitialStateMessage::Tank& tank = mTanks[message.tank.identifier];
+		tank.spawn = message.tank;
+		tank.hitpoints = SpawnHitpoints;
+		tank.missileAmmo = SpawnMissileAmmo;
+	} break;
+
+	case PlayerDisconnectMessage::Type:
+	{
+		PlayerDisconnectMessage message;
+		if (Schema::decode(packet, message))
+			mTanks.erase(message.identifier);
+	} break;
+
+	case UpdateClientStateMessage::Type:
+	{
+		UpdateClientStateMessage message;
+		if (!Schema::decode(packet, message))
+			break;
+
+		// A snapshot lists every tank, so any other one is gone (destroyed tanks get no PlayerDisconnect)
+		std::map<sf::Int32, InitialStateMessage::Tank> tanks;
+		FOREACH(const UpdateClientStateMessage::Tank& state, message.tanks)
+		{
+			auto known = mTanks.find(state.identifier);
+			if (known == mTanks.end())
+				continue;
+
+			InitialStateMessage::Tank& tank = tanks[state.identifier] = known->second;
+			tank.spawn.x = state.x;
+			tank.spawn.y = state.y;
+			tank.spawn.rotation = state.rotation;
+			tank.spawn.turretRotation = state.turretRotation;
+		}
+
+		mTanks.swap(tanks);
+	} break;
+	}
+}
+
+void SpectatorRelay::acceptSpectators()
+{
+	while (mSpectators.size() < mSettings.maxSpectators)
+	{
+		if (!mPendingSpectator)
+			mPendingSpectator.reset(new Spectator());
+
+		if (mListener.accept(mPendingSpectator->socket) != sf::TcpListener::Done)
+			break;
+
+		sendWorldState(*mPendingSpectator);
+		mSpectators.push_back(std::move(mPendingSpectator));
+	}
+}
+
+void SpectatorRelay::handleSpectatorPackets(Spectator& spectator)
+{
+	sf::Packet packet;
+	sf::Socket::Status status;
+
+	// Spectators are read-only: their Join and inputs are ignored
+	while ((status = spectator.socket.receive(packet)) == sf::Socket::Done)
+	{
+		sf::Int32 packetType;
+		PingMessage ping;
+		if (packet >> packetType)
+		{
+			if (packetType == PingMessage::Type && Schema::decode(packet, ping))
+				sendPong(spectator, ping.clientTime);
+			else if (packetType == QuitMessage::Type)
+				spectator.failed = true;
+		}
+
+		packet.clear();
+	}
+
+	if (status == sf::Socket::Disconnected || status == sf::Socket::Error)
+		spectator.failed = true;
+}
+
+void SpectatorRelay::sendWorldState(Spectator& spectator)
+{
+	// Built from the released stream, so it joins up with the frames the spectator gets next
+	auto tank = mTanks.begin();
+	bool isLast = false;
+
+	while (!isLast)
+	{
+		InitialStateMessage message;
+		std::size_t size = 0;
+
+		for (; tank != mTanks.end() && size < WorldStateChunkSize; ++tank)
+		{
+			message.tanks.push_back(tank->second);
+			size += Schema::encodedSize(tank->second);
+		}
+
+		std::vector<char> bytes;
+		Schema::encode(bytes, message);
+
+		std::vector<char> compressed;
+		compressBlock(bytes.data(), bytes.size(), compressed);
+
+		isLast = tank == mTanks.end();
+
+		InitialStateChunkMessage chunk;
+		chunk.uncompressedSize = static_cast<sf::Uint32>(bytes.size());
+		chunk.isLast = isLast;
+		chunk.data.assign(compressed.begin(), compressed.end());
+
+		queueFrame(spectator, makeFrame(Schema::makePacket(chunk)));
+	}
+}
+
+void SpectatorRelay::sendPong(Spectator& spectator, sf::Int64 clientTime)
+{
+	// Without a clock yet the spectator simply pings again
+	if (!mServerClock.isSynchronized())
+		return;
+
+	// The server clock as it was when the frames now being released were sent
+	sf::Time serverTime = mServerClock.getServerTime(now()) - mSettings.delay;
+	float serverTick = mServerClock.getServerTick(now()) - mSettings.delay / ServerTickInterval;
+
+	PongMessage pong;
+	pong.clientTime = clientTime;
+	pong.serverTime = serverTime.asMicroseconds();
+	pong.serverTick = static_cast<sf::Uint32>(std::max(serverTick, 0.f));
+	queueFrame(spectator, makeFrame(Schema::makePacket(pong)));
+}
+
+void SpectatorRelay::queueFrame(Spectator& spectator, const Frame& frame)
+{
+	if (spectator.failed)
+		return;
+
+	spectator.backlog.push_back(frame);
+	spectator.backlogBytes += frame->size();
+
+	if (spectator.backlogBytes > MaxBacklogBytes)
+	{
+		spectator.failed = true;
+		mCounters.droppedSpectators++;
+		std::cout << "Relay: dropped a spectator that fell behind" << std::endl;
+	}
+}
+
+void SpectatorRelay::flushSpectators()
+{
+	FOREACH(SpectatorPtr& spectator, mSpectators)
+	{
+		while (!spectator->failed && !spectator->backlog.empty())
+		{
+			const std::vector<char>& frame = *spectator->backlog.front();
+
+			std::size_t sent = 0;
+			sf::Socket::Status status = spectator->socket.send(frame.data() + spectator->sentBytes, frame.size() - spectator->sentBytes, sent);
+			spectator->sentBytes += sent;
+
+			if (spectator->sentBytes == frame.size())
+			{
+				mCounters.framesSent++;
+				mCounters.bytesSent += frame.size();
+
+				spectator->backlogBytes -= frame.size();
+				spectator->sentBytes = 0;
+				spectator->backlog.pop_front();
+			}
+			else if (status == sf::Socket::Disconnected || status == sf::Socket::Error)
+			{
+				spectator->failed = true;
+			}
+			else
+			{
+				// Socket buffer full; the rest goes next update
+				break;
+			}
+		}
+	}
+}
+
+void SpectatorRelay::removeFailedSpectators()
+{
+	auto failed = std::remove_if(mSpectators.begin(), mSpectators.end(),
+		[](const SpectatorPtr& spectator) { return spectator->failed; });
+
+	mSpectators.erase(failed, mSpectators.end());
+}
+
+void SpectatorRelay::publishStatistics()
+{
+	mCounters.spectators = mSpectators.size();
+
+	sf::Lock lock(mStatisticsMutex);
+	mStatistics = mCounters;
+}
+
+SpectatorRelay::Frame SpectatorRelay::makeFrame(const sf::Packet& packet)
+{
+	const char* data = static_cast<const char*>(packet.getData());
+
+	// Same framing sf::TcpSocket::send(sf::Packet&) uses, so spectators receive it as a packet
+	std::shared_ptr<std::vector<char>> frame = std::make_shared<std::vector<char>>();
+	Schema::encode(*frame, static_cast<sf::Uint32>(packet.getDataSize()));
+	frame->insert(frame->end(), data, data + packet.getDataSize());
+
+	return frame;
+}
+
+sf::Time SpectatorRelay::now() const
+{
+	return mClock.getElapsedTime();
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "NetworkMessages.hpp"
+#include "ClockSync.hpp"
+
+#include <SFML/System/Thread.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Mutex.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/Network/TcpListener.hpp>
+#include <SFML/Network/TcpSocket.hpp>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+
+// Watches a GameServer as one spectator peer and passes what it receives on to any number of
+// spectators, a fixed delay later. Every packet is framed for the wire once and the same buffer is
+// queued for every spectator; it is freed when the last of them has sent it.
+//
+// Spectators connect like a game client (their Join is ignored) and get the world state, then the
+// server's broadcasts. Their pings are answered with the server clock as it was the delay ago, so
+// their interpolation runs on the delayed stream.
+class SpectatorRelay : private sf::NonCopyable
+{
+public:
+	struct Settings
+	{
+		Settings();
+
+		sf::IpAddress					serverAddress;
+		unsigned short					serverPort;
+		unsigned short					port;
+		sf::Time						delay;
+		std::size_t						maxSpectators;
+	};
+
+	struct Statistics
+	{
+		Statistics();
+
+		std::size_t						spectators;
+		sf::Uint64						droppedSpectators;
+		sf::Uint64						upstreamPackets;
+		sf::Uint64						upstreamBytes;
+		sf::Uint64						framesSent;		// one per spectator per packet
+		sf::Uint64						bytesSent;
+	};
+
+
+public:
+	explicit							SpectatorRelay(const Settings& settings);
+	~SpectatorRelay();
+
+	// False until the server accepted the relay, and again once the connection is lost
+	bool								isConnected() const;
+	bool								hasFailed() const;
+	Statistics							getStatistics() const;
+
+
+private:
+	// A packet as it goes on the wire: SFML's size prefix, then the data
+	typedef std::shared_ptr<const std::vector<char>> Frame;
+
+	struct DelayedFrame
+	{
+		sf::Time						releaseTime;
+		sf::Int32						packetType;
+		Frame							frame;
+	};
+
+	struct Spectator
+	{
+		Spectator();
+
+		sf::TcpSocket					socket;
+		std::deque<Frame>				backlog;
+		std::size_t						backlogBytes;
+		std::size_t						sentBytes;		// of the front frame
+		bool							failed;
+	};
+
+	typedef std::unique_ptr<Spectator> SpectatorPtr;
+
+
+private:
+	void								executionThread();
+	bool								connectUpstream();
+	void								receiveUpstream();
+	void								pingUpstream();
+	void								handlePong(sf::Packet& packet);
+	void								releaseFrames();
+	void								trackWorld(sf::Int32 packetType, const Frame& frame);
+	void								acceptSpectators();
+	void								handleSpectatorPackets(Spectator& spectator);
+	void								sendWorldState(Spectator& spectator);
+	void								sendPong(Spectator& spectator, sf::Int64 clientTime);
+	void								queueFrame(Spectator& spectator, const Frame& frame);
+	void								flushSpectators();
+	void								removeFailedSpectators();
+	void								publishStatistics();
+
+	static Frame						makeFrame(const sf::Packet& packet);
+	sf::Time							now() const;
+
+
+private:
+	Settings							mSettings;
+	sf::Thread							mThread;
+	std::atomic<bool>					mWaitingThreadEnd;
+	std::atomic<bool>					mConnected;
+	std::atomic<bool>					mFailed;
+	sf::Clock							mClock;
+
+	sf::TcpSocket						mUpstream;
+	sf::Time							mLastPingTime;
+
+	ClockSync							mServerClock;
+
+	std::deque<DelayedFrame>			mDelayedFrames;
+
+	// Tanks as of the released stream, for the world state of new spectators
+	std::map<sf::Int32, InitialStateMessage::Tank>	mTanks;
+
+	sf::TcpListener						mListener;
+	SpectatorPtr						mPendingSpectator;
+	std::vector<SpectatorPtr>			mSpectators;
+
+	// Counted by the relay thread, copied for getStatistics() once per update
+	Statistics							mCounters;
+	mutable sf::Mutex					mStatisticsMutex;
+	Statistics							mStatistics;
+};
@@ -0,0 +1,116 @@
+#include "SpectatorRelay.hpp"
+#include "RelayLoadTest.hpp"
+
+#include <SFML/System/Sleep.hpp>
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+
+// Spectator relay: watches one GameServer and streams the match, delayed, to many spectators.
+//
+// TankRelay [--server ADDRESS] [--server-port N] [--port N] [--delay SECONDS] [--max-spectators N]
+// TankRelay --load-test SPECTATORS [--players N] [--duration SECONDS] [--delay SECONDS]
+
+namespace
+{
+	volatile std::sig_atomic_t stopRequested = 0;
+
+	void requestStop(int)
+	{
+		stopRequested = 1;
+	}
+
+	bool parseNumber(const char* text, unsigned long min, unsigned long max, unsigned long& value)
+	{
+		char* end = nullptr;
+		value = std::strtoul(text, &end, 10);
+		return end != text && *end == '\0' && value >= min && value <= max;
+	}
+
+	bool parseSeconds(const char* text, sf::Time& value)
+	{
+		char* end = nullptr;
+		double seconds = std::strtod(text, &end);
+		value = sf::seconds(static_cast<float>(seconds));
+		return end != text && *end == '\0' && seconds >= 0.0 && seconds <= 3600.0;
+	}
+
+	void printUsage()
+	{
+		std::cout << "Usage: TankRelay [--server ADDRESS] [--server-port N] [--port N] [--delay SECONDS] [--max-spectators N]" << std::endl;
+		std::cout << "       TankRelay --load-test SPECTATORS [--players N] [--duration SECONDS] [--delay SECONDS]" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	SpectatorRelay::Settings settings;
+
+	bool loadTest = false;
+	unsigned long spectators = 0;
+	unsigned long players = 4;
+	sf::Time duration = sf::Time::Zero;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string option = argv[i];
+		unsigned long value = 0;
+
+		if (option == "--help")
+		{
+			printUsage();
+			return 0;
+		}
+
+		bool valid = i + 1 < argc;
+		if (valid && option == "--server")
+			valid = (settings.serverAddress = sf::IpAddress(argv[i + 1])) != sf::IpAddress::None;
+		else if (valid && option == "--server-port" && (valid = parseNumber(argv[i + 1], 1, 65535, value)))
+			settings.serverPort = static_cast<unsigned short>(value);
+		else if (valid && option == "--port" && (valid = parseNumber(argv[i + 1], 1, 65535, value)))
+			settings.port = static_cast<unsigned short>(value);
+		else if (valid && option == "--delay")
+			valid = parseSeconds(argv[i + 1], settings.delay);
+		else if (valid && option == "--max-spectators" && (valid = parseNumber(argv[i + 1], 1, 100000, value)))
+			settings.maxSpectators = value;
+		else if (valid && option == "--load-test")
+			valid = loadTest = parseNumber(argv[i + 1], 1, 100000, spectators);
+		else if (valid && option == "--players")
+			valid = parseNumber(argv[i + 1], 0, 15, players);
+		else if (valid && option == "--duration")
+			valid = parseSeconds(argv[i + 1], duration);
+		else
+			valid = false;
+
+		if (!valid)
+		{
+			std::cout << "Relay: invalid option " << option << std::endl;
+			printUsage();
+			return 1;
+		}
+
+		++i;
+	}
+
+	if (loadTest)
+	{
+		// Long enough to see the delayed stream for a while
+		if (duration == sf::Time::Zero)
+			duration = settings.delay + sf::seconds(10.f);
+
+		return runRelayLoadTest(spectators, players, duration, settings.delay);
+	}
+
+	std::signal(SIGINT, requestStop);
+	std::signal(SIGTERM, requestStop);
+
+	SpectatorRelay relay(settings);
+
+	while (!stopRequested && !relay.hasFailed())
+		sf::sleep(sf::milliseconds(100));
+
+	return relay.hasFailed() ? 1 : 0;
+}